@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace simplechat::bench {
+
+// Keeps the optimizer from discarding a result.
+template <class T>
+inline void do_not_optimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Runs body(i) for i in [0, iterations) on each of `threads` threads after a
+// common start signal and prints aggregate and per-thread throughput.
+template <class Body>
+double run(const char* name, unsigned threads, std::uint64_t iterations, Body body) {
+    std::atomic<unsigned> ready{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> pool;
+    pool.reserve(threads);
+
+    for (unsigned t = 0; t < threads; ++t) {
+        pool.emplace_back([&] {
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+            for (std::uint64_t i = 0; i < iterations; ++i) body(i);
+        });
+    }
+    while (ready.load() != threads) std::this_thread::yield();
+
+    const auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& th : pool) th.join();
+    const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const double total = static_cast<double>(iterations) * threads / secs;
+    std::printf("%-36s %2u thr  %12.0f ops/s  %12.0f ops/s/thr  %8.1f ns/op\n",
+                name, threads, total, total / threads, 1e9 * threads / total);
+    return total;
+}
+
+} // namespace simplechat::bench
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace simplechat::bench {
+
+// Log-linear latency histogram in nanoseconds: each power of two is split
+// into 16 linear sub-buckets, so any recorded value is off by < 6.25%.
+// record() is a single relaxed fetch_add; safe from any thread.
+class LatencyHistogram {
+public:
+    void record(std::uint64_t ns) noexcept {
+        buckets_[index_of(ns)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+
+        std::uint64_t prev = max_.load(std::memory_order_relaxed);
+        while (ns > prev && !max_.compare_exchange_weak(prev, ns, std::memory_order_relaxed)) {}
+    }
+
+    std::uint64_t count() const noexcept { return count_.load(std::memory_order_relaxed); }
+    std::uint64_t max() const noexcept { return max_.load(std::memory_order_relaxed); }
+
+    // Upper bound of the bucket holding quantile q (0..1).
+    std::uint64_t percentile(double q) const noexcept {
+        const std::uint64_t total = count();
+        if (total == 0) return 0;
+
+        const auto rank = static_cast<std::uint64_t>(q * static_cast<double>(total - 1)) + 1;
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < kBuckets; ++i) {
+            seen += buckets_[i].load(std::memory_order_relaxed);
+            if (seen >= rank) return upper_bound_of(i);
+        }
+        return max();
+    }
+
+private:
+    static constexpr int kSubBits = 4;
+    static constexpr std::size_t kSub = std::size_t(1) << kSubBits;
+    static constexpr std::size_t kBuckets = 64 * kSub;
+
+    static std::size_t index_of(std::uint64_t v) noexcept {
+        if (v < kSub) return static_cast<std::size_t>(v);
+        const int msb = 63 - __builtin_clzll(v);
+        const auto sub = static_cast<std::size_t>((v >> (msb - kSubBits)) & (kSub - 1));
+        return static_cast<std::size_t>(msb - kSubBits + 1) * kSub + sub;
+    }
+
+    static std::uint64_t upper_bound_of(std::size_t i) noexcept {
+        if (i < kSub) return i;
+        const std::size_t shift = i / kSub - 1;
+        const std::uint64_t base = (kSub + i % kSub) << shift;
+        return base + (std::uint64_t(1) << shift) - 1;
+    }
+
+    std::array<std::atomic<std::uint64_t>, kBuckets> buckets_{};
+    std::atomic<std::uint64_t> count_{0};
+    std::atomic<std::uint64_t> max_{0};
+};
+
+} // namespace simplechat::bench
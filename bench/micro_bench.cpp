@@ -0,0 +1,241 @@
+// Microbenchmarks for the per-message primitives, runnable without a
+// deployed server.
+//
+// usage: simplechat_micro_bench [iterations] [port]
+//
+// The WebSocketServer cases start an in-process server on `port` (default
+// 9310) with one loopback client that drains everything it is sent. They
+// also report heap allocations (operator new calls) per operation, counted
+// on the server's threads only: the loopback client opts out.
+
+#include "Bench.hpp"
+
+#include "chat/IDGenerator.hpp"
+#include "chat/User.h"
+#include "networking/WebSocketServer.h"
+#include "protocol/JsonIngress.h"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/websocket.hpp>
+#include <boost/json.hpp>
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace json = boost::json;
+
+using simplechat::bench::do_not_optimize;
+using simplechat::bench::run;
+
+namespace {
+
+std::atomic<std::uint64_t> g_allocations{0};
+thread_local bool t_untracked = false;  // set by the client-side threads
+
+} // namespace
+
+void* operator new(std::size_t n) {
+    if (!t_untracked) g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+std::uint64_t allocations() { return g_allocations.load(std::memory_order_relaxed); }
+
+void report_allocations(const char* name, std::uint64_t allocs, std::uint64_t ops) {
+    std::printf("%-36s %12.2f allocs/op\n", name, static_cast<double>(allocs) / static_cast<double>(ops));
+}
+
+void bench_ids(std::uint64_t n) {
+    simplechat::chat::IDGenerator idgen;
+    run("IDGenerator::make(User)", 1, n, [&](std::uint64_t) {
+        do_not_optimize(idgen.make(simplechat::chat::IDGenerator::Kind::User));
+    });
+    run("IDGenerator::next", 1, n, [&](std::uint64_t) {
+        do_not_optimize(idgen.next());
+    });
+}
+
+void bench_user(std::uint64_t n) {
+    using simplechat::chat::User;
+    const std::string clean = "alice";
+    const std::string padded = "   alice in wonderland  \t";
+    const std::string long_name = "  a display name that is well over the limit  ";
+
+    // set_name is the sanitizer plus one string move.
+    User user(simplechat::chat::Ulid{}, "guest");
+    run("User::set_name (clean)", 1, n, [&](std::uint64_t) {
+        user.set_name(clean);
+        do_not_optimize(user.name());
+    });
+    run("User::set_name (padded)", 1, n, [&](std::uint64_t) {
+        user.set_name(padded);
+        do_not_optimize(user.name());
+    });
+    run("User::set_name (too long)", 1, n, [&](std::uint64_t) {
+        user.set_name(long_name);
+        do_not_optimize(user.name());
+    });
+}
+
+// The "msg" envelope exactly as SimpleChat's on_chat builds it.
+void bench_json(std::uint64_t n) {
+    simplechat::chat::IDGenerator idgen;
+    const std::string name = "alice";
+    const std::string user_id = idgen.userID();
+    const std::string client_id = idgen.clientID();
+    const std::string room_id = "room-lobby";
+    const std::string text = "hello everyone, this is a fairly typical chat line";
+
+    run("dump(msg envelope)", 1, n, [&](std::uint64_t) {
+        do_not_optimize(json::serialize(json::object{
+            {"type", "msg"},
+            {"from", name},
+            {"user_id", user_id},
+            {"client_id", client_id},
+            {"room_id", room_id},
+            {"text", text}
+        }));
+    });
+
+    const std::string frame = R"({"type":"msg","text":"hello everyone, this is a fairly typical chat line"})";
+    run("json::parse(msg frame)", 1, n, [&](std::uint64_t) {
+        do_not_optimize(json::parse(frame));
+    });
+    run("JsonIngress::parse(msg frame)", 1, n, [&](std::uint64_t) {
+        do_not_optimize(simplechat::protocol::JsonIngress::parse(frame));
+    });
+}
+
+void bench_send(std::uint64_t n, unsigned short port) {
+    namespace beast = boost::beast;
+    namespace websocket = beast::websocket;
+    namespace asio = boost::asio;
+    using namespace simplechat::networking;
+
+    asio::io_context ioc(1);
+    WebSocketServer::Options options;
+    options.max_queue_messages = n + 16;  // measure enqueue, not the drop policy
+    options.max_queue_bytes = std::size_t(-1);
+    WebSocketServer server(ioc, port, options);
+
+    std::atomic<ClientId> client{0};
+    server.set_on_connect([&](ClientId id) { client = id; });
+    server.start();
+    std::thread io([&] { ioc.run(); });
+
+    // Drains on its own thread so the server's socket never backs up.
+    t_untracked = true;
+    asio::io_context cioc;
+    websocket::stream<asio::ip::tcp::socket> ws(cioc);
+    ws.next_layer().connect({asio::ip::make_address("127.0.0.1"), port});
+    ws.handshake("localhost", "/");
+    t_untracked = false;
+
+    std::atomic<std::uint64_t> received{0};
+    std::thread drain([&] {
+        t_untracked = true;
+        beast::flat_buffer buf;
+        beast::error_code ec;
+        while (!ec) {
+            ws.read(buf, ec);
+            buf.consume(buf.size());
+            if (!ec) received.fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+    while (client == 0) std::this_thread::yield();
+
+    const ClientId id = client;
+    const std::string msg = R"({"type":"msg","from":"alice","text":"hello everyone"})";
+    const Payload shared = make_payload(msg);
+
+    // Allocations until the client has everything, so the write side counts.
+    std::uint64_t expected = 0;
+    auto counted = [&](const char* name, std::uint64_t delivered, auto body) {
+        const std::uint64_t before = allocations();
+        run(name, 1, n, body);
+        expected += delivered;
+        while (received.load(std::memory_order_relaxed) < expected) std::this_thread::yield();
+        report_allocations(name, allocations() - before, n);
+    };
+
+    counted("WebSocketServer::send(string)", n, [&](std::uint64_t) { server.send(id, msg); });
+    counted("WebSocketServer::send(Payload)", n, [&](std::uint64_t) { server.send(id, shared); });
+    counted("WebSocketServer::send(unknown id)", 0, [&](std::uint64_t) { server.send(id + 1, shared); });
+
+    // The close frame queues behind the backlog; the drain loop ends on it.
+    server.stop();
+    drain.join();
+    ioc.stop();
+    io.join();
+}
+
+// Connect, handshake, close: the per-connection cost under churn. Only the
+// server's io thread is counted.
+void bench_connect(std::uint64_t n, unsigned short port) {
+    namespace beast = boost::beast;
+    namespace websocket = beast::websocket;
+    namespace asio = boost::asio;
+    using namespace simplechat::networking;
+
+    asio::io_context ioc(1);
+    WebSocketServer server(ioc, port);
+    std::atomic<std::uint64_t> closed{0};
+    server.set_on_disconnect([&](ClientId) { closed.fetch_add(1, std::memory_order_relaxed); });
+    server.start();
+    std::thread io([&] { ioc.run(); });
+
+    t_untracked = true;
+    asio::io_context cioc;
+    auto churn = [&](std::uint64_t count) {
+        const std::uint64_t target = closed.load() + count;
+        for (std::uint64_t i = 0; i < count; ++i) {
+            websocket::stream<asio::ip::tcp::socket> ws(cioc);
+            ws.next_layer().connect({asio::ip::make_address("127.0.0.1"), port});
+            ws.handshake("localhost", "/");
+            ws.close(websocket::close_code::normal);
+        }
+        while (closed.load() < target) std::this_thread::yield();
+    };
+
+    churn(std::min<std::uint64_t>(n, 256));  // warm the pools
+
+    const std::uint64_t before = allocations();
+    const auto start = std::chrono::steady_clock::now();
+    churn(n);
+    const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%-36s  1 thr  %12.0f ops/s  %26s %8.1f us/op\n",
+                "connect+handshake+close", n / secs, "", 1e6 * secs / n);
+    report_allocations("connect+handshake+close", allocations() - before, n);
+    t_untracked = false;
+
+    server.stop();
+    ioc.stop();
+    io.join();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const std::uint64_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1'000'000;
+    const auto port = static_cast<unsigned short>(argc > 2 ? std::atoi(argv[2]) : 9310);
+
+    bench_ids(n);
+    bench_user(n);
+    bench_json(n);
+    bench_send(n, port);
+    bench_connect(std::max<std::uint64_t>(n / 1000, 100), static_cast<unsigned short>(port + 1));
+    return 0;
+}
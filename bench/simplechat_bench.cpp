@@ -0,0 +1,468 @@
+// End-to-end load generator for SimpleChat.
+//
+// Opens many WebSocket clients over loopback, spreads them across rooms, and
+// has one sender per room post chat messages at a fixed aggregate rate. Each
+// message carries its send time, so every receiver records the delivery
+// latency. Reports messages/s, latency percentiles, and the server's RSS.
+//
+// usage: simplechat_bench [--host 127.0.0.1] [--port 9002]
+//                         [--connections 1000] [--rooms 10]
+//                         [--rate 1000] [--size 64] [--wire json|binary]
+//                         [--threads N] [--warmup 2] [--duration 10]
+//                         [--server-pid PID | --spawn PATH [--spawn-threads N]]
+//
+// Each client sends create + join for its room ("bench-<k>"): the first
+// create wins, the rest get "room exists" and join it. A server that keeps
+// everyone in one room shows up as fan-out == connections.
+
+#include "LatencyHistogram.hpp"
+
+#include "protocol/BinaryCodec.h"
+#include "protocol/JsonIngress.h"
+#include "protocol/Wire.hpp"
+
+#include <boost/asio/connect.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/websocket.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace beast = boost::beast;
+namespace websocket = beast::websocket;
+namespace asio = boost::asio;
+using tcp = asio::ip::tcp;
+
+using simplechat::bench::LatencyHistogram;
+using simplechat::protocol::BinaryReader;
+using simplechat::protocol::BinaryWriter;
+using simplechat::protocol::MsgType;
+using simplechat::protocol::Wire;
+
+namespace {
+
+struct Config {
+    std::string host = "127.0.0.1";
+    unsigned short port = 9002;
+    unsigned connections = 1000;
+    unsigned rooms = 10;
+    double rate = 1000;         // messages/s across all senders
+    std::size_t size = 64;      // chat text bytes
+    Wire wire = Wire::Json;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    double warmup = 2;
+    double duration = 10;
+    pid_t server_pid = 0;
+    std::string spawn;
+    unsigned spawn_threads = 0;
+};
+
+std::uint64_t now_ns() {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+struct Shared {
+    Shared(const Config& c, std::uint64_t id) : cfg(c), run_id(id) {}
+
+    const Config& cfg;
+    const std::uint64_t run_id;
+
+    std::atomic<unsigned> connected{0};
+    std::atomic<unsigned> failed{0};
+    std::atomic<bool> measuring{false};
+    std::atomic<bool> stopping{false};
+    std::atomic<std::uint64_t> measure_start_ns{0};
+
+    std::atomic<std::uint64_t> sent{0};
+    std::atomic<std::uint64_t> received{0};
+    LatencyHistogram latency;
+};
+
+// Chat text: "b:<run>:<send_ns>:" padded to cfg.size.
+std::string make_text(const Shared& shared) {
+    std::string text = "b:" + std::to_string(shared.run_id) + ":" + std::to_string(now_ns()) + ":";
+    if (text.size() < shared.cfg.size) text.append(shared.cfg.size - text.size(), 'x');
+    return text;
+}
+
+// Returns the embedded send time if text came from this run.
+std::uint64_t parse_stamp(std::string_view text, std::uint64_t run_id) {
+    if (text.size() < 2 || text.substr(0, 2) != "b:") return 0;
+    text.remove_prefix(2);
+    const auto colon = text.find(':');
+    if (colon == std::string_view::npos) return 0;
+    if (std::strtoull(std::string(text.substr(0, colon)).c_str(), nullptr, 10) != run_id) return 0;
+    text.remove_prefix(colon + 1);
+    return std::strtoull(std::string(text.substr(0, text.find(':'))).c_str(), nullptr, 10);
+}
+
+class Client : public std::enable_shared_from_this<Client> {
+public:
+    Client(asio::io_context& ioc, Shared& shared, unsigned index, unsigned room)
+        : shared_(shared),
+          index_(index),
+          room_(room),
+          ws_(asio::make_strand(ioc)),
+          timer_(ws_.get_executor()) {}
+
+    void start(const tcp::resolver::results_type& endpoints, std::function<void()> done) {
+        done_ = std::move(done);
+        beast::get_lowest_layer(ws_).expires_after(std::chrono::seconds(30));
+        beast::get_lowest_layer(ws_).async_connect(
+            endpoints,
+            [self = shared_from_this()](beast::error_code ec, const tcp::endpoint&) {
+                if (ec) return self->fail("connect", ec);
+                self->handshake();
+            });
+    }
+
+    // Post one message per tick until stopped; absolute schedule, no drift.
+    void start_sending(std::chrono::nanoseconds interval, std::chrono::nanoseconds offset) {
+        interval_ = interval;
+        next_ = std::chrono::steady_clock::now() + offset;
+        asio::post(ws_.get_executor(), [self = shared_from_this()] { self->tick(); });
+    }
+
+    void stop() {
+        asio::post(ws_.get_executor(), [self = shared_from_this()] {
+            self->timer_.cancel();
+            beast::error_code ec;
+            beast::get_lowest_layer(self->ws_).socket().shutdown(tcp::socket::shutdown_both, ec);
+            beast::get_lowest_layer(self->ws_).close();
+        });
+    }
+
+private:
+    void handshake() {
+        beast::get_lowest_layer(ws_).expires_never();
+        ws_.set_option(websocket::stream_base::timeout::suggested(beast::role_type::client));
+
+        const auto proto = shared_.cfg.wire == Wire::Binary ? simplechat::protocol::kBinarySubprotocol
+                                                            : simplechat::protocol::kJsonSubprotocol;
+        ws_.set_option(websocket::stream_base::decorator(
+            [proto = std::string(proto)](websocket::request_type& req) {
+                req.set(beast::http::field::sec_websocket_protocol, proto);
+            }));
+
+        ws_.async_handshake(
+            shared_.cfg.host, "/",
+            [self = shared_from_this()](beast::error_code ec) {
+                if (ec) return self->fail("handshake", ec);
+                self->join();
+                self->shared_.connected.fetch_add(1);
+                self->read();
+                if (self->done_) std::exchange(self->done_, nullptr)();
+            });
+    }
+
+    void join() {
+        const std::string name = "bench-" + std::to_string(index_);
+        const std::string room = "bench-" + std::to_string(room_);
+        if (shared_.cfg.wire == Wire::Binary) {
+            write(BinaryWriter(MsgType::Create, 0, 0, room.size() + 4).str(room).take());
+            write(BinaryWriter(MsgType::Join, 0, 0, name.size() + room.size() + 8).str(name).str(room).take());
+        } else {
+            write("{\"type\":\"create\",\"room\":\"" + room + "\"}");
+            write("{\"type\":\"join\",\"user\":\"" + name + "\",\"room\":\"" + room + "\"}");
+        }
+    }
+
+    void tick() {
+        if (shared_.stopping.load(std::memory_order_relaxed)) return;
+
+        const std::string text = make_text(shared_);
+        if (shared_.cfg.wire == Wire::Binary) {
+            write(BinaryWriter(MsgType::Msg, 0, 0, text.size() + 4).str(text).take());
+        } else {
+            write("{\"type\":\"msg\",\"text\":\"" + text + "\"}");
+        }
+        if (shared_.measuring.load(std::memory_order_relaxed)) {
+            shared_.sent.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        next_ += interval_;
+        timer_.expires_at(next_);
+        timer_.async_wait([self = shared_from_this()](beast::error_code ec) {
+            if (!ec) self->tick();
+        });
+    }
+
+    void write(std::string frame) {
+        outbox_.push_back(std::move(frame));
+        if (outbox_.size() == 1) do_write();
+    }
+
+    void do_write() {
+        ws_.binary(shared_.cfg.wire == Wire::Binary);
+        ws_.async_write(
+            asio::buffer(outbox_.front()),
+            [self = shared_from_this()](beast::error_code ec, std::size_t) {
+                if (ec) return;
+                self->outbox_.pop_front();
+                if (!self->outbox_.empty()) self->do_write();
+            });
+    }
+
+    void read() {
+        ws_.async_read(
+            buffer_,
+            [self = shared_from_this()](beast::error_code ec, std::size_t) {
+                if (ec) return;
+                self->on_frame();
+                self->buffer_.consume(self->buffer_.size());
+                self->read();
+            });
+    }
+
+    void on_frame() {
+        const std::uint64_t received_at = now_ns();
+        const auto data = buffer_.cdata();
+        const std::string_view frame(static_cast<const char*>(data.data()), data.size());
+
+        std::string_view text;
+        if (shared_.cfg.wire == Wire::Binary) {
+            BinaryReader in(frame);
+            std::string_view from;
+            if (!in.ok() || in.header().type != MsgType::Chat || !in.str(from) || !in.str(text)) return;
+        } else {
+            const auto* obj = simplechat::protocol::JsonIngress::parse(frame);
+            if (!obj) return;
+            const auto type = simplechat::protocol::string_field(*obj, "type");
+            if (!type || *type != "msg") return;
+            const auto field = simplechat::protocol::string_field(*obj, "text");
+            if (!field) return;
+            text = *field;
+        }
+
+        const std::uint64_t sent_at = parse_stamp(text, shared_.run_id);
+        if (sent_at == 0 || !shared_.measuring.load(std::memory_order_relaxed)) return;
+        if (sent_at < shared_.measure_start_ns.load(std::memory_order_relaxed)) return;
+
+        shared_.received.fetch_add(1, std::memory_order_relaxed);
+        shared_.latency.record(received_at > sent_at ? received_at - sent_at : 0);
+    }
+
+    void fail(const char* what, beast::error_code ec) {
+        if (shared_.failed.fetch_add(1) < 5) {
+            std::cerr << "[client " << index_ << "] " << what << ": " << ec.message() << "\n";
+        }
+        if (done_) std::exchange(done_, nullptr)();
+    }
+
+    Shared& shared_;
+    const unsigned index_;
+    const unsigned room_;
+
+    websocket::stream<beast::tcp_stream> ws_;
+    beast::flat_buffer buffer_;
+    std::deque<std::string> outbox_;
+    std::function<void()> done_;
+
+    asio::steady_timer timer_;
+    std::chrono::steady_clock::time_point next_;
+    std::chrono::nanoseconds interval_{0};
+};
+
+// Resident set size in KiB (field = "VmRSS" or "VmHWM"), 0 if unavailable.
+long read_status_kb(pid_t pid, const char* field) {
+    std::ifstream in("/proc/" + std::to_string(pid) + "/status");
+    std::string line;
+    const std::size_t n = std::strlen(field);
+    while (std::getline(in, line)) {
+        if (line.compare(0, n, field) == 0 && line.size() > n && line[n] == ':') {
+            return std::strtol(line.c_str() + n + 1, nullptr, 10);
+        }
+    }
+    return 0;
+}
+
+void raise_fd_limit() {
+    rlimit lim{};
+    if (getrlimit(RLIMIT_NOFILE, &lim) == 0 && lim.rlim_cur < lim.rlim_max) {
+        lim.rlim_cur = lim.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &lim);
+    }
+}
+
+pid_t spawn_server(const Config& cfg) {
+    const pid_t pid = fork();
+    if (pid == 0) {
+        const std::string port = std::to_string(cfg.port);
+        const std::string threads = std::to_string(cfg.spawn_threads ? cfg.spawn_threads : cfg.threads);
+        execl(cfg.spawn.c_str(), cfg.spawn.c_str(), port.c_str(), threads.c_str(), static_cast<char*>(nullptr));
+        std::perror("exec");
+        _exit(127);
+    }
+    return pid;
+}
+
+bool wait_for_port(const Config& cfg, std::chrono::seconds timeout) {
+    asio::io_context ioc;
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (std::chrono::steady_clock::now() < deadline) {
+        tcp::socket s(ioc);
+        beast::error_code ec;
+        s.connect({asio::ip::make_address(cfg.host), cfg.port}, ec);
+        if (!ec) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    return false;
+}
+
+bool parse_args(int argc, char* argv[], Config& cfg) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        if (i + 1 >= argc) return false;
+        const char* v = argv[++i];
+
+        if (arg == "--host") cfg.host = v;
+        else if (arg == "--port") cfg.port = static_cast<unsigned short>(std::atoi(v));
+        else if (arg == "--connections") cfg.connections = static_cast<unsigned>(std::atoi(v));
+        else if (arg == "--rooms") cfg.rooms = static_cast<unsigned>(std::atoi(v));
+        else if (arg == "--rate") cfg.rate = std::atof(v);
+        else if (arg == "--size") cfg.size = static_cast<std::size_t>(std::atoi(v));
+        else if (arg == "--wire") cfg.wire = std::string_view(v) == "binary" ? Wire::Binary : Wire::Json;
+        else if (arg == "--threads") cfg.threads = static_cast<unsigned>(std::atoi(v));
+        else if (arg == "--warmup") cfg.warmup = std::atof(v);
+        else if (arg == "--duration") cfg.duration = std::atof(v);
+        else if (arg == "--server-pid") cfg.server_pid = static_cast<pid_t>(std::atoi(v));
+        else if (arg == "--spawn") cfg.spawn = v;
+        else if (arg == "--spawn-threads") cfg.spawn_threads = static_cast<unsigned>(std::atoi(v));
+        else return false;
+    }
+    cfg.rooms = std::max(1u, std::min(cfg.rooms, cfg.connections));
+    cfg.threads = std::max(1u, cfg.threads);
+    return cfg.connections > 0 && cfg.rate > 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Config cfg;
+    if (!parse_args(argc, argv, cfg)) {
+        std::cerr << "usage: " << argv[0]
+                  << " [--host H] [--port P] [--connections N] [--rooms R] [--rate MSG/S]"
+                     " [--size BYTES] [--wire json|binary] [--threads N] [--warmup S]"
+                     " [--duration S] [--server-pid PID | --spawn PATH [--spawn-threads N]]\n";
+        return 1;
+    }
+    raise_fd_limit();
+
+    if (!cfg.spawn.empty()) {
+        cfg.server_pid = spawn_server(cfg);
+        if (!wait_for_port(cfg, std::chrono::seconds(10))) {
+            std::cerr << "server did not start listening on " << cfg.port << "\n";
+            kill(cfg.server_pid, SIGTERM);
+            return 1;
+        }
+    }
+
+    Shared shared(cfg, std::random_device{}());
+    asio::io_context ioc(static_cast<int>(cfg.threads));
+    auto work = asio::make_work_guard(ioc);
+
+    std::vector<std::thread> pool;
+    for (unsigned i = 0; i < cfg.threads; ++i) pool.emplace_back([&] { ioc.run(); });
+
+    tcp::resolver resolver(ioc);
+    const auto endpoints = resolver.resolve(cfg.host, std::to_string(cfg.port));
+
+    // Round-robin rooms; the first client in each room is its sender.
+    std::vector<std::shared_ptr<Client>> clients;
+    clients.reserve(cfg.connections);
+    for (unsigned i = 0; i < cfg.connections; ++i) {
+        clients.push_back(std::make_shared<Client>(ioc, shared, i, i % cfg.rooms));
+    }
+
+    // Bounded connect concurrency so the accept backlog is not overrun.
+    const auto connect_started = std::chrono::steady_clock::now();
+    {
+        constexpr unsigned kInFlight = 256;
+        std::atomic<unsigned> next{0};
+        std::function<void()> launch = [&] {
+            const unsigned i = next.fetch_add(1);
+            if (i < clients.size()) clients[i]->start(endpoints, launch);
+        };
+        for (unsigned i = 0; i < std::min<unsigned>(kInFlight, cfg.connections); ++i) launch();
+
+        while (shared.connected + shared.failed < cfg.connections) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    const double connect_secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - connect_started).count();
+    std::printf("connected %u/%u in %.2f s (%u failed)\n",
+                shared.connected.load(), cfg.connections, connect_secs, shared.failed.load());
+
+    // Senders spread evenly over one interval so the load is not bursty.
+    const auto interval = std::chrono::nanoseconds(static_cast<std::int64_t>(1e9 * cfg.rooms / cfg.rate));
+    for (unsigned r = 0; r < cfg.rooms; ++r) {
+        clients[r]->start_sending(interval, interval * r / cfg.rooms);
+    }
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(cfg.warmup));
+    shared.measure_start_ns = now_ns();
+    shared.measuring = true;
+    const auto measure_started = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::duration<double>(cfg.duration));
+    shared.measuring = false;
+    const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - measure_started).count();
+
+    const long rss_kb = cfg.server_pid ? read_status_kb(cfg.server_pid, "VmRSS") : 0;
+    const long hwm_kb = cfg.server_pid ? read_status_kb(cfg.server_pid, "VmHWM") : 0;
+
+    shared.stopping = true;
+    for (auto& c : clients) c->stop();
+    work.reset();
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    ioc.stop();
+    for (auto& t : pool) t.join();
+
+    const auto sent = shared.sent.load();
+    const auto received = shared.received.load();
+    const auto& h = shared.latency;
+
+    std::printf("\n%u connections, %u rooms, %.0f msg/s offered, %zu B text, %s wire, %.1f s\n",
+                cfg.connections, cfg.rooms, cfg.rate, cfg.size,
+                cfg.wire == Wire::Binary ? "binary" : "json", secs);
+    std::printf("sent        %10llu  (%.0f msg/s)\n", static_cast<unsigned long long>(sent), sent / secs);
+    std::printf("delivered   %10llu  (%.0f msg/s, fan-out %.1f)\n",
+                static_cast<unsigned long long>(received), received / secs,
+                sent ? static_cast<double>(received) / sent : 0.0);
+    std::printf("latency us  p50 %.1f  p99 %.1f  p999 %.1f  max %.1f\n",
+                h.percentile(0.50) / 1e3, h.percentile(0.99) / 1e3,
+                h.percentile(0.999) / 1e3, h.max() / 1e3);
+    if (cfg.server_pid) {
+        std::printf("server rss  %.1f MiB  (peak %.1f MiB)\n", rss_kb / 1024.0, hwm_kb / 1024.0);
+    }
+
+    if (!cfg.spawn.empty()) {
+        kill(cfg.server_pid, SIGTERM);
+        waitpid(cfg.server_pid, nullptr, 0);
+    }
+    return 0;
+}
@@ -0,0 +1,53 @@
+// IDs per second per core: the old mutex + mt19937_64 + bitwise base32
+// generator against the per-thread Ulid generator.
+//
+// usage: simplechat_ulid_bench [iterations] [threads]
+
+#include "Bench.hpp"
+#include "LegacyIDGenerator.hpp"
+
+#include "chat/IDGenerator.hpp"
+#include "chat/Ulid.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+using simplechat::bench::do_not_optimize;
+using simplechat::bench::run;
+
+int main(int argc, char* argv[]) {
+    const std::uint64_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2'000'000;
+    const unsigned max_threads = argc > 2 ? static_cast<unsigned>(std::atoi(argv[2]))
+                                          : std::max(1u, std::thread::hardware_concurrency());
+
+    simplechat::bench::LegacyIDGenerator legacy;
+    simplechat::chat::IDGenerator idgen;
+
+    const auto sample = idgen.next();
+    const std::string text = sample.to_string();
+
+    for (unsigned threads : {1u, max_threads}) {
+        run("legacy userID() string", threads, n, [&](std::uint64_t) {
+            do_not_optimize(legacy.userID());
+        });
+        run("userID() string", threads, n, [&](std::uint64_t) {
+            do_not_optimize(idgen.userID());
+        });
+        run("next() binary Ulid", threads, n, [&](std::uint64_t) {
+            do_not_optimize(idgen.next());
+        });
+        if (threads == max_threads) break;
+    }
+
+    run("Ulid::encode", 1, n, [&](std::uint64_t) {
+        char out[simplechat::chat::Ulid::kStringSize];
+        sample.encode(out);
+        do_not_optimize(out);
+    });
+    run("Ulid::parse", 1, n, [&](std::uint64_t) {
+        do_not_optimize(simplechat::chat::Ulid::parse(text));
+    });
+    return 0;
+}
@@ -20,7 +20,7 @@ def run(cmd, cwd=None):
     subprocess.check_call(cmd, cwd=cwd)
 
 
-def build(build_type: str):
+def build(build_type: str, bench: bool = False):
     outdir = BUILD_DIR / build_type.lower()
     outdir.mkdir(parents=True, exist_ok=True)
 
@@ -29,7 +29,8 @@ def build(build_type: str):
         "cmake",
         "-S", str(ROOT),
         "-B", str(outdir),
-        f"-DCMAKE_BUILD_TYPE={build_type}"
+        f"-DCMAKE_BUILD_TYPE={build_type}",
+        f"-DSIMPLECHAT_BUILD_BENCH={'ON' if bench else 'OFF'}"
     ])
 
     run([
@@ -39,6 +40,19 @@ def build(build_type: str):
     ])
 
     print(f"=== Done: {outdir / 'SimpleChat'} ===\n")
+    return outdir
+
+
+# Release build + end-to-end load run against a freshly spawned server.
+# Extra arguments after "bench" go to simplechat_bench.
+def bench(extra_args):
+    outdir = build("Release", bench=True)
+    print("=== Load benchmark ===")
+    run([
+        str(outdir / "simplechat_bench"),
+        "--spawn", str(outdir / "SimpleChat"),
+        *extra_args
+    ])
 
 
 def main():
@@ -46,6 +60,10 @@ def main():
         build("Release")
         return
 
+    if sys.argv[1].lower() == "bench":
+        bench(sys.argv[2:])
+        return
+
     for arg in sys.argv[1:]:
         arg = arg.lower()
         if arg == "clean":
@@ -1,238 +1,1106 @@
 #include "networking/WebSocketServer.h"
-#include "networking/Session.hpp"
+#include "networking/ConnectionTable.hpp"
+#include "networking/Handoff.h"
+#include "chat/Presence.h"
 #include "chat/Room.h"
+#include "chat/Snapshot.h"
+#include "cluster/Cluster.h"
 #include "chat/User.h"
+#include "chat/UserDirectory.h"
 #include "chat/IDGenerator.hpp"
+#include "protocol/BinaryCodec.h"
+#include "protocol/JsonIngress.h"
+#include "protocol/Wire.hpp"
+#include "storage/MessageLog.h"
+#include "config/Config.h"
+#include "memory/Pool.h"
+#include "metrics/Metrics.h"
+#include "metrics/MetricsServer.h"
+#include "logging/Log.h"
 
 
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/signal_set.hpp>
-#include <boost/json.hpp> 
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/json.hpp>
 
-#include <unordered_set>
-#include <unordered_map>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
 
 namespace json = boost::json;
 
+using simplechat::protocol::BinaryReader;
+using simplechat::protocol::BinaryWriter;
+using simplechat::protocol::Command;
+using simplechat::protocol::JsonIngress;
+using simplechat::protocol::MsgType;
+using simplechat::protocol::Wire;
+
 
-static constexpr bool DEBUG_MODE = true;
 static constexpr std::string_view kLobbyRoomId = "room-lobby";
+static constexpr std::size_t kMaxListedRooms = 100;  // per "list" reply
+
+// "client-<ulid>": ids stay binary until they hit the wire.
+static std::string client_wire_id(const simplechat::networking::Session &sess) {
+    using simplechat::chat::IDGenerator;
+    return IDGenerator::format(IDGenerator::Kind::Client, sess.client_id);
+}
 
 static std::string guest_name(simplechat::networking::ClientId id) {
     return "guest-" + std::to_string(id);
 }
 
+// Serializes into a recycled frame buffer rather than a fresh string.
 static std::string dump(const json::object& obj) {
-    return json::serialize(obj);
+    std::string out = simplechat::memory::acquire_buffer(256);
+    json::serializer sr;
+    sr.reset(&obj);
+    while (!sr.done()) {
+        const std::size_t used = out.size();
+        out.resize(std::max(out.capacity(), used + 256));
+        out.resize(used + sr.read(&out[used], out.size() - used).size());
+    }
+    return out;
 }
 
-static void send_debug(simplechat::networking::WebSocketServer &server,
-                       simplechat::networking::ClientId id,
-                       const json::object &payload) {
-    if constexpr (DEBUG_MODE){
-        server.send(id, dump(payload));
+// Sends one event to one client in its wire format; only the needed encoder runs.
+template <class ToJson, class ToBinary>
+static void send_to(simplechat::networking::WebSocketServer &server,
+                    simplechat::networking::ClientId id, Wire wire,
+                    ToJson &&to_json, ToBinary &&to_binary) {
+    if (wire == Wire::Binary) {
+        server.send(id, simplechat::networking::make_payload(to_binary(), true));
+    } else {
+        server.send(id, simplechat::networking::make_payload(dump(to_json())));
     }
 }
 
-int main() {
+// Encode once per wire format present in the room (outside the room lock),
+// then fan out to the members.
+template <class ToJson, class ToBinary>
+static void broadcast_room(simplechat::networking::WebSocketServer &server,
+                           const simplechat::chat::Room &room,
+                           ToJson &&to_json, ToBinary &&to_binary) {
+    using simplechat::networking::make_payload;
+    using simplechat::networking::Payload;
+
+    const auto counts = room.wire_counts();
+    Payload text = counts[0] ? make_payload(dump(to_json())) : nullptr;
+    Payload binary = counts[1] ? make_payload(to_binary(), true) : nullptr;
+
+    room.with_members([&](const std::vector<simplechat::networking::ClientId> &json_members,
+                          const std::vector<simplechat::networking::ClientId> &binary_members) {
+        if (text) server.broadcast(json_members, text);
+        if (binary) server.broadcast(binary_members, binary);
+    });
+}
+
+// Records entry in the room's history (and the on-disk log, if any) and
+// fans it out to the local members.
+static void deliver_room(simplechat::networking::WebSocketServer &server,
+                         simplechat::storage::MessageLog *log,
+                         simplechat::chat::Room &room,
+                         simplechat::chat::HistoryEntry entry) {
+    const auto frames = entry.frames;
+    // Framed and checksummed before the room lock is taken.
+    std::optional<simplechat::storage::MessageLog::Record> record;
+    if (log) record = simplechat::storage::MessageLog::frame(room.room_id(), frames[0]->data(), frames[1]->data());
+
+    room.record(std::move(entry),
+                [&](const std::vector<simplechat::networking::ClientId> &json_members,
+                    const std::vector<simplechat::networking::ClientId> &binary_members) {
+        server.broadcast(json_members, frames[0]);
+        server.broadcast(binary_members, frames[1]);
+        // Under the room lock so the log keeps the room's order; this is
+        // only a copy.
+        if (record) log->append(*record);
+    });
+}
+
+// Like broadcast_room, but the message is also kept in the room's history
+// and forwarded to the cluster, so both encodings are built regardless of
+// who is in the room right now.
+template <class ToJson, class ToBinary>
+static void publish_room(simplechat::networking::WebSocketServer &server,
+                         simplechat::storage::MessageLog *log,
+                         simplechat::cluster::Cluster *cluster,
+                         simplechat::chat::Room &room,
+                         ToJson &&to_json, ToBinary &&to_binary) {
+    using simplechat::networking::make_payload;
+
+    simplechat::chat::HistoryEntry entry;
+    entry.frames[0] = make_payload(dump(to_json()));
+    entry.frames[1] = make_payload(to_binary(), true);
+
+    if (cluster) cluster->publish(room.room_id(), entry.frames[0], entry.frames[1]);
+    deliver_room(server, log, room, std::move(entry));
+}
+
+// One presence frame for a room's joins and leaves since the last tick.
+// Rooms with more than names_max members only hear the counts.
+static void broadcast_presence(simplechat::networking::WebSocketServer &server,
+                               const simplechat::chat::Room &room,
+                               const simplechat::chat::PresenceDiff &diff, std::size_t names_max) {
+    const std::size_t members = room.size();
+    const bool names = members <= names_max;
+
+    broadcast_room(server, room,
+        [&] {
+            json::object obj{{"type", "presence"}, {"room_id", room.room_id()}, {"members", members},
+                             {"joined_count", diff.joined.size()}, {"left_count", diff.left.size()}};
+            if (names) {
+                auto to_array = [](const std::vector<simplechat::chat::PresenceEvent> &events) {
+                    json::array out;
+                    out.reserve(events.size());
+                    for (const auto &e : events) out.push_back(json::object{{"user_id", e.user_id}, {"name", e.name}});
+                    return out;
+                };
+                obj["joined"] = to_array(diff.joined);
+                obj["left"] = to_array(diff.left);
+            }
+            return obj;
+        },
+        [&] {
+            // members, joined count, left count, then (user_id, name) per
+            // joined and per left member unless counts-only.
+            const std::size_t listed = names ? diff.joined.size() + diff.left.size() : 0;
+            BinaryWriter out(MsgType::Presence, room.handle(), 0, 48 + listed * 64);
+            out.str(std::to_string(members))
+               .str(std::to_string(diff.joined.size()))
+               .str(std::to_string(diff.left.size()));
+            if (names) {
+                for (const auto &e : diff.joined) out.str(e.user_id).str(e.name);
+                for (const auto &e : diff.left) out.str(e.user_id).str(e.name);
+            }
+            return out.take();
+        });
+}
+
+// Tells a client which room it is now in, and how many are there.
+static void send_room(simplechat::networking::WebSocketServer &server,
+                      simplechat::networking::ClientId id, Wire wire,
+                      const simplechat::chat::Room &room, std::uint32_t user_handle) {
+    const std::size_t members = room.size();
+    send_to(server, id, wire,
+        [&] {
+            return json::object{{"type", "room"}, {"room_id", room.room_id()}, {"members", members}};
+        },
+        [&] {
+            const std::string count = std::to_string(members);
+            return BinaryWriter(MsgType::Room, room.handle(), user_handle,
+                                room.room_id().size() + count.size() + 8)
+                .str(room.room_id())
+                .str(count)
+                .take();
+        });
+}
+
+// Which user a connection acts as, in reply to a join that presented a
+// resume token (whether or not the token was accepted).
+static void send_identity(simplechat::networking::WebSocketServer &server,
+                          simplechat::networking::ClientId id, Wire wire,
+                          const simplechat::chat::UserDirectory::Identity &who) {
+    using simplechat::chat::IDGenerator;
+    const std::string user_id = IDGenerator::format(IDGenerator::Kind::User, who.profile->id());
+    const std::string name = who.profile->name();
+    send_to(server, id, wire,
+        [&] {
+            return json::object{{"type", "identity"}, {"user_id", user_id}, {"name", name},
+                                {"token", who.token}, {"sessions", who.sessions}};
+        },
+        [&] {
+            return BinaryWriter(MsgType::Identity, 0, who.handle,
+                                user_id.size() + name.size() + who.token.size() + 32)
+                .str(user_id)
+                .str(name)
+                .str(who.token)
+                .str(std::to_string(who.sessions))
+                .take();
+        });
+}
+
+static void send_error(simplechat::networking::WebSocketServer &server,
+                       simplechat::networking::ClientId id, Wire wire,
+                       std::string_view text) {
+    send_to(server, id, wire,
+        [&] { return json::object{{"type","error"}, {"text", text}}; },
+        [&] { return BinaryWriter(MsgType::Error, 0, 0, text.size() + 4).str(text).take(); });
+}
+
+// Sender-only debug echo. Off in production: one branch, nothing encoded or sent.
+template <class ToJson, class ToBinary>
+static void send_debug(simplechat::networking::WebSocketServer &server, bool enabled,
+                       simplechat::networking::ClientId id, Wire wire,
+                       ToJson &&to_json, ToBinary &&to_binary) {
+    if (!enabled) return;
+    send_to(server, id, wire, std::forward<ToJson>(to_json), std::forward<ToBinary>(to_binary));
+}
+
+// usage: SimpleChat [--config FILE] [--key value ...] [port] [threads] [data_dir] [metrics_port]
+// See config::print_usage (--help) for the keys.
+int main(int argc, char* argv[]) {
     using namespace simplechat::networking;
 
-    boost::asio::io_context ioc;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            simplechat::config::print_usage(std::cout, argv[0]);
+            return 0;
+        }
+    }
+
+    simplechat::config::ServerConfig config;
+    try {
+        config = simplechat::config::load(argc, argv);
+    } catch (const simplechat::config::ConfigError& e) {
+        std::cerr << argv[0] << ": " << e.what() << "\n";
+        simplechat::config::print_usage(std::cerr, argv[0]);
+        return 1;
+    }
+
+    simplechat::logging::set_level(config.log_level);
+
+    const unsigned threads = config.threads ? config.threads
+                                            : std::max(1u, std::thread::hardware_concurrency());
+    const bool debug = config.debug;
+
+    boost::asio::io_context ioc(static_cast<int>(threads));
+
+    simplechat::metrics::Registry metrics;
+    auto& parse_errors = metrics.counter("simplechat_parse_errors_total",
+                                         "Client messages rejected as malformed or unknown");
+    auto& client_limited = metrics.counter("simplechat_ratelimit_client_frames_total",
+                                           "Frames shed by the per-connection rate limit");
+    auto& client_limited_bytes = metrics.counter("simplechat_ratelimit_client_bytes_total",
+                                                 "Bytes shed by the per-connection rate limit");
+    auto& room_limited = metrics.counter("simplechat_ratelimit_room_frames_total",
+                                         "Chat messages shed by the per-room rate limit");
+    auto& room_limited_bytes = metrics.counter("simplechat_ratelimit_room_bytes_total",
+                                               "Chat text bytes shed by the per-room rate limit");
+    auto& live_rooms = metrics.gauge("simplechat_rooms", "Chat rooms currently open");
+    auto& online_users = metrics.gauge("simplechat_users", "Users with at least one open session");
+    auto& direct_messages = metrics.counter("simplechat_direct_messages_total",
+                                            "Direct messages delivered to an online user");
+    auto& presence_events = metrics.counter("simplechat_presence_events_total",
+                                            "Joins and leaves queued for presence frames");
+    auto& presence_frames = metrics.counter("simplechat_presence_frames_total",
+                                            "Presence frames broadcast (one per changed room per tick)");
 
     simplechat::chat::IDGenerator idgen;
 
-    std::unordered_set<ClientId> clients;
-    std::unordered_map<ClientId, simplechat::networking::Session> sessions;
-    std::unordered_map<std::string, simplechat::chat::User> users;
+    // Callbacks run concurrently on the io threads (serialized per client by
+    // its strand). Each connection's row is only touched by its own client.
+    simplechat::chat::RoomRegistry rooms(config.history, config.room_rate);
+    ConnectionTable connections;
+    // user -> open sessions, for direct messages and multi-tab users.
+    simplechat::chat::UserDirectory users;
 
-    unsigned short port = 9002;
-    WebSocketServer server(ioc, port);
+    // The lobby is pinned; every other room goes away with its last member.
+    const simplechat::chat::RoomHandle lobby = rooms.intern(kLobbyRoomId, true);
 
-    server.set_on_connect([&](ClientId client_id) {
-        clients.insert(client_id);
+    // A running process on the same handoff socket gives up its listener,
+    // rooms and users; it has already closed its log and other listeners.
+    std::optional<Handoff> predecessor;
+    if (!config.handoff_socket.empty()) {
+        try {
+            predecessor = Handoff::take_over(config.handoff_socket);
+        } catch (const std::system_error& e) {
+            simplechat::logging::error("main", "handoff: {}", e.what());
+            simplechat::logging::shutdown();
+            return 1;
+        }
+    }
 
-        simplechat::chat::User user{idgen, "guest", std::string(kLobbyRoomId)};
-        const std::string user_id = user.user_id();
-        users.emplace(user_id, std::move(user));
+    // Rebuild room history from the log before accepting anyone. Frames are
+    // stored as sent, so this is a copy per record, not a re-encode.
+    std::unique_ptr<simplechat::storage::MessageLog> log;
+    if (!config.data_dir.empty()) {
+        simplechat::storage::LogOptions log_options;
+        log_options.dir = config.data_dir;
+        log = std::make_unique<simplechat::storage::MessageLog>(log_options);
 
-        Session sess;
-        sess.client_id = idgen.clientID();
-        sess.user_id   = user_id;
-        sess.room_id   = std::string(kLobbyRoomId);
+        const auto started = std::chrono::steady_clock::now();
+        const std::size_t restored = log->recover([&](const simplechat::storage::LogRecord &rec) {
+            auto& room = rooms.at(rooms.intern(rec.room_id));
 
-        sessions.emplace(client_id, std::move(sess));
+            // Handles are per-process; the previous one's users are gone.
+            std::string binary(rec.binary);
+            simplechat::protocol::set_room_handle(binary, room.handle());
+            simplechat::protocol::set_user_handle(binary, 0);
 
-        auto& current_session = sessions.at(client_id);
-        auto& current_user = users.at(current_session.user_id);
+            simplechat::chat::HistoryEntry entry;
+            entry.frames[0] = make_payload(std::string(rec.json));
+            entry.frames[1] = make_payload(std::move(binary), true);
+            room.restore(std::move(entry));
+        });
+        const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - started).count();
+        simplechat::logging::info("main", "restored {} messages from {} in {} ms",
+                                  restored, config.data_dir, ms);
 
-        // 3) Welcome message (to this client only)
-        server.send(client_id, dump({
-            {"type", "system"},
-            {"text", "welcome to SimpleChat"},
-            {"client_id", current_session.client_id},
-            {"user_id", current_user.user_id()},
-            {"room_id", current_session.room_id}
-        }));
-
-        // 4) Notify everyone in lobby
-        json::object evt{
-            {"type", "system"},
-            {"text", current_user.name() + " joined lobby"},
-            {"user_id", current_user.user_id()},
-            {"room_id", current_session.room_id}
-        };
+        log->start();
+    }
+    std::size_t restored_users = 0;
+    if (predecessor) {
+        try {
+            const auto restored = simplechat::chat::decode_state(predecessor->state(), rooms, users);
+            restored_users = restored.users;
+            simplechat::logging::info("main", "took over {} rooms ({} messages) and {} users from the previous process",
+                                      restored.rooms, restored.messages, restored.users);
+        } catch (const std::runtime_error& e) {
+            simplechat::logging::error("main", "handoff: {}", e.what());
+            simplechat::logging::shutdown();
+            return 1;
+        }
+    }
+    live_rooms.set(static_cast<std::int64_t>(rooms.size()));
 
-        for (ClientId c : clients) {
-            auto it = sessions.find(c);
-            if (it != sessions.end() && it->second.room_id == current_session.room_id) {
-                server.send(c, dump(evt));
+    // Restored rooms start with no members and restored users with no
+    // sessions, so no leave would ever tear them down; the ones nobody has
+    // come back to by now go, except rooms that still have history to replay.
+    boost::asio::steady_timer restore_reaper(ioc);
+    if (rooms.size() > 1 || restored_users > 0) {
+        restore_reaper.expires_after(config.restore_grace);
+        restore_reaper.async_wait([&](const boost::system::error_code& ec) {
+            if (ec) return;
+            const std::size_t reaped = rooms.reap();
+            live_rooms.set(static_cast<std::int64_t>(rooms.size()));
+            if (reaped) simplechat::logging::info("main", "dropped {} restored rooms with no members or history", reaped);
+            if (const std::size_t gone = users.reap()) {
+                simplechat::logging::info("main", "dropped {} handed-over users nobody resumed", gone);
             }
-        }
+        });
+    }
+
+    // Other nodes' messages for rooms with members here. Peers only send
+    // what this node subscribed to, but the room may have emptied since.
+    std::unique_ptr<simplechat::cluster::Cluster> cluster;
+    if (config.cluster_port != 0) {
+        simplechat::cluster::ClusterOptions cluster_options;
+        cluster_options.node_name = config.node_name;
+        cluster_options.address = config.cluster_address;
+        cluster_options.port = config.cluster_port;
+        cluster_options.peers = config.cluster_peers;
+        cluster_options.metrics = &metrics;
+        cluster = std::make_unique<simplechat::cluster::Cluster>(ioc, std::move(cluster_options));
+    }
+
+    // Membership changes that matter to the cluster: first member in, last out.
+    auto joined = [&](const simplechat::chat::Room &room) {
+        if (cluster) cluster->joined(room.room_id());
+    };
+    auto left = [&](const simplechat::chat::Room &room) {
+        if (cluster) cluster->left(room.room_id());
+    };
+
+    WebSocketServer::Options options;
+    options.metrics = &metrics;
+    options.max_queue_bytes = config.max_queue_bytes;
+    options.max_queue_messages = config.max_queue_messages;
+    options.overflow = config.overflow;
+    options.write_high_water = config.write_high_water;
+    options.ping_interval = config.ping_interval;
+    options.idle_timeout = config.idle_timeout;
+    options.deflate = config.deflate;
+    options.subprotocols = {std::string(simplechat::protocol::kBinarySubprotocol),
+                            std::string(simplechat::protocol::kJsonSubprotocol)};
+    if (predecessor) options.listen_fd = predecessor->release_listener();
+    WebSocketServer server(ioc, config.port, options);
+
+    // Set once a handoff starts: chat is refused from then on, since the log
+    // and cluster are released to the successor. Cleared if it fails.
+    std::atomic<bool> handing_off{false};
+    // Set once this process has handed off and is closing its clients.
+    std::atomic<bool> draining{false};
+
+    // Joins and leaves are batched per room and flushed every
+    // presence_window from one strand; rooms gone by then are skipped.
+    simplechat::chat::PresenceBatcher presence;
+    auto presence_strand = boost::asio::make_strand(ioc);
+    boost::asio::steady_timer presence_timer(presence_strand);
+
+    auto flush_presence = [&] {
+        presence.take([&](const std::string &room_id, const simplechat::chat::PresenceDiff &diff) {
+            rooms.visit(room_id, [&](simplechat::chat::Room &room) {
+                broadcast_presence(server, room, diff, config.presence_names_max);
+                presence_frames.inc();
+            });
+        });
+    };
+
+    // Called from the join/create/leave paths with the registry or room lock
+    // held. That is safe: the batcher's shard lock is a leaf, and take()
+    // releases it before flush_presence takes the registry lock. A zero
+    // window posts the flush to the strand, never runs it here.
+    auto announce = [&](bool joining, const simplechat::chat::Room &room,
+                        std::string user_id, std::string name) {
+        if (joining) presence.joined(room.room_id(), std::move(user_id), std::move(name));
+        else presence.left(room.room_id(), std::move(user_id), std::move(name));
+        presence_events.inc();
+        if (config.presence_window.count() == 0) boost::asio::post(presence_strand, flush_presence);
+    };
+
+    if (cluster) {
+        cluster->set_on_publish([&](std::string_view room_id, std::string_view json_frame,
+                                    std::string_view binary_frame) {
+            rooms.visit(room_id, [&](simplechat::chat::Room &room) {
+                // The origin's handles mean nothing here.
+                std::string binary = simplechat::memory::acquire_buffer(binary_frame.size());
+                binary.assign(binary_frame);
+                simplechat::protocol::set_room_handle(binary, room.handle());
+                simplechat::protocol::set_user_handle(binary, 0);
+
+                std::string text = simplechat::memory::acquire_buffer(json_frame.size());
+                text.assign(json_frame);
+
+                simplechat::chat::HistoryEntry entry;
+                entry.frames[0] = make_payload(std::move(text));
+                entry.frames[1] = make_payload(std::move(binary), true);
+                deliver_room(server, log.get(), room, std::move(entry));
+            });
+        });
+    }
+
+    server.set_on_connect([&](ClientId client_id) {
+        auto conn = connections.insert(client_id, Session{
+            idgen.next(),
+            simplechat::chat::User{idgen, "guest", std::string(kLobbyRoomId)},
+            simplechat::chat::Throttle(config.client_rate)});
+        if (!conn) return;  // never for an id the server handed out
 
+        conn.room()        = lobby;
+        conn.wire()        = simplechat::protocol::wire_of(server.subprotocol(client_id));
+
+        auto& current_session = conn.session();
+        auto& current_user = current_session.user;
+        auto& room = rooms.at(conn.room());
+
+        // Every connection starts as a user of its own; presenting that
+        // user's token on another connection attaches it too (see on_join).
+        const auto identity = users.add(current_user.profile(), client_id, conn.wire());
+        const std::string& token = identity.token;
+        conn.user_handle() = identity.handle;
+        online_users.set(static_cast<std::int64_t>(users.size()));
+
+        // 3) Welcome message (to this client only)
+        send_to(server, client_id, conn.wire(),
+            [&] {
+                return json::object{
+                    {"type", "system"},
+                    {"text", "welcome to SimpleChat"},
+                    {"client_id", client_wire_id(current_session)},
+                    {"user_id", current_user.user_id()},
+                    {"room_id", room.room_id()},
+                    {"token", token}
+                };
+            },
+            [&] {
+                return BinaryWriter(MsgType::Welcome, room.handle(), conn.user_handle(), 128 + token.size())
+                    .str(client_wire_id(current_session))
+                    .str(current_user.user_id())
+                    .str(room.room_id())
+                    .str("welcome to SimpleChat")
+                    .str(token)
+                    .take();
+            });
+
+        // Catch up on recent messages (shared frames, one batch), then go live.
+        room.add(client_id, conn.wire(),
+                 [&](std::vector<Payload> &frames) { server.send(client_id, std::move(frames)); });
+        joined(room);
+
+        // Presence waits for the first join, once the client has said who it
+        // is: a connection resuming a user never shows up as a guest.
     });
 
     server.set_on_disconnect([&](ClientId client_id) {
-        
-        std::string room_id = "room-lobby";
-        std::string username = "guest";
 
-        auto session_iterator = sessions.find(client_id);
-        if (session_iterator != sessions.end()) {
-            room_id = session_iterator->second.room_id;
+        const auto conn = connections.find(client_id);
+        if (!conn) return;
+
+        const simplechat::chat::RoomHandle room_handle = conn.room();
+        const auto& user = conn.session().user;
+        std::string user_id = user.user_id();
+        std::string username = user.name();
+        // Other sessions of the user still in the room keep it there.
+        const bool last_in_room = users.leave_room(user.id(), room_handle, client_id);
+        users.detach(user.id(), client_id);
+        online_users.set(static_cast<std::int64_t>(users.size()));
+        connections.erase(client_id);
+
+        rooms.leave(room_handle, client_id, [&](simplechat::chat::Room &room) {
+            left(room);
+            // Everyone is leaving for the new process; nobody needs telling.
+            if (!last_in_room || draining.load(std::memory_order_relaxed)) return;
+            announce(false, room, std::move(user_id), std::move(username));
+        });
+        live_rooms.set(static_cast<std::int64_t>(rooms.size()));
+    });
+
+    // ---- Commands (shared by both wire formats) ----
+
+    // History replay for a client entering a room, as one batch.
+    auto replay_to = [&](ClientId id) {
+        return [&server, id](std::vector<Payload> &frames) { server.send(id, std::move(frames)); };
+    };
 
-            auto user_iterator = users.find(session_iterator->second.user_id);
-            if (user_iterator != users.end()) username = user_iterator->second.name();
+    // Moves conn out of its current room into target, which it has already
+    // joined (so target cannot be torn down meanwhile). Both are O(1)
+    // membership updates; the old room goes away if this emptied it.
+    // Presence is per user: only its first session in a room announces a
+    // join, only its last a leave.
+    auto enter_room = [&](ConnectionTable::Row conn, simplechat::chat::Room& target) {
+        const ClientId id = conn.id();
+        auto& user = conn.session().user;
+
+        joined(target);
+        const bool last_in_old = users.leave_room(user.id(), conn.room(), id);
+        rooms.leave(conn.room(), id, [&](simplechat::chat::Room &old) {
+            left(old);
+            if (last_in_old) announce(false, old, user.user_id(), user.name());
+        });
+        conn.room() = target.handle();
+        user.set_room(target.room_id());
+        live_rooms.set(static_cast<std::int64_t>(rooms.size()));
+
+        send_room(server, id, conn.wire(), target, conn.user_handle());
+        if (users.enter_room(user.id(), target.handle(), id)) {
+            announce(true, target, user.user_id(), user.name());
+        }
+    };
+
+    // Switches conn from its current user to the one token names, sharing
+    // its profile with the user's other sessions. The old user is dropped
+    // if this was its only session; the caller announces the new one.
+    auto claim_user = [&](ConnectionTable::Row conn, simplechat::chat::Room& room, std::string_view token) {
+        auto& user = conn.session().user;
+        auto identity = users.attach(token, conn.id(), conn.wire());
+        if (!identity) return;
+        if (identity->profile->id() == user.id()) {
+            users.detach(user.id(), conn.id());  // already this user; undo the second attach
+            return;
         }
 
-        clients.erase(client_id);
-        sessions.erase(client_id);
-        // NOTE: don't erase user blindly if you later allow multiple sessions/user
-        // For now (1 session/user), you can erase user too:
-        if (session_iterator != sessions.end()) users.erase(session_iterator->second.user_id);
+        // Only a guest that was announced needs its leave announced.
+        if (users.leave_room(user.id(), conn.room(), conn.id())) {
+            announce(false, room, user.user_id(), user.name());
+        }
+        users.detach(user.id(), conn.id());
+        user = simplechat::chat::User(std::move(identity->profile), user.room());
+        conn.user_handle() = identity->handle;
+        online_users.set(static_cast<std::int64_t>(users.size()));
+    };
+
+    auto on_join = [&](ConnectionTable::Row conn, simplechat::chat::Room& room,
+                       std::optional<std::string_view> name,
+                       std::optional<std::string_view> room_name,
+                       std::optional<std::string_view> token) {
+        const ClientId id = conn.id();
+        auto& sess = conn.session();
+        auto& user = sess.user;
 
-        json::object evt{{"type","system"},
-                        {"text", username + " left " + room_id},
-                        {"room_id", room_id}};
+        if (token) claim_user(conn, room, *token);
+        // Every session of the user shares the profile, so they all pick
+        // the new name up.
+        if (name) user.set_name(std::string(*name));
+        if (token) {
+            if (auto who = users.find(user.id())) send_identity(server, id, conn.wire(), *who);
+        }
 
-        for (auto c : clients) {
-            auto it = sessions.find(c);
-            if (it != sessions.end() && it->second.room_id == room_id) {
-                server.send(c, dump(evt));
+        send_debug(server, debug, id, conn.wire(),
+            [&] {
+                return json::object{
+                    {"type", "debug_join"},
+                    {"client_id", client_wire_id(sess)},
+                    {"user_id", user.user_id()},
+                    {"name", user.name()},
+                    {"room_id", room.room_id()}
+                };
+            },
+            [&] {
+                return BinaryWriter(MsgType::DebugJoin, room.handle(), conn.user_handle(), user.name().size() + 4)
+                    .str(user.name())
+                    .take();
+            });
+
+        if (room_name) {
+            const std::string target_id = simplechat::chat::room_id_of(*room_name);
+            if (target_id.empty()) {
+                send_error(server, id, conn.wire(), "invalid room");
+                return;
             }
-        } 
-    });
+            if (target_id != room.room_id()) {
+                auto* target = rooms.join(target_id, id, conn.wire(), replay_to(id));
+                // A room that only exists on other nodes so far opens here
+                // on first join; its history starts with the next message.
+                if (!target && cluster && cluster->remote_interest(target_id)) {
+                    target = rooms.create(target_id, id, conn.wire());
+                    if (!target) target = rooms.join(target_id, id, conn.wire(), replay_to(id));
+                }
+                if (!target) {
+                    send_error(server, id, conn.wire(), "unknown room");
+                    return;
+                }
+                enter_room(conn, *target);
+                return;
+            }
+        }
 
-    server.set_on_message([&](ClientId id, const std::string &msg) {
-        auto sit = sessions.find(id);
-        if (sit == sessions.end()) {
-            server.send(id, dump({{"type","error"}, {"text","unknown session"}}));
-            return;
+        // Staying put: announced if this is the user's first session here.
+        // A rename from a session already in the room is not a join; the
+        // others see the new name on its next message.
+        if (users.enter_room(user.id(), room.handle(), id)) {
+            announce(true, room, user.user_id(), user.name());
         }
-        auto& sess = sit->second;
-    
-        auto uit = users.find(sess.user_id);
-        if (uit == users.end()) {
-            server.send(id, dump({{"type","error"}, {"text","unknown user"}}));
+    };
+
+    // Without a name the room gets a generated "room-<ulid>" id.
+    auto on_create = [&](ConnectionTable::Row conn, std::optional<std::string_view> room_name) {
+        const std::string room_id = room_name ? simplechat::chat::room_id_of(*room_name) : idgen.roomID();
+        if (room_id.empty()) {
+            send_error(server, conn.id(), conn.wire(), "invalid room");
             return;
         }
-        auto& user = uit->second;
-    
-        json::value v;
-        try {
-            v = json::parse(msg);
-        } catch (...) {
-            server.send(id, dump({{"type","error"}, {"text","invalid json"}}));
+
+        auto* room = cluster && cluster->remote_interest(room_id)
+                         ? nullptr
+                         : rooms.create(room_id, conn.id(), conn.wire());
+        if (!room) {
+            send_error(server, conn.id(), conn.wire(), "room exists");
             return;
         }
-    
-        auto* obj = v.if_object();
-        if (!obj || !obj->if_contains("type")) {
-            server.send(id, dump({{"type","error"}, {"text","missing type"}}));
+        enter_room(conn, *room);
+    };
+
+    // Leaving a room means going back to the lobby.
+    auto on_leave = [&](ConnectionTable::Row conn) {
+        if (conn.room() == lobby) {
+            send_error(server, conn.id(), conn.wire(), "already in lobby");
             return;
         }
-    
-        std::string type = json::value_to<std::string>((*obj)["type"]);
-    
-        if (type == "join") {
-            // Only allow setting display name for now
-            if (obj->if_contains("user")) {
-                user.set_name(json::value_to<std::string>((*obj)["user"]));
+        // The lobby is pinned, so this always finds it.
+        auto* target = rooms.join(kLobbyRoomId, conn.id(), conn.wire(), replay_to(conn.id()));
+        enter_room(conn, *target);
+    };
+
+    auto on_list = [&](ConnectionTable::Row conn) {
+        const auto listing = rooms.list(kMaxListedRooms);
+        const std::size_t total = rooms.size();
+
+        send_to(server, conn.id(), conn.wire(),
+            [&] {
+                json::array list;
+                list.reserve(listing.size());
+                for (const auto& r : listing) {
+                    list.push_back(json::object{{"room_id", r.room_id}, {"members", r.members}});
+                }
+                return json::object{{"type", "rooms"}, {"total", total}, {"rooms", std::move(list)}};
+            },
+            [&] {
+                BinaryWriter out(MsgType::Rooms, 0, conn.user_handle(), 16 + listing.size() * 48);
+                out.str(std::to_string(total));
+                for (const auto& r : listing) out.str(r.room_id).str(std::to_string(r.members));
+                return out.take();
+            });
+    };
+
+    // Straight to the target's sessions (and the sender's other ones): no
+    // room is involved, so only the two users' connections pay for it.
+    // Once a handoff starts, the log and cluster belong to the successor:
+    // the sender is told to resend after reconnecting.
+    auto refuse_while_handing_off = [&](ConnectionTable::Row conn) {
+        if (!handing_off.load(std::memory_order_acquire)) return false;
+        send_error(server, conn.id(), conn.wire(), "server restarting; resend after reconnecting");
+        return true;
+    };
+
+    auto on_dm = [&](ConnectionTable::Row conn, std::string_view to, std::string_view text) {
+        if (refuse_while_handing_off(conn)) return;
+        auto& user = conn.session().user;
+
+        constexpr std::string_view kUserPrefix = "user-";
+        if (to.substr(0, kUserPrefix.size()) == kUserPrefix) to.remove_prefix(kUserPrefix.size());
+        const auto target = simplechat::chat::Ulid::parse(to);
+
+        // Encoded at most once per wire format across both users' sessions.
+        Payload json_frame, binary_frame;
+        auto deliver = [&](const std::vector<ClientId> &json_sessions,
+                           const std::vector<ClientId> &binary_sessions) {
+            using simplechat::chat::IDGenerator;
+            if (!json_sessions.empty()) {
+                if (!json_frame) {
+                    json_frame = make_payload(dump(json::object{
+                        {"type", "dm"},
+                        {"from", user.name()},
+                        {"user_id", user.user_id()},
+                        {"to", IDGenerator::format(IDGenerator::Kind::User, *target)},
+                        {"text", text}}));
+                }
+                server.broadcast(json_sessions, json_frame);
             }
-    
-            // Debug reply (sender-only)
-            server.send(id, dump({
-                {"type", "debug_join"},
-                {"client_id", sess.client_id},
-                {"user_id", user.user_id()},
-                {"name", user.name()},
-                {"room_id", sess.room_id}
-            }));
-    
-            json::object evt{
-                {"type","system"},
-                {"text", user.name() + " joined " + sess.room_id},
-                {"user_id", user.user_id()},
-                {"room_id", sess.room_id}
-            };
-    
-            for (auto c : clients) {
-                auto it = sessions.find(c);
-                if (it != sessions.end() && it->second.room_id == sess.room_id) {
-                    server.send(c, dump(evt));
+            if (!binary_sessions.empty()) {
+                if (!binary_frame) {
+                    const std::string from_id = user.user_id();
+                    const std::string to_id = IDGenerator::format(IDGenerator::Kind::User, *target);
+                    binary_frame = make_payload(
+                        BinaryWriter(MsgType::Direct, 0, conn.user_handle(),
+                                     user.name().size() + from_id.size() + to_id.size() + text.size() + 16)
+                            .str(user.name())
+                            .str(from_id)
+                            .str(to_id)
+                            .str(text)
+                            .take(),
+                        true);
                 }
+                server.broadcast(binary_sessions, binary_frame);
             }
+        };
+
+        if (!target || !users.with_sessions(*target, deliver)) {
+            send_error(server, conn.id(), conn.wire(), "unknown user");
+            return;
+        }
+        if (*target != user.id()) users.with_sessions(user.id(), deliver);
+        direct_messages.inc();
+    };
+
+    // Over budget: the first shed frame of an episode gets an error reply,
+    // the rest are dropped without any work.
+    auto shed = [&](ConnectionTable::Row conn, bool& episode, std::string_view reason) {
+        if (episode) return;
+        episode = true;
+        send_error(server, conn.id(), conn.wire(), reason);
+    };
+
+    auto on_chat = [&](ConnectionTable::Row conn, simplechat::chat::Room& room,
+                       std::string_view text) {
+        if (refuse_while_handing_off(conn)) return;
+        const ClientId id = conn.id();
+        auto& sess = conn.session();
+        auto& user = sess.user;
+
+        // Checked before the echo and the fan-out, which is where a flood
+        // multiplies into work for every member.
+        if (!room.admit(text.size())) {
+            room_limited.inc();
+            room_limited_bytes.inc(text.size());
+            shed(conn, sess.room_throttled, "room rate limited");
+            return;
+        }
+        sess.room_throttled = false;
+        const std::string name = user.name();  // one read of the shared profile
+
+        send_debug(server, debug, id, conn.wire(),
+            [&] {
+                return json::object{
+                    {"type", "debug_msg"},
+                    {"client_id", client_wire_id(sess)},
+                    {"user_id", user.user_id()},
+                    {"name", name},
+                    {"room_id", room.room_id()},
+                    {"text", text}
+                };
+            },
+            [&] {
+                return BinaryWriter(MsgType::DebugMsg, room.handle(), conn.user_handle(),
+                                    name.size() + text.size() + 8)
+                    .str(name)
+                    .str(text)
+                    .take();
+            });
+
+        // Serialize once per wire format; every member's queue and the room
+        // history share the buffer.
+        publish_room(server, log.get(), cluster.get(), room,
+            [&] {
+                return json::object{
+                    {"type","msg"},
+                    {"from", name},
+                    {"user_id", user.user_id()},
+                    {"client_id", client_wire_id(sess)},
+                    {"room_id", room.room_id()},
+                    {"text", text}
+                };
+            },
+            [&] {
+                return BinaryWriter(MsgType::Chat, room.handle(), conn.user_handle(),
+                                    name.size() + text.size() + 96)
+                    .str(name)
+                    .str(text)
+                    .str(user.user_id())
+                    .str(client_wire_id(sess))
+                    .take();
+            });
+    };
+
+    server.set_on_message([&](ClientId id, std::string_view msg) {
+        const auto conn = connections.find(id);
+        if (!conn) {
+            send_error(server, id, Wire::Json, "unknown session");
+            return;
         }
-        else if (type == "msg") {
-            if (!obj->if_contains("text")) {
-                server.send(id, dump({{"type","error"}, {"text","missing text"}}));
+        auto& sess = conn.session();
+        const Wire wire = conn.wire();
+
+        // Before any parsing: a flooding client costs a table index and a CAS.
+        if (!sess.throttle.allow(msg.size())) {
+            client_limited.inc();
+            client_limited_bytes.inc(msg.size());
+            shed(conn, sess.client_throttled, "rate limited");
+            return;
+        }
+        sess.client_throttled = false;
+
+        auto& room = rooms.at(conn.room());
+
+        // Transport liveness (ping/idle close) lives in WebSocketServer; this
+        // is the application's view of who is active.
+        sess.user.touch();
+
+        if (wire == Wire::Binary) {
+            BinaryReader in(msg);
+            if (!in.ok()) {
+                parse_errors.inc();
+                send_error(server, id, wire, "invalid frame");
                 return;
             }
-            std::string text = json::value_to<std::string>((*obj)["text"]);
-    
-            // Debug reply (sender-only)
-            server.send(id, dump({
-                {"type", "debug_msg"},
-                {"client_id", sess.client_id},
-                {"user_id", user.user_id()},
-                {"name", user.name()},
-                {"room_id", sess.room_id},
-                {"text", text}
-            }));
-    
-            json::object out{
-                {"type","msg"},
-                {"from", user.name()},
-                {"user_id", user.user_id()},
-                {"client_id", sess.client_id},
-                {"room_id", sess.room_id},
-                {"text", text}
-            };
-    
-            for (auto c : clients) {
-                auto it = sessions.find(c);
-                if (it != sessions.end() && it->second.room_id == sess.room_id) {
-                    server.send(c, dump(out));
+
+            std::string_view field;
+            switch (in.header().type) {
+                case MsgType::Join: {
+                    std::optional<std::string_view> name, room_name, token;
+                    if (in.str(field)) {
+                        name = field;
+                        if (in.str(field)) {
+                            room_name = field;
+                            if (in.str(field)) token = field;
+                        }
+                    }
+                    on_join(conn, room, name, room_name, token);
+                    return;
                 }
+
+                case MsgType::Dm: {
+                    std::string_view to;
+                    if (!in.str(to) || !in.str(field)) {
+                        parse_errors.inc();
+                        send_error(server, id, wire, "missing field");
+                        return;
+                    }
+                    on_dm(conn, to, field);
+                    return;
+                }
+
+                case MsgType::Msg:
+                    if (!in.str(field)) {
+                        parse_errors.inc();
+                        send_error(server, id, wire, "missing text");
+                        return;
+                    }
+                    on_chat(conn, room, field);
+                    return;
+
+                case MsgType::Create:
+                    on_create(conn, in.str(field) ? std::optional<std::string_view>(field) : std::nullopt);
+                    return;
+
+                case MsgType::Leave:
+                    on_leave(conn);
+                    return;
+
+                case MsgType::List:
+                    on_list(conn);
+                    return;
+
+                default:
+                    parse_errors.inc();
+                    send_error(server, id, wire, "unknown type");
+                    return;
             }
         }
-        else {
-            server.send(id, dump({{"type","error"}, {"text","unknown type"}}));
+
+        // Parsed into the thread's arena; views below stay valid for this call.
+        const json::object* obj = JsonIngress::parse(msg);
+        if (!obj) {
+            parse_errors.inc();
+            send_error(server, id, wire, "invalid json");
+            return;
+        }
+
+        auto type = simplechat::protocol::string_field(*obj, "type");
+        if (!type) {
+            parse_errors.inc();
+            send_error(server, id, wire, "missing type");
+            return;
+        }
+
+        switch (simplechat::protocol::command_of(*type)) {
+            case Command::Join:
+                on_join(conn, room, simplechat::protocol::string_field(*obj, "user"),
+                        simplechat::protocol::string_field(*obj, "room"),
+                        simplechat::protocol::string_field(*obj, "token"));
+                break;
+
+            case Command::Dm: {
+                auto to = simplechat::protocol::string_field(*obj, "to");
+                auto text = simplechat::protocol::string_field(*obj, "text");
+                if (!to || !text) {
+                    parse_errors.inc();
+                    send_error(server, id, wire, "missing field");
+                    return;
+                }
+                on_dm(conn, *to, *text);
+                break;
+            }
+
+            case Command::Msg: {
+                auto text = simplechat::protocol::string_field(*obj, "text");
+                if (!text) {
+                    parse_errors.inc();
+                    send_error(server, id, wire, "missing text");
+                    return;
+                }
+                on_chat(conn, room, *text);
+                break;
+            }
+
+            case Command::Create:
+                on_create(conn, simplechat::protocol::string_field(*obj, "room"));
+                break;
+
+            case Command::Leave:
+                on_leave(conn);
+                break;
+
+            case Command::List:
+                on_list(conn);
+                break;
+
+            case Command::Unknown:
+                parse_errors.inc();
+                send_error(server, id, wire, "unknown type");
+                break;
         }
     });
 
     server.start();
 
+    std::unique_ptr<simplechat::metrics::MetricsServer> metrics_server;
+    if (config.metrics_port != 0) {
+        metrics_server = std::make_unique<simplechat::metrics::MetricsServer>(
+            ioc, config.metrics_address, config.metrics_port, metrics);
+        metrics_server->start();
+    }
+
+    if (cluster) cluster->start();
+
+    std::function<void()> presence_tick;
+    if (config.presence_window.count() > 0) {
+        presence_tick = [&] {
+            flush_presence();
+            presence_timer.expires_after(config.presence_window);
+            presence_timer.async_wait([&](const boost::system::error_code &ec) {
+                if (!ec) presence_tick();
+            });
+        };
+        boost::asio::post(presence_strand, presence_tick);
+    }
+
+    // Listening now, so the predecessor can stop.
+    if (predecessor) {
+        predecessor->complete();
+        predecessor.reset();
+    }
+
+    std::unique_ptr<HandoffServer> handoff;
+    auto shutdown = [&] {
+        boost::asio::post(presence_strand, [&] { presence_timer.cancel(); });
+        server.stop();
+        if (metrics_server) metrics_server->stop();
+        if (cluster) cluster->stop();
+        if (handoff) handoff->stop();
+        ioc.stop();
+    };
+
     // Graceful shutdown on Ctrl+C / SIGTERM
     boost::asio::signal_set signals(ioc, SIGINT, SIGTERM);
     signals.async_wait([&](const boost::system::error_code&, int) {
-        std::cout << "\n[SimpleChat] shutting down...\n";
-        server.stop();
-        ioc.stop();
+        simplechat::logging::info("main", "shutting down");
+        shutdown();
     });
 
-    std::cout << "[SimpleChat] WS server running on port " << port << "\n";
+    // Hot restart: a successor takes the listener and the rooms, then this
+    // process closes its clients over drain_period and exits.
+    boost::asio::steady_timer linger(ioc);
+    if (!config.handoff_socket.empty()) {
+        handoff = std::make_unique<HandoffServer>(ioc, config.handoff_socket);
+        handoff->start(server.listener(),
+            [&] {
+                // Messages from here on could be neither logged nor forwarded;
+                // refuse them rather than lose them.
+                handing_off = true;
+                // The successor opens these as soon as it has the listener.
+                if (metrics_server) metrics_server->stop();
+                if (cluster) cluster->stop();
+                if (log) log->stop();
+                return simplechat::chat::encode_state(rooms, users, !log);
+            },
+            [&](bool ok) {
+                if (!ok) {
+                    // Take back what prepare released; held log records go
+                    // out now, and a retry snapshots from a running log again.
+                    simplechat::logging::error("main", "handoff failed; still serving");
+                    handing_off = false;
+                    if (log) log->start();
+                    try {
+                        if (cluster) cluster->start();
+                    } catch (const std::exception& e) {
+                        simplechat::logging::error("main", "cluster: {}", e.what());
+                    }
+                    try {
+                        if (metrics_server) metrics_server->start();
+                    } catch (const std::exception& e) {
+                        simplechat::logging::error("main", "metrics: {}", e.what());
+                    }
+                    return;
+                }
+                simplechat::logging::info("main", "handed off; draining {} clients", connections.size());
+                draining = true;
+                server.drain(config.drain_period, [&] {
+                    // Let the last close handshakes finish.
+                    linger.expires_after(std::chrono::seconds(1));
+                    linger.async_wait([&](const boost::system::error_code&) { shutdown(); });
+                });
+            });
+    }
+
+    simplechat::logging::info("main", "WS server running on port {} ({} threads{})",
+                              config.port, threads, debug ? ", debug" : "");
+    if (cluster) {
+        simplechat::logging::info("main", "cluster link on {}:{}, {} peers",
+                                  config.cluster_address, config.cluster_port, config.cluster_peers.size());
+    }
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    for (unsigned i = 1; i < threads; ++i) {
+        workers.emplace_back([&ioc] { ioc.run(); });
+    }
     ioc.run();
-    std::cout << "[SimpleChat] exit.\n";
+    for (auto& t : workers) t.join();
+
+    simplechat::logging::info("main", "exit");
+    simplechat::logging::shutdown();
     return 0;
-}
\ No newline at end of file
+}
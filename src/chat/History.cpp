@@ -0,0 +1,59 @@
+#include "chat/History.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace simplechat::chat {
+
+std::size_t HistoryEntry::bytes() const noexcept {
+    std::size_t n = 0;
+    for (const auto& f : frames) {
+        if (f) n += f->size();
+    }
+    return n;
+}
+
+History::History(HistoryLimits limits) : limits_(limits) {}
+
+void History::push(HistoryEntry entry) {
+    if (limits_.max_messages == 0) return;
+
+    const std::size_t size = entry.bytes();
+    if (size > limits_.max_bytes) return;
+
+    while (count_ > 0 && (count_ == limits_.max_messages || bytes_ + size > limits_.max_bytes)) {
+        pop_front();
+    }
+
+    // Grow towards max_messages only as entries arrive, so a quiet room
+    // costs nothing. Growing needs the live entries in order from index 0.
+    if (count_ == ring_.size()) {
+        std::rotate(ring_.begin(), ring_.begin() + static_cast<std::ptrdiff_t>(head_), ring_.end());
+        head_ = 0;
+        ring_.emplace_back();
+    }
+
+    ring_[(head_ + count_) % ring_.size()] = std::move(entry);
+    ++count_;
+    bytes_ += size;
+}
+
+void History::collect(simplechat::protocol::Wire wire,
+                      std::vector<simplechat::networking::Payload>& out) const {
+    const auto w = static_cast<std::size_t>(wire);
+    out.reserve(out.size() + count_);
+    for (std::size_t i = 0; i < count_; ++i) {
+        const auto& frame = ring_[(head_ + i) % ring_.size()].frames[w];
+        if (frame) out.push_back(frame);
+    }
+}
+
+void History::pop_front() {
+    auto& oldest = ring_[head_];
+    bytes_ -= oldest.bytes();
+    oldest = {};
+    head_ = (head_ + 1) % ring_.size();
+    --count_;
+}
+
+} // namespace simplechat::chat
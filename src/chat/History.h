@@ -0,0 +1,61 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include "networking/Payload.h"
+#include "protocol/Wire.hpp"
+
+
+namespace simplechat::chat {
+
+struct HistoryLimits {
+    std::size_t max_messages = 100;
+    std::size_t max_bytes = 256 * 1024;  // sum of both encodings
+};
+
+// One chat message, serialized once per wire format. Replaying it is a
+// ref-count bump, never a re-encode.
+struct HistoryEntry {
+    std::array<simplechat::networking::Payload, 2> frames;  // indexed by Wire
+
+    std::size_t bytes() const noexcept;
+};
+
+// Bounded ring of the most recent messages in a room. Whichever of
+// max_messages / max_bytes is hit first evicts from the oldest end, so a
+// room never holds more than the configured budget. The ring grows with
+// what it holds, up to max_messages slots.
+//
+// Not thread-safe; Room guards it with its own mutex.
+class History {
+public:
+    explicit History(HistoryLimits limits = {});
+
+    void push(HistoryEntry entry);
+
+    // Appends the frames for wire, oldest first.
+    void collect(simplechat::protocol::Wire wire,
+                 std::vector<simplechat::networking::Payload>& out) const;
+
+    // Runs fn(entry) for every entry, oldest first.
+    template <class Fn>
+    void for_each(Fn&& fn) const {
+        for (std::size_t i = 0; i < count_; ++i) fn(ring_[(head_ + i) % ring_.size()]);
+    }
+
+    std::size_t size() const noexcept { return count_; }
+    std::size_t bytes() const noexcept { return bytes_; }
+
+private:
+    void pop_front();
+
+    HistoryLimits limits_;
+    std::vector<HistoryEntry> ring_;
+    std::size_t head_ = 0;   // oldest entry
+    std::size_t count_ = 0;
+    std::size_t bytes_ = 0;
+};
+
+} // namespace simplechat::chat
@@ -0,0 +1,52 @@
+#include "chat/Presence.h"
+
+#include <functional>
+#include <utility>
+
+namespace simplechat::chat {
+
+void PresenceBatcher::joined(std::string_view room_id, std::string user_id, std::string name) {
+    record(room_id, std::move(user_id), std::move(name), Pending::State::Joined);
+}
+
+void PresenceBatcher::left(std::string_view room_id, std::string user_id, std::string name) {
+    record(room_id, std::move(user_id), std::move(name), Pending::State::Left);
+}
+
+void PresenceBatcher::record(std::string_view room_id, std::string user_id, std::string name,
+                             Pending::State state) {
+    auto& shard = shards_[std::hash<std::string_view>{}(room_id) % kShards];
+    std::lock_guard<std::mutex> lk(shard.mu);
+    auto it = shard.rooms.find(std::string(room_id));
+    if (it == shard.rooms.end()) it = shard.rooms.emplace(std::string(room_id), Pending{}).first;
+    it->second.record(std::move(user_id), std::move(name), state);
+}
+
+void PresenceBatcher::Pending::record(std::string user_id, std::string name, State state) {
+    auto [it, inserted] = index.try_emplace(user_id, entries.size());
+    if (inserted) {
+        entries.push_back({{std::move(user_id), std::move(name)}, state});
+        return;
+    }
+
+    // A join and a leave inside one window cancel out; repeats keep the
+    // latest name (a join with a name after the guest join on connect).
+    Entry& entry = entries[it->second];
+    if (entry.state == State::None) {
+        entry.state = state;
+    } else if (entry.state != state) {
+        entry.state = State::None;
+    }
+    entry.event.name = std::move(name);
+}
+
+PresenceDiff PresenceBatcher::Pending::finish() {
+    PresenceDiff diff;
+    for (auto& entry : entries) {
+        if (entry.state == State::Joined) diff.joined.push_back(std::move(entry.event));
+        if (entry.state == State::Left) diff.left.push_back(std::move(entry.event));
+    }
+    return diff;
+}
+
+} // namespace simplechat::chat
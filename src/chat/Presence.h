@@ -0,0 +1,87 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+
+namespace simplechat::chat {
+
+// One member coming or going.
+struct PresenceEvent {
+    std::string user_id;
+    std::string name;
+};
+
+// What changed in one room since the last flush. A member who joined and
+// left within the same window appears in neither list; one who joined then
+// renamed appears once, under the latest name.
+struct PresenceDiff {
+    std::vector<PresenceEvent> joined;
+    std::vector<PresenceEvent> left;
+
+    bool empty() const noexcept { return joined.empty() && left.empty(); }
+};
+
+// Collects join/leave events per room so they go out as one presence frame
+// per room per tick instead of one system frame per event: a wave of K
+// arrivals into a room of N costs N frames per tick, not K * N.
+//
+// joined()/left() are called from any io thread, even under other locks;
+// rooms are spread over independently locked shards so they rarely
+// contend, and nothing else is locked while a shard is. take() swaps each
+// shard's pending diffs out and runs fn(room_id, diff) outside the locks.
+class PresenceBatcher {
+public:
+    void joined(std::string_view room_id, std::string user_id, std::string name);
+    void left(std::string_view room_id, std::string user_id, std::string name);
+
+    template <class Fn>
+    void take(Fn&& fn) {
+        for (auto& shard : shards_) {
+            std::unordered_map<std::string, Pending> batch;
+            {
+                std::lock_guard<std::mutex> lk(shard.mu);
+                batch.swap(shard.rooms);
+            }
+            for (auto& [room_id, pending] : batch) {
+                PresenceDiff diff = pending.finish();
+                if (!diff.empty()) fn(room_id, diff);
+            }
+        }
+    }
+
+private:
+    static constexpr std::size_t kShards = 16;
+
+    // Latest state per user this window, in arrival order.
+    struct Pending {
+        enum class State : std::uint8_t { None, Joined, Left };
+        struct Entry {
+            PresenceEvent event;
+            State state;
+        };
+
+        void record(std::string user_id, std::string name, State state);
+        PresenceDiff finish();
+
+        std::vector<Entry> entries;
+        std::unordered_map<std::string, std::size_t> index;  // user_id -> entries
+    };
+
+    struct Shard {
+        std::mutex mu;
+        std::unordered_map<std::string, Pending> rooms;
+    };
+
+    void record(std::string_view room_id, std::string user_id, std::string name, Pending::State state);
+
+    std::array<Shard, kShards> shards_;
+};
+
+} // namespace simplechat::chat
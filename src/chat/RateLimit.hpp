@@ -0,0 +1,108 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace simplechat::chat {
+
+// Budget for one sender (a connection or a room). A zero rate is unlimited;
+// a zero burst allows one second's worth. A single frame larger than
+// byte_burst can never pass, so keep it above the largest legal frame.
+struct RateLimit {
+    double messages_per_second = 0;
+    double message_burst = 0;
+    double bytes_per_second = 0;
+    double byte_burst = 0;
+};
+
+// Token bucket in GCRA form: the only state is the time at which the bucket
+// will be full again. Taking n tokens pushes that time forward by n units and
+// fails if it would land more than `burst` units in the future. No refill
+// step, one CAS per check, and safe to share across threads (a room's bucket
+// is hit from every member's strand).
+class TokenBucket {
+public:
+    TokenBucket() = default;
+
+    TokenBucket(double rate, double burst) {
+        if (rate <= 0) return;
+        ns_per_unit_ = 1e9 / rate;
+        capacity_ns_ = static_cast<std::int64_t>((burst > 0 ? burst : rate) * ns_per_unit_);
+    }
+
+    // Copyable so the owner can live in a movable struct; copies are
+    // independent from then on.
+    TokenBucket(const TokenBucket& other) noexcept
+        : ns_per_unit_(other.ns_per_unit_),
+          capacity_ns_(other.capacity_ns_),
+          full_at_(other.full_at_.load(std::memory_order_relaxed)) {}
+
+    TokenBucket& operator=(const TokenBucket& other) noexcept {
+        ns_per_unit_ = other.ns_per_unit_;
+        capacity_ns_ = other.capacity_ns_;
+        full_at_.store(other.full_at_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        return *this;
+    }
+
+    bool unlimited() const noexcept { return ns_per_unit_ == 0; }
+
+    bool try_take(double n, std::int64_t now_ns) noexcept {
+        if (unlimited()) return true;
+        const auto cost = static_cast<std::int64_t>(std::llround(n * ns_per_unit_));
+
+        std::int64_t full_at = full_at_.load(std::memory_order_relaxed);
+        for (;;) {
+            const std::int64_t next = std::max(full_at, now_ns) + cost;
+            if (next - now_ns > capacity_ns_) return false;
+            if (full_at_.compare_exchange_weak(full_at, next, std::memory_order_relaxed)) return true;
+        }
+    }
+
+    // Undoes a successful try_take(n).
+    void give_back(double n) noexcept {
+        if (unlimited()) return;
+        full_at_.fetch_sub(static_cast<std::int64_t>(std::llround(n * ns_per_unit_)),
+                           std::memory_order_relaxed);
+    }
+
+private:
+    double ns_per_unit_ = 0;
+    std::int64_t capacity_ns_ = 0;
+    std::atomic<std::int64_t> full_at_{0};
+};
+
+// Message and byte buckets checked together: a frame passes only if both
+// have room, and is charged to neither otherwise.
+class Throttle {
+public:
+    Throttle() = default;
+
+    explicit Throttle(const RateLimit& limit)
+        : messages_(limit.messages_per_second, limit.message_burst),
+          bytes_(limit.bytes_per_second, limit.byte_burst) {}
+
+    bool unlimited() const noexcept { return messages_.unlimited() && bytes_.unlimited(); }
+
+    bool allow(std::size_t bytes) noexcept {
+        if (unlimited()) return true;
+
+        const std::int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        if (!messages_.try_take(1, now)) return false;
+        if (!bytes_.try_take(static_cast<double>(bytes), now)) {
+            messages_.give_back(1);
+            return false;
+        }
+        return true;
+    }
+
+private:
+    TokenBucket messages_;
+    TokenBucket bytes_;
+};
+
+} // namespace simplechat::chat
@@ -0,0 +1,206 @@
+#include "chat/Room.h"
+
+#include <stdexcept>
+#include <utility>
+
+namespace simplechat::chat {
+
+Room::Room(RoomHandle handle, std::string room_id, HistoryLimits history, RateLimit rate) : handle_(handle),
+        room_id_(std::move(room_id)), history_(history), rate_(rate) {}
+
+std::string room_id_of(std::string_view name) {
+    constexpr std::string_view kPrefix = "room-";
+    if (name.substr(0, kPrefix.size()) == kPrefix) name.remove_prefix(kPrefix.size());
+    if (name.empty() || name.size() > kMaxRoomNameLen) return {};
+
+    for (const char c : name) {
+        const bool ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                        (c >= '0' && c <= '9') || c == '-' || c == '_';
+        if (!ok) return {};
+    }
+
+    std::string id;
+    id.reserve(kPrefix.size() + name.size());
+    id.append(kPrefix).append(name);
+    return id;
+}
+
+RoomHandle Room::handle() const noexcept { return handle_; }
+const std::string& Room::room_id() const noexcept { return room_id_; }
+
+bool Room::add(ClientId client, Wire wire) {
+    std::lock_guard<std::mutex> lk(mu_);
+    return add_locked(client, wire);
+}
+
+bool Room::add_locked(ClientId client, Wire wire) {
+    auto& members = members_[static_cast<std::size_t>(wire)];
+    auto [it, inserted] = index_.emplace(client, Slot{wire, members.size()});
+    if (!inserted) return false;
+
+    members.push_back(client);
+    return true;
+}
+
+bool Room::remove(ClientId client) {
+    std::lock_guard<std::mutex> lk(mu_);
+    auto it = index_.find(client);
+    if (it == index_.end()) return false;
+
+    // Move the last member into the freed slot so the list stays dense.
+    auto& members = members_[static_cast<std::size_t>(it->second.wire)];
+    const std::size_t pos = it->second.pos;
+    const ClientId last = members.back();
+    members[pos] = last;
+    index_[last].pos = pos;
+
+    members.pop_back();
+    index_.erase(client);
+    return true;
+}
+
+bool Room::contains(ClientId client) const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return index_.find(client) != index_.end();
+}
+
+void Room::restore(HistoryEntry entry) {
+    std::lock_guard<std::mutex> lk(mu_);
+    history_.push(std::move(entry));
+}
+
+bool Room::has_history() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return history_.size() > 0;
+}
+
+std::array<std::size_t, 2> Room::wire_counts() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return {members_[0].size(), members_[1].size()};
+}
+
+std::size_t Room::size() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return index_.size();
+}
+
+bool Room::empty() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return index_.empty();
+}
+
+RoomRegistry::RoomRegistry(HistoryLimits history, RateLimit rate) : history_(history), rate_(rate) {}
+
+RoomHandle RoomRegistry::intern(std::string_view room_id, bool pinned) {
+    const std::string key(room_id);
+    {
+        std::shared_lock<std::shared_mutex> lk(mu_);
+        auto it = by_id_.find(key);
+        if (it != by_id_.end() && (!pinned || rooms_[it->second].pinned)) return it->second;
+    }
+
+    std::unique_lock<std::shared_mutex> lk(mu_);
+    auto it = by_id_.find(key);
+    if (it != by_id_.end()) {
+        rooms_[it->second].pinned |= pinned;
+        return it->second;
+    }
+    return emplace(key, pinned);
+}
+
+Room* RoomRegistry::create(std::string_view room_id, ClientId client, Wire wire) {
+    std::string key(room_id);
+    std::unique_lock<std::shared_mutex> lk(mu_);
+    if (by_id_.count(key)) return nullptr;
+
+    // Joined before the lock drops, so nobody can see it empty.
+    Room& room = *rooms_[emplace(std::move(key), false)].room;
+    room.add(client, wire);
+    return &room;
+}
+
+RoomHandle RoomRegistry::emplace(std::string room_id, bool pinned) {
+    RoomHandle handle;
+    if (!free_.empty()) {
+        handle = free_.back();
+        free_.pop_back();
+    } else {
+        handle = static_cast<RoomHandle>(rooms_.size());
+        rooms_.emplace_back();
+    }
+
+    rooms_[handle].room = std::make_unique<Room>(handle, room_id, history_, rate_);
+    rooms_[handle].pinned = pinned;
+    by_id_.emplace(std::move(room_id), handle);
+    return handle;
+}
+
+void RoomRegistry::release(RoomHandle handle) {
+    std::unique_lock<std::shared_mutex> lk(mu_);
+    auto& entry = rooms_[handle];
+    // Someone may have joined, or the handle been reused, since the leave.
+    if (!entry.room || entry.pinned || !entry.room->empty()) return;
+
+    by_id_.erase(entry.room->room_id());
+    entry.room.reset();
+    free_.push_back(handle);
+}
+
+std::size_t RoomRegistry::reap() {
+    std::unique_lock<std::shared_mutex> lk(mu_);
+    std::size_t reaped = 0;
+    for (RoomHandle handle = 0; handle < rooms_.size(); ++handle) {
+        auto& entry = rooms_[handle];
+        if (!entry.room || entry.pinned || !entry.room->empty()) continue;
+        // Someone may still come back for it, if only to read.
+        if (entry.room->has_history()) continue;
+
+        by_id_.erase(entry.room->room_id());
+        entry.room.reset();
+        free_.push_back(handle);
+        ++reaped;
+    }
+    return reaped;
+}
+
+Room* RoomRegistry::find(std::string_view room_id) {
+    std::shared_lock<std::shared_mutex> lk(mu_);
+    auto it = by_id_.find(std::string(room_id));
+    if (it == by_id_.end()) return nullptr;
+    return rooms_[it->second].room.get();
+}
+
+Room* RoomRegistry::find(RoomHandle handle) {
+    std::shared_lock<std::shared_mutex> lk(mu_);
+    if (handle >= rooms_.size()) return nullptr;
+    return rooms_[handle].room.get();
+}
+
+Room& RoomRegistry::at(RoomHandle handle) {
+    std::shared_lock<std::shared_mutex> lk(mu_);
+    if (handle >= rooms_.size() || !rooms_[handle].room) throw std::out_of_range("unknown room handle");
+    return *rooms_[handle].room;
+}
+
+const Room& RoomRegistry::at(RoomHandle handle) const {
+    std::shared_lock<std::shared_mutex> lk(mu_);
+    if (handle >= rooms_.size() || !rooms_[handle].room) throw std::out_of_range("unknown room handle");
+    return *rooms_[handle].room;
+}
+
+std::vector<RoomRegistry::Listing> RoomRegistry::list(std::size_t max) const {
+    std::vector<Listing> out;
+    std::shared_lock<std::shared_mutex> lk(mu_);
+    for (const auto& entry : rooms_) {
+        if (out.size() == max) break;
+        if (entry.room) out.push_back({entry.room->room_id(), entry.room->handle(), entry.room->size()});
+    }
+    return out;
+}
+
+std::size_t RoomRegistry::size() const {
+    std::shared_lock<std::shared_mutex> lk(mu_);
+    return by_id_.size();
+}
+
+} // namespace simplechat::chat
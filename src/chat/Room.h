@@ -0,0 +1,250 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "chat/History.h"
+#include "chat/RateLimit.hpp"
+#include "memory/Pool.h"
+#include "networking/ClientId.hpp"
+#include "protocol/Wire.hpp"
+
+
+namespace simplechat::chat {
+
+// Interned room id. Handles are dense indices into RoomRegistry, so a session
+// can carry one instead of the "room-<id>" string. A handle is reused once
+// its room has been torn down.
+using RoomHandle = std::uint32_t;
+
+inline constexpr std::size_t kMaxRoomNameLen = 32;
+
+// "room-<name>" for a client-supplied room name; the prefix is optional on
+// input. Empty if the name is empty, longer than kMaxRoomNameLen, or uses
+// anything but [A-Za-z0-9_-].
+std::string room_id_of(std::string_view name);
+
+class Room {
+public:
+    using ClientId = simplechat::networking::ClientId;
+
+    Room(RoomHandle handle, std::string room_id, HistoryLimits history = {},
+         RateLimit rate = {});
+
+    RoomHandle handle() const noexcept;
+    const std::string& room_id() const noexcept;
+
+    using Wire = simplechat::protocol::Wire;
+
+    // O(1) membership updates; return false if nothing changed.
+    bool add(ClientId client, Wire wire = Wire::Json);
+    bool remove(ClientId client);
+    bool contains(ClientId client) const;
+
+    // add() that also runs replay(frames) with the room's history in the
+    // client's wire format. Runs under the member lock, so every message
+    // reaches the client exactly once: from history or from a later record().
+    template <class Fn>
+    bool add(ClientId client, Wire wire, Fn&& replay) {
+        std::lock_guard<std::mutex> lk(mu_);
+        if (!add_locked(client, wire)) return false;
+
+        std::vector<simplechat::networking::Payload> frames;
+        history_.collect(wire, frames);
+        if (!frames.empty()) replay(frames);
+        return true;
+    }
+
+    // Appends entry to the history without fanning it out (log recovery).
+    void restore(HistoryEntry entry);
+
+    // Appends entry to the history and runs fn(json_members, binary_members)
+    // under the same lock, i.e. with_members() for messages worth replaying.
+    template <class Fn>
+    void record(HistoryEntry entry, Fn&& fn) {
+        std::lock_guard<std::mutex> lk(mu_);
+        history_.push(std::move(entry));
+        fn(members_[0], members_[1]);
+    }
+
+    // Runs fn(entry) over the history, oldest first, with the room locked.
+    template <class Fn>
+    void for_each_entry(Fn&& fn) const {
+        std::lock_guard<std::mutex> lk(mu_);
+        history_.for_each(std::forward<Fn>(fn));
+    }
+
+    // Runs fn(json_members, binary_members) with the member lists locked.
+    // Members are grouped by wire format so a broadcast encodes each format
+    // once. Lists are contiguous; order is not stable across remove().
+    template <class Fn>
+    void with_members(Fn&& fn) const {
+        std::lock_guard<std::mutex> lk(mu_);
+        fn(members_[0], members_[1]);
+    }
+
+    // Charges one message of `bytes` to the room's budget; false means shed
+    // it. Lock-free, so it is cheap to call before any fan-out work.
+    bool admit(std::size_t bytes) noexcept { return rate_.allow(bytes); }
+
+    // Member count per wire format, indexed by Wire.
+    std::array<std::size_t, 2> wire_counts() const;
+
+    std::size_t size() const;
+    bool empty() const;
+
+    // Whether any message is kept for replay.
+    bool has_history() const;
+
+private:
+    bool add_locked(ClientId client, Wire wire);
+
+    RoomHandle handle_;
+    std::string room_id_;
+
+    mutable std::mutex mu_;
+
+    struct Slot {
+        Wire wire;
+        std::size_t pos;
+    };
+
+    std::array<std::vector<ClientId>, 2> members_;
+    // client -> position in members_[wire] (swap-and-pop on remove)
+    std::unordered_map<ClientId, Slot, std::hash<ClientId>, std::equal_to<ClientId>,
+                       memory::PoolAllocator<std::pair<const ClientId, Slot>>> index_;
+
+    History history_;
+    Throttle rate_;
+};
+
+// All rooms on the server.
+//
+// Rooms made by create() are torn down when their last member leaves;
+// pinned rooms (the lobby) live for the whole run. Rooms restored from the
+// log or a predecessor start out empty, so nobody's leave would tear them
+// down: reap() drops the ones still empty and with no history once their
+// members have had time to come back. Those with history stay joinable
+// until they go like any other room, with their last member. Teardown
+// takes the registry lock exclusively, while join(), leave() and at() hold
+// it shared, so a room cannot vanish between being looked up and joined.
+// A reference from at() stays valid while the caller is a member.
+class RoomRegistry {
+public:
+    using ClientId = simplechat::networking::ClientId;
+    using Wire = simplechat::protocol::Wire;
+
+    struct Listing {
+        std::string room_id;
+        RoomHandle handle;
+        std::size_t members;
+    };
+
+    explicit RoomRegistry(HistoryLimits history = {}, RateLimit rate = {});
+
+    // Returns the handle for room_id, creating the room on first use.
+    RoomHandle intern(std::string_view room_id, bool pinned = false);
+
+    // Creates room_id with client as its only member; nullptr if it exists.
+    Room* create(std::string_view room_id, ClientId client, Wire wire);
+
+    // Adds client to an existing room, replaying its history as Room::add
+    // does; nullptr if there is no such room.
+    template <class Fn>
+    Room* join(std::string_view room_id, ClientId client, Wire wire, Fn&& replay) {
+        std::shared_lock<std::shared_mutex> lk(mu_);
+        auto it = by_id_.find(std::string(room_id));
+        if (it == by_id_.end()) return nullptr;
+
+        Room& room = *rooms_[it->second].room;
+        room.add(client, wire, std::forward<Fn>(replay));
+        return &room;
+    }
+
+    // Removes client from the room, then runs farewell(room) for whoever is
+    // left. If that emptied the room it is torn down (unless pinned); either
+    // way the caller must not touch it afterwards.
+    template <class Fn>
+    void leave(RoomHandle handle, ClientId client, Fn&& farewell) {
+        bool drop = false;
+        {
+            std::shared_lock<std::shared_mutex> lk(mu_);
+            if (handle >= rooms_.size() || !rooms_[handle].room) return;
+
+            Room& room = *rooms_[handle].room;
+            room.remove(client);
+            farewell(room);
+            drop = !rooms_[handle].pinned && room.empty();
+        }
+        if (drop) release(handle);
+    }
+
+    // Runs fn(room) on an existing room with the registry lock held shared,
+    // so it cannot be torn down meanwhile; false if there is no such room.
+    template <class Fn>
+    bool visit(std::string_view room_id, Fn&& fn) {
+        std::shared_lock<std::shared_mutex> lk(mu_);
+        auto it = by_id_.find(std::string(room_id));
+        if (it == by_id_.end()) return false;
+
+        fn(*rooms_[it->second].room);
+        return true;
+    }
+
+    // Tears down every unpinned room with no members and no history;
+    // returns how many.
+    std::size_t reap();
+
+    // Lookup without creating; returns nullptr if unknown.
+    Room* find(std::string_view room_id);
+    Room* find(RoomHandle handle);
+
+    Room& at(RoomHandle handle);
+    const Room& at(RoomHandle handle) const;
+
+    // Runs fn(room, pinned) for every live room in handle order, with the
+    // registry lock held shared.
+    template <class Fn>
+    void for_each(Fn&& fn) const {
+        std::shared_lock<std::shared_mutex> lk(mu_);
+        for (const auto& entry : rooms_) {
+            if (entry.room) fn(static_cast<const Room&>(*entry.room), entry.pinned);
+        }
+    }
+
+    // Up to max rooms in handle order, with their member counts.
+    std::vector<Listing> list(std::size_t max) const;
+
+    // Live rooms.
+    std::size_t size() const;
+
+private:
+    struct Entry {
+        std::unique_ptr<Room> room;  // null while the handle is free
+        bool pinned = false;
+    };
+
+    // Call with mu_ held exclusively.
+    RoomHandle emplace(std::string room_id, bool pinned);
+    // Tears the room down if it is still empty and not pinned.
+    void release(RoomHandle handle);
+
+    const HistoryLimits history_;
+    const RateLimit rate_;
+
+    mutable std::shared_mutex mu_;
+    // Rooms are heap-allocated so references stay valid while rooms_ grows.
+    std::vector<Entry> rooms_;
+    std::vector<RoomHandle> free_;
+    std::unordered_map<std::string, RoomHandle> by_id_;
+};
+
+} // namespace simplechat::chat
@@ -0,0 +1,161 @@
+#include "chat/Snapshot.h"
+
+#include "protocol/BinaryCodec.h"
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+namespace simplechat::chat {
+
+// Little-endian, every string u32-length-prefixed:
+//
+//   state = u8 version | u32 rooms | room * rooms
+//           | u32 next_user_handle | u32 users | user * users
+//   room  = id | u8 pinned | u32 entries | (json | binary) * entries
+//   user  = ulid | u32 handle | name | secret
+
+namespace {
+
+constexpr std::uint8_t kVersion = 2;
+
+void put_u32(std::string& out, std::uint32_t v) {
+    for (int i = 0; i < 4; ++i) out.push_back(static_cast<char>(v >> (8 * i)));
+}
+
+void put_str(std::string& out, std::string_view s) {
+    put_u32(out, static_cast<std::uint32_t>(s.size()));
+    out.append(s.data(), s.size());
+}
+
+// Fills in a count written as a placeholder at `at`.
+void patch_u32(std::string& out, std::size_t at, std::uint32_t v) {
+    for (int i = 0; i < 4; ++i) out[at + i] = static_cast<char>(v >> (8 * i));
+}
+
+class Reader {
+public:
+    explicit Reader(std::string_view in) noexcept : in_(in) {}
+
+    bool done() const noexcept { return in_.empty(); }
+
+    std::uint32_t u32() {
+        need(4);
+        std::uint32_t v = 0;
+        for (int i = 0; i < 4; ++i) v |= std::uint32_t(static_cast<unsigned char>(in_[i])) << (8 * i);
+        in_.remove_prefix(4);
+        return v;
+    }
+
+    std::uint8_t u8() {
+        need(1);
+        const auto v = static_cast<std::uint8_t>(in_[0]);
+        in_.remove_prefix(1);
+        return v;
+    }
+
+    bool flag() { return u8() != 0; }
+
+    std::string_view str() {
+        const std::size_t len = u32();
+        need(len);
+        const std::string_view v = in_.substr(0, len);
+        in_.remove_prefix(len);
+        return v;
+    }
+
+private:
+    void need(std::size_t n) const {
+        if (in_.size() < n) throw std::runtime_error("state snapshot truncated");
+    }
+
+    std::string_view in_;
+};
+
+} // namespace
+
+std::string encode_state(const RoomRegistry& rooms, const UserDirectory& users, bool history) {
+    std::string out;
+    out.push_back(static_cast<char>(kVersion));
+
+    std::size_t count_at = out.size();
+    std::uint32_t count = 0;
+    put_u32(out, 0);
+    rooms.for_each([&](const Room& room, bool pinned) {
+        ++count;
+        put_str(out, room.room_id());
+        out.push_back(pinned ? 1 : 0);
+
+        const std::size_t entries_at = out.size();
+        put_u32(out, 0);
+        if (!history) return;
+
+        std::uint32_t entries = 0;
+        room.for_each_entry([&](const HistoryEntry& entry) {
+            put_str(out, entry.frames[0] ? entry.frames[0]->data() : std::string_view{});
+            put_str(out, entry.frames[1] ? entry.frames[1]->data() : std::string_view{});
+            ++entries;
+        });
+        patch_u32(out, entries_at, entries);
+    });
+    patch_u32(out, count_at, count);
+
+    put_u32(out, users.next_handle());
+    count_at = out.size();
+    count = 0;
+    put_u32(out, 0);
+    users.for_each([&](const User::Profile& profile, std::string_view secret,
+                       UserDirectory::UserHandle handle) {
+        ++count;
+        put_str(out, profile.id().to_string());
+        put_u32(out, handle);
+        put_str(out, profile.name());
+        put_str(out, secret);
+    });
+    patch_u32(out, count_at, count);
+    return out;
+}
+
+RestoredState decode_state(std::string_view snapshot, RoomRegistry& rooms, UserDirectory& users) {
+    using simplechat::networking::make_payload;
+
+    RestoredState restored;
+    Reader in(snapshot);
+    if (in.u8() != kVersion) throw std::runtime_error("state snapshot from another version");
+
+    for (std::uint32_t r = in.u32(); r > 0; --r) {
+        const std::string_view room_id = in.str();
+        const bool pinned = in.flag();
+        Room& room = rooms.at(rooms.intern(room_id, pinned));
+        ++restored.rooms;
+
+        for (std::uint32_t n = in.u32(); n > 0; --n) {
+            const std::string_view json = in.str();
+            std::string binary(in.str());
+            // Room handles are per-process; user handles come along with the users.
+            if (!binary.empty()) simplechat::protocol::set_room_handle(binary, room.handle());
+
+            HistoryEntry entry;
+            if (!json.empty()) entry.frames[0] = make_payload(std::string(json));
+            if (!binary.empty()) entry.frames[1] = make_payload(std::move(binary), true);
+            room.restore(std::move(entry));
+            ++restored.messages;
+        }
+    }
+
+    users.reserve_handles(in.u32());
+    for (std::uint32_t u = in.u32(); u > 0; --u) {
+        const auto id = Ulid::parse(in.str());
+        if (!id) throw std::runtime_error("state snapshot has a malformed user id");
+        const std::uint32_t handle = in.u32();
+        std::string name(in.str());
+        std::string secret(in.str());
+        users.restore(std::make_shared<User::Profile>(*id, std::move(name)), std::move(secret), handle);
+        ++restored.users;
+    }
+    if (!in.done()) throw std::runtime_error("state snapshot has trailing bytes");
+    return restored;
+}
+
+} // namespace simplechat::chat
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "chat/Room.h"
+#include "chat/UserDirectory.h"
+
+
+namespace simplechat::chat {
+
+// The server's rooms and users, as handed to a successor process on hot
+// restart (see networking/Handoff.h). Every live room is listed with its
+// pinned flag and, if `history` is set, its history frames as sent. Without
+// a message log that history would otherwise be lost; with one, the log
+// already has it. Every online user is listed with its name, token secret
+// and handle, so clients that reconnect with their token stay the same user
+// and handed-over frames still name the right one.
+std::string encode_state(const RoomRegistry& rooms, const UserDirectory& users, bool history);
+
+struct RestoredState {
+    std::size_t rooms = 0;
+    std::size_t messages = 0;
+    std::size_t users = 0;
+};
+
+// Interns every room in snapshot and restores its history into it, as log
+// recovery does, and registers its users (UserDirectory::restore). Throws
+// std::runtime_error if snapshot is malformed or from another version.
+RestoredState decode_state(std::string_view snapshot, RoomRegistry& rooms, UserDirectory& users);
+
+} // namespace simplechat::chat
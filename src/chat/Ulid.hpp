@@ -0,0 +1,147 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace simplechat::chat {
+
+namespace detail {
+
+inline constexpr char kCrockford[] = "0123456789ABCDEFGHJKMNPQRSTVWXYZ";
+
+// char -> 5-bit value, 0xFF for anything outside the alphabet.
+constexpr std::array<std::uint8_t, 256> make_crockford_decode() {
+    std::array<std::uint8_t, 256> t{};
+    for (auto& d : t) d = 0xFF;
+    for (std::uint8_t i = 0; i < 32; ++i) {
+        const char c = kCrockford[i];
+        t[static_cast<unsigned char>(c)] = i;
+        if (c >= 'A' && c <= 'Z') t[static_cast<unsigned char>(c - 'A' + 'a')] = i;
+    }
+    t['O'] = t['o'] = 0;
+    t['I'] = t['i'] = t['L'] = t['l'] = 1;
+    return t;
+}
+
+inline constexpr auto kCrockfordDecode = make_crockford_decode();
+
+} // namespace detail
+
+// 128-bit ULID: 48-bit millisecond timestamp followed by 80 random bits,
+// big-endian, so byte order == time order. Kept binary everywhere inside the
+// server; the 26-char Crockford Base32 form is produced only at the wire.
+class Ulid {
+public:
+    static constexpr std::size_t kStringSize = 26;
+
+    constexpr Ulid() = default;
+    explicit Ulid(const std::array<std::uint8_t, 16>& bytes) : bytes_(bytes) {}
+
+    static Ulid from_parts(std::uint64_t ts_ms, std::uint64_t rand_hi16, std::uint64_t rand_lo64) {
+        Ulid u;
+        u.set_hi((ts_ms << 16) | (rand_hi16 & 0xFFFF));
+        u.set_lo(rand_lo64);
+        return u;
+    }
+
+    const std::array<std::uint8_t, 16>& bytes() const noexcept { return bytes_; }
+    std::uint64_t timestamp_ms() const noexcept { return hi() >> 16; }
+    bool is_nil() const noexcept { return hi() == 0 && lo() == 0; }
+
+    std::uint64_t hi() const noexcept { return load_be(bytes_.data()); }
+    std::uint64_t lo() const noexcept { return load_be(bytes_.data() + 8); }
+
+    // Writes exactly kStringSize chars.
+    void encode(char* out) const noexcept {
+        // 130 bits of output for 128 of input: the first char carries 3 bits,
+        // the next 12 come from hi, char 13 straddles hi/lo, the last 12 from lo.
+        const std::uint64_t h = hi();
+        const std::uint64_t l = lo();
+        out[0] = detail::kCrockford[h >> 61];
+        for (int i = 1; i <= 12; ++i) out[i] = detail::kCrockford[(h >> (61 - 5 * i)) & 0x1F];
+        out[13] = detail::kCrockford[((h & 0x1) << 4) | (l >> 60)];
+        for (int i = 14; i <= 25; ++i) out[i] = detail::kCrockford[(l >> (125 - 5 * i)) & 0x1F];
+    }
+
+    std::string to_string() const {
+        std::string s(kStringSize, '\0');
+        encode(s.data());
+        return s;
+    }
+
+    // "<prefix>-<ulid>", the form the JSON protocol uses.
+    std::string to_string(std::string_view prefix) const {
+        std::string s;
+        s.resize(prefix.size() + 1 + kStringSize);
+        std::memcpy(s.data(), prefix.data(), prefix.size());
+        s[prefix.size()] = '-';
+        encode(s.data() + prefix.size() + 1);
+        return s;
+    }
+
+    // Accepts lower case and Crockford's aliases (I/L -> 1, O -> 0).
+    static std::optional<Ulid> parse(std::string_view s) noexcept {
+        if (s.size() != kStringSize) return std::nullopt;
+
+        const auto& kDecode = detail::kCrockfordDecode;
+        unsigned __int128 v = 0;
+        for (std::size_t i = 0; i < kStringSize; ++i) {
+            const std::uint8_t d = kDecode[static_cast<unsigned char>(s[i])];
+            if (d == 0xFF) return std::nullopt;
+            v = (v << 5) | d;
+        }
+        // First char may only use the low 3 bits (top of the 128-bit value).
+        if (kDecode[static_cast<unsigned char>(s[0])] > 7) return std::nullopt;
+
+        Ulid u;
+        u.set_hi(static_cast<std::uint64_t>(v >> 64));
+        u.set_lo(static_cast<std::uint64_t>(v));
+        return u;
+    }
+
+    friend bool operator==(const Ulid& a, const Ulid& b) noexcept { return a.bytes_ == b.bytes_; }
+    friend bool operator!=(const Ulid& a, const Ulid& b) noexcept { return a.bytes_ != b.bytes_; }
+    friend bool operator<(const Ulid& a, const Ulid& b) noexcept { return a.bytes_ < b.bytes_; }
+    friend bool operator>(const Ulid& a, const Ulid& b) noexcept { return b < a; }
+    friend bool operator<=(const Ulid& a, const Ulid& b) noexcept { return !(b < a); }
+    friend bool operator>=(const Ulid& a, const Ulid& b) noexcept { return !(a < b); }
+
+private:
+    static std::uint64_t load_be(const std::uint8_t* p) noexcept {
+        std::uint64_t v = 0;
+        for (int i = 0; i < 8; ++i) v = (v << 8) | p[i];
+        return v;
+    }
+
+    static void store_be(std::uint8_t* p, std::uint64_t v) noexcept {
+        for (int i = 7; i >= 0; --i) {
+            p[i] = static_cast<std::uint8_t>(v & 0xFF);
+            v >>= 8;
+        }
+    }
+
+    void set_hi(std::uint64_t v) noexcept { store_be(bytes_.data(), v); }
+    void set_lo(std::uint64_t v) noexcept { store_be(bytes_.data() + 8, v); }
+
+    std::array<std::uint8_t, 16> bytes_{};
+};
+
+} // namespace simplechat::chat
+
+namespace std {
+
+template <>
+struct hash<simplechat::chat::Ulid> {
+    std::size_t operator()(const simplechat::chat::Ulid& u) const noexcept {
+        // The low 64 bits are random already; fold the timestamp in anyway.
+        return static_cast<std::size_t>(u.lo() ^ (u.hi() * 0x9E3779B97F4A7C15ull));
+    }
+};
+
+} // namespace std
\ No newline at end of file
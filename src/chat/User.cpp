@@ -5,24 +5,31 @@
 
 namespace simplechat::chat {
 
-User::User(simplechat::chat::IDGenerator& idgen, std::string name, std::string room) : user_id_(idgen.userID()),
-        name_(sanitize_name(std::move(name))),
-        room_(sanitize_room(std::move(room))),
-        connected_at_(Clock::now()),
-        last_seen_(connected_at_) {}
-
-User::User(std::string user_id, std::string name, std::string room) : user_id_(std::move(user_id)),
-        name_(sanitize_name(std::move(name))),
-        room_(sanitize_room(std::move(room))),
-        connected_at_(Clock::now()),
-        last_seen_(connected_at_) {}
-
-const std::string& User::user_id() const noexcept { return user_id_; }
-const std::string& User::name() const noexcept { return name_; }
+User::User(simplechat::chat::IDGenerator& idgen, std::string name, std::string room)
+    : User(idgen.next(), std::move(name), std::move(room)) {}
+
+User::User(Ulid id, std::string name, std::string room)
+    : profile_(std::make_shared<Profile>(id, sanitize_name(std::move(name)))),
+      room_(sanitize_room(std::move(room))),
+      connected_at_(Clock::now()),
+      last_seen_(connected_at_) {}
+
+User::User(std::shared_ptr<Profile> profile, std::string room)
+    : profile_(std::move(profile)),
+      room_(sanitize_room(std::move(room))),
+      connected_at_(Clock::now()),
+      last_seen_(connected_at_) {}
+
+const Ulid& User::id() const noexcept { return profile_->id(); }
+std::string User::user_id() const { return IDGenerator::format(IDGenerator::Kind::User, profile_->id()); }
+std::string User::name() const { return profile_->name(); }
 const std::string& User::room() const noexcept { return room_; }
+const std::shared_ptr<User::Profile>& User::profile() const noexcept { return profile_; }
 
 void User::set_name(std::string new_name) {
-    name_ = sanitize_name(std::move(new_name));
+    new_name = sanitize_name(std::move(new_name));
+    std::lock_guard<std::mutex> lk(profile_->mu_);
+    profile_->name_ = std::move(new_name);
 }
 
 void User::set_room(std::string new_room) {
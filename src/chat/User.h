@@ -2,10 +2,14 @@
 
 #include <cstdint>
 #include <chrono>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <utility>
 
 
 #include "chat/IDGenerator.hpp"
+#include "chat/Ulid.hpp"
 
 
 namespace simplechat::chat {
@@ -15,20 +19,49 @@ public:
     using Clock = std::chrono::steady_clock;
     static constexpr std::size_t kMaxNameLen = 24;
 
-    // Main constructor: generates user-<id>
+    // The id and display name, shared by every session of one user so a
+    // rename from any of them is seen by all. Set through User::set_name.
+    class Profile {
+    public:
+        Profile(Ulid id, std::string name) : id_(id), name_(std::move(name)) {}
+
+        const Ulid& id() const noexcept { return id_; }
+        std::string name() const {
+            std::lock_guard<std::mutex> lk(mu_);
+            return name_;
+        }
+
+    private:
+        friend class User;
+
+        const Ulid id_;
+        mutable std::mutex mu_;
+        std::string name_;
+    };
+
+    // Main constructor: generates a fresh id
     User(simplechat::chat::IDGenerator& idgen,
          std::string name,
          std::string room = "lobby");
 
     // Optional: restore from existing ID (DB / tests / reconnect)
-    User(std::string user_id,
+    User(Ulid id,
          std::string name,
          std::string room = "lobby");
 
-    const std::string& user_id() const noexcept;
-    const std::string& name() const noexcept;
+    // Another session of an existing user.
+    explicit User(std::shared_ptr<Profile> profile,
+                  std::string room = "lobby");
+
+    const Ulid& id() const noexcept;
+    // Wire form, "user-<ulid>"; built on demand.
+    std::string user_id() const;
+    // A copy: another session of the user may rename it meanwhile.
+    std::string name() const;
     const std::string& room() const noexcept;
+    const std::shared_ptr<Profile>& profile() const noexcept;
 
+    // Renames the user in every session sharing the profile.
     void set_name(std::string new_name);
     void set_room(std::string new_room);
 
@@ -42,9 +75,7 @@ private:
     static std::string trim_copy(std::string s);
     static bool is_space(char c) noexcept;
 
-private:
-    std::string user_id_;
-    std::string name_;
+    std::shared_ptr<Profile> profile_;
     std::string room_;
     Clock::time_point connected_at_;
     Clock::time_point last_seen_;
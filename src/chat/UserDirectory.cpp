@@ -0,0 +1,181 @@
+#include "chat/UserDirectory.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <utility>
+
+namespace simplechat::chat {
+
+namespace {
+
+// Unlike ids, a token must not be guessable from earlier ones, so the
+// secret comes from the OS rather than IDGenerator's PRNG.
+std::string make_secret() {
+    static constexpr char kHex[] = "0123456789abcdef";
+    thread_local std::random_device rd;
+
+    std::string out(32, '0');
+    for (std::size_t i = 0; i < out.size(); i += 8) {
+        std::uint32_t v = rd();
+        for (std::size_t j = 0; j < 8; ++j, v >>= 4) out[i + j] = kHex[v & 0xF];
+    }
+    return out;
+}
+
+// Compares without stopping at the first difference.
+bool same_secret(std::string_view a, std::string_view b) noexcept {
+    if (a.size() != b.size()) return false;
+    unsigned char diff = 0;
+    for (std::size_t i = 0; i < a.size(); ++i) diff |= static_cast<unsigned char>(a[i] ^ b[i]);
+    return diff == 0;
+}
+
+} // namespace
+
+UserDirectory::Identity UserDirectory::add(std::shared_ptr<User::Profile> profile, ClientId client, Wire wire) {
+    const Ulid user = profile->id();
+    std::string secret = make_secret();
+
+    auto& shard = shard_for(user);
+    std::lock_guard<std::mutex> lk(shard.mu);
+    auto [it, inserted] = shard.users.try_emplace(user);
+    auto& entry = it->second;
+    if (inserted) {
+        entry.profile = std::move(profile);
+        entry.secret = std::move(secret);
+        entry.handle = next_handle_.fetch_add(1, std::memory_order_relaxed);
+        size_.fetch_add(1, std::memory_order_relaxed);
+    }
+    entry.sessions[static_cast<std::size_t>(wire)].push_back(client);
+    return Identity{entry.profile, user.to_string() + "." + entry.secret,
+                    entry.sessions[0].size() + entry.sessions[1].size(), entry.handle};
+}
+
+std::optional<UserDirectory::Identity> UserDirectory::attach(std::string_view token, ClientId client, Wire wire) {
+    const auto dot = token.find('.');
+    if (dot == std::string_view::npos) return std::nullopt;
+    const auto user = Ulid::parse(token.substr(0, dot));
+    if (!user) return std::nullopt;
+
+    auto& shard = shard_for(*user);
+    std::lock_guard<std::mutex> lk(shard.mu);
+    auto it = shard.users.find(*user);
+    if (it == shard.users.end() || !same_secret(it->second.secret, token.substr(dot + 1))) return std::nullopt;
+
+    auto& entry = it->second;
+    if (!online(entry)) size_.fetch_add(1, std::memory_order_relaxed);  // restored, now back
+    entry.sessions[static_cast<std::size_t>(wire)].push_back(client);
+    return Identity{entry.profile, std::string(token), entry.sessions[0].size() + entry.sessions[1].size(),
+                    entry.handle};
+}
+
+bool UserDirectory::detach(const Ulid& user, ClientId client) {
+    auto& shard = shard_for(user);
+    std::lock_guard<std::mutex> lk(shard.mu);
+    auto it = shard.users.find(user);
+    if (it == shard.users.end()) return false;
+
+    // A handful of sessions per user: a scan beats an index.
+    bool found = false;
+    for (auto& list : it->second.sessions) {
+        auto pos = std::find(list.begin(), list.end(), client);
+        if (pos != list.end()) {
+            *pos = list.back();
+            list.pop_back();
+            found = true;
+            break;
+        }
+    }
+    if (!found) return false;
+
+    auto& present = it->second.present;
+    present.erase(std::remove_if(present.begin(), present.end(),
+                                 [&](const auto& p) { return p.second == client; }),
+                  present.end());
+    if (online(it->second)) return false;
+
+    shard.users.erase(it);
+    size_.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+std::optional<UserDirectory::Identity> UserDirectory::find(const Ulid& user) const {
+    const auto& shard = shard_for(user);
+    std::lock_guard<std::mutex> lk(shard.mu);
+    auto it = shard.users.find(user);
+    if (it == shard.users.end() || !online(it->second)) return std::nullopt;
+
+    const auto& entry = it->second;
+    return Identity{entry.profile, user.to_string() + "." + entry.secret,
+                    entry.sessions[0].size() + entry.sessions[1].size(), entry.handle};
+}
+
+void UserDirectory::restore(std::shared_ptr<User::Profile> profile, std::string secret, UserHandle handle) {
+    const Ulid user = profile->id();
+    reserve_handles(handle + 1);
+
+    auto& shard = shard_for(user);
+    std::lock_guard<std::mutex> lk(shard.mu);
+    auto [it, inserted] = shard.users.try_emplace(user);
+    if (!inserted) return;
+    it->second.profile = std::move(profile);
+    it->second.secret = std::move(secret);
+    it->second.handle = handle;
+}
+
+void UserDirectory::reserve_handles(UserHandle next) noexcept {
+    UserHandle current = next_handle_.load(std::memory_order_relaxed);
+    while (current < next &&
+           !next_handle_.compare_exchange_weak(current, next, std::memory_order_relaxed)) {
+    }
+}
+
+std::size_t UserDirectory::reap() {
+    std::size_t reaped = 0;
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lk(shard.mu);
+        for (auto it = shard.users.begin(); it != shard.users.end();) {
+            if (online(it->second)) {
+                ++it;
+            } else {
+                it = shard.users.erase(it);
+                ++reaped;
+            }
+        }
+    }
+    return reaped;
+}
+
+bool UserDirectory::enter_room(const Ulid& user, RoomHandle room, ClientId client) {
+    auto& shard = shard_for(user);
+    std::lock_guard<std::mutex> lk(shard.mu);
+    auto it = shard.users.find(user);
+    if (it == shard.users.end()) return false;
+
+    auto& present = it->second.present;
+    bool first = true;
+    for (const auto& [r, c] : present) {
+        if (r != room) continue;
+        if (c == client) return false;
+        first = false;
+    }
+    present.emplace_back(room, client);
+    return first;
+}
+
+bool UserDirectory::leave_room(const Ulid& user, RoomHandle room, ClientId client) {
+    auto& shard = shard_for(user);
+    std::lock_guard<std::mutex> lk(shard.mu);
+    auto it = shard.users.find(user);
+    if (it == shard.users.end()) return false;
+
+    auto& present = it->second.present;
+    auto pos = std::find(present.begin(), present.end(), std::make_pair(room, client));
+    if (pos == present.end()) return false;
+    *pos = present.back();
+    present.pop_back();
+    return std::none_of(present.begin(), present.end(), [&](const auto& p) { return p.first == room; });
+}
+
+} // namespace simplechat::chat
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <utility>
+
+#include "chat/Ulid.hpp"
+#include "chat/User.h"
+#include "networking/ClientId.hpp"
+#include "protocol/Wire.hpp"
+
+
+namespace simplechat::chat {
+
+// Live users and the sessions (tabs, devices) each has open: the user ->
+// sessions index direct messages route through. A user exists while at
+// least one session is attached, or, when handed over by a predecessor
+// process, until reap() if none ever does.
+//
+// Every user gets a resume token when created; another connection presents
+// it to attach to the same user instead of the guest it started as. Tokens
+// are "<ulid>.<128 random bits in hex>", so a lookup goes straight to the
+// user's shard.
+//
+// Each user also gets a numeric handle, what the binary protocol sends in
+// place of the user id. Handles are per-process and never reused within one;
+// a successor on hot restart takes them over with the users.
+//
+// It also tracks which of a user's sessions are in which room, so presence
+// is announced per user: a join when the first session enters a room, a
+// leave when the last one goes.
+//
+// Users are spread over independently locked shards. A user's session
+// lists are grouped by wire format like Room's members, so a message to a
+// user is encoded once per format its sessions use.
+class UserDirectory {
+public:
+    using ClientId = simplechat::networking::ClientId;
+    using Wire = simplechat::protocol::Wire;
+
+    using RoomHandle = std::uint32_t;  // RoomRegistry's
+    using UserHandle = std::uint32_t;
+
+    struct Identity {
+        std::shared_ptr<User::Profile> profile;  // shared with the user's sessions
+        std::string token;
+        std::size_t sessions = 0;
+        UserHandle handle = 0;
+    };
+
+    // Registers a new user with client as its only session.
+    Identity add(std::shared_ptr<User::Profile> profile, ClientId client, Wire wire);
+
+    // Attaches client to the user token names; nullopt if the token is
+    // malformed, wrong, or its user has no sessions left.
+    std::optional<Identity> attach(std::string_view token, ClientId client, Wire wire);
+
+    // Registers a user handed over on hot restart (chat/Snapshot.h) with no
+    // sessions yet, so its token still attaches and its handle stays.
+    void restore(std::shared_ptr<User::Profile> profile, std::string secret, UserHandle handle);
+
+    // The handle the next new user gets. A successor reserves everything
+    // below its predecessor's, so frames from users gone before the handoff
+    // never name someone else.
+    UserHandle next_handle() const noexcept { return next_handle_.load(std::memory_order_relaxed); }
+    void reserve_handles(UserHandle next) noexcept;
+
+    // Drops restored users no session has attached to; returns how many.
+    std::size_t reap();
+
+    // Runs fn(profile, secret, handle) for every online user, one shard locked at a
+    // time. For snapshots, not hot paths.
+    template <class Fn>
+    void for_each(Fn&& fn) const {
+        for (const auto& shard : shards_) {
+            std::lock_guard<std::mutex> lk(shard.mu);
+            for (const auto& [id, entry] : shard.users) {
+                if (online(entry)) fn(*entry.profile, std::string_view(entry.secret), entry.handle);
+            }
+        }
+    }
+
+    // Detaches client, and takes it out of any room it was still in; true
+    // if that was the user's last session (the user is gone).
+    bool detach(const Ulid& user, ClientId client);
+
+    // The user's identity (token included); nullopt if not online.
+    std::optional<Identity> find(const Ulid& user) const;
+
+    // Records client as in room; true if it is the user's first session
+    // there (announce the join). Repeating it for the same client is a no-op.
+    bool enter_room(const Ulid& user, RoomHandle room, ClientId client);
+
+    // Records client as gone from room; true if it was there and was the
+    // user's last session in it (announce the leave).
+    bool leave_room(const Ulid& user, RoomHandle room, ClientId client);
+
+    // Runs fn(json_sessions, binary_sessions) with the user's shard locked;
+    // false if the user is not online.
+    template <class Fn>
+    bool with_sessions(const Ulid& user, Fn&& fn) const {
+        const auto& shard = shard_for(user);
+        std::lock_guard<std::mutex> lk(shard.mu);
+        auto it = shard.users.find(user);
+        if (it == shard.users.end() || !online(it->second)) return false;
+        fn(it->second.sessions[0], it->second.sessions[1]);
+        return true;
+    }
+
+    // Users online (restored ones count once a session attaches).
+    std::size_t size() const noexcept { return size_.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr std::size_t kShards = 64;
+
+    struct Entry {
+        std::shared_ptr<User::Profile> profile;
+        std::string secret;  // hex, the part of the token after the '.'
+        UserHandle handle = 0;
+        std::array<std::vector<ClientId>, 2> sessions;  // indexed by Wire
+        std::vector<std::pair<RoomHandle, ClientId>> present;  // sessions that entered a room
+    };
+
+    static bool online(const Entry& entry) noexcept {
+        return !entry.sessions[0].empty() || !entry.sessions[1].empty();
+    }
+
+    struct Shard {
+        mutable std::mutex mu;
+        std::unordered_map<Ulid, Entry> users;
+    };
+
+    Shard& shard_for(const Ulid& user) { return shards_[std::hash<Ulid>{}(user) % kShards]; }
+    const Shard& shard_for(const Ulid& user) const { return shards_[std::hash<Ulid>{}(user) % kShards]; }
+
+    std::array<Shard, kShards> shards_;
+    std::atomic<std::size_t> size_{0};
+    std::atomic<UserHandle> next_handle_{1};
+};
+
+} // namespace simplechat::chat
@@ -0,0 +1,532 @@
+#include "cluster/Cluster.h"
+#include "cluster/Link.hpp"
+#include "chat/IDGenerator.hpp"
+#include "logging/Log.h"
+
+#include <boost/asio/connect.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/asio/write.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <set>
+#include <utility>
+
+#include <unistd.h>
+
+namespace simplechat::cluster {
+
+namespace asio = boost::asio;
+using tcp = asio::ip::tcp;
+using error_code = boost::system::error_code;
+
+namespace {
+
+struct ClusterMetrics {
+    explicit ClusterMetrics(metrics::Registry& r)
+        : forwarded(r.counter("simplechat_cluster_forwarded_messages_total", "Messages forwarded to peer nodes")),
+          forwarded_bytes(r.counter("simplechat_cluster_forwarded_bytes_total", "Link bytes queued for peer nodes")),
+          received(r.counter("simplechat_cluster_received_messages_total", "Messages received from peer nodes")),
+          dropped(r.counter("simplechat_cluster_dropped_messages_total", "Messages not forwarded because a peer link was backed up")),
+          peers(r.gauge("simplechat_cluster_peers", "Peer nodes this node is linked to")),
+          batch(r.histogram("simplechat_cluster_batch_frames", "Frames per write to a peer link", metrics::size_buckets())) {}
+
+    metrics::Counter& forwarded;
+    metrics::Counter& forwarded_bytes;
+    metrics::Counter& received;
+    metrics::Counter& dropped;
+    metrics::Gauge& peers;
+    metrics::Histogram& batch;
+};
+
+// One TCP connection to a peer, either direction. Frames are appended to
+// pending_ from any thread; a single write drains everything queued so far,
+// and whatever arrives meanwhile goes out with the next one. Reads and the
+// close path run on the socket's strand.
+class Link : public std::enable_shared_from_this<Link> {
+public:
+    using OnFrame = std::function<void(const LinkFrame&)>;
+    using OnClose = std::function<void(bool self)>;
+
+    Link(tcp::socket socket, std::size_t max_pending, ClusterMetrics& metrics)
+        : socket_(std::move(socket)), max_pending_(max_pending), metrics_(metrics) {}
+
+    // Sends our Hello, then reads. on_frame sees every frame after the
+    // peer's Hello; on_close runs once, with self set if we reached ourselves.
+    void start(const std::string& node_name, OnFrame on_frame, OnClose on_close) {
+        node_name_ = node_name;
+        on_frame_ = std::move(on_frame);
+        on_close_ = std::move(on_close);
+
+        send(frame_size({kLinkMagic, node_name}), [&](std::string& out) {
+            append_frame(out, LinkType::Hello, {kLinkMagic, node_name});
+        });
+        asio::post(socket_.get_executor(), [self = shared_from_this()] { self->read(); });
+    }
+
+    // fill(out) appends frames totalling `bytes`. False if the link is
+    // closed or its buffer is full; nothing is appended then.
+    template <class Fill>
+    bool send(std::size_t bytes, Fill&& fill) {
+        std::lock_guard<std::mutex> lk(mu_);
+        if (closed_ || pending_.size() + bytes > max_pending_) return false;
+
+        fill(pending_);
+        ++pending_frames_;
+        if (!writing_) {
+            writing_ = true;
+            asio::post(socket_.get_executor(), [self = shared_from_this()] { self->flush(); });
+        }
+        return true;
+    }
+
+    void close() {
+        asio::post(socket_.get_executor(), [self = shared_from_this()] {
+            self->fail(asio::error::operation_aborted);
+        });
+    }
+
+    const std::string& peer_name() const noexcept { return peer_name_; }
+
+private:
+    static constexpr std::size_t kReadChunk = 64 * 1024;
+    // Room for one maximal frame plus a read's worth of the next.
+    static constexpr std::size_t kMaxReadBuffer = 4 + kMaxLinkFrame + kReadChunk;
+
+    void flush() {
+        std::size_t frames;
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            inflight_.swap(pending_);
+            pending_.clear();
+            frames = std::exchange(pending_frames_, 0);
+        }
+        metrics_.batch.observe(static_cast<double>(frames));
+
+        asio::async_write(socket_, asio::buffer(inflight_),
+            [self = shared_from_this()](error_code ec, std::size_t) {
+                if (ec) return self->fail(ec);
+                {
+                    std::lock_guard<std::mutex> lk(self->mu_);
+                    if (self->pending_.empty()) {
+                        self->writing_ = false;
+                        return;
+                    }
+                }
+                self->flush();
+            });
+    }
+
+    void read() {
+        if (in_.size() - used_ < kReadChunk / 2) {
+            in_.resize(std::min(std::max(in_.size() * 2, kReadChunk), kMaxReadBuffer));
+        }
+
+        socket_.async_read_some(asio::buffer(in_.data() + used_, in_.size() - used_),
+            [self = shared_from_this()](error_code ec, std::size_t n) {
+                if (ec) return self->fail(ec);
+                self->used_ += n;
+                if (!self->consume()) return self->fail(asio::error::invalid_argument);
+                self->read();
+            });
+    }
+
+    // Dispatches every complete frame in in_ and keeps the tail.
+    bool consume() {
+        bool ok = true;
+        const std::size_t used = parse_frames(std::string_view(in_.data(), used_), [&](const LinkFrame& f) {
+            if (!ok || closed_) return;
+            if (peer_name_.empty()) {
+                ok = hello(f);
+            } else if (on_frame_) {
+                on_frame_(f);
+            }
+        });
+        if (used == std::string_view::npos || !ok) return false;
+
+        std::memmove(in_.data(), in_.data() + used, used_ - used);
+        used_ -= used;
+        return true;
+    }
+
+    bool hello(const LinkFrame& f) {
+        if (f.type != LinkType::Hello || f.count != 2 || f.fields[0] != kLinkMagic || f.fields[1].empty()) {
+            logging::warn("cluster", "bad hello");
+            return false;
+        }
+        if (f.fields[1] == node_name_) {
+            self_ = true;
+            return false;
+        }
+        peer_name_ = std::string(f.fields[1]);
+        return true;
+    }
+
+    void fail(error_code ec) {
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            if (closed_) return;
+            closed_ = true;
+            pending_.clear();
+        }
+        if (ec != asio::error::operation_aborted && ec != asio::error::eof && !self_) {
+            logging::warn("cluster", "link {}: {}", peer_name_.empty() ? std::string_view("?") : std::string_view(peer_name_), ec);
+        }
+
+        error_code ignored;
+        socket_.close(ignored);
+
+        // Dropping the callbacks breaks the owner <-> link reference cycle.
+        on_frame_ = nullptr;
+        if (auto on_close = std::exchange(on_close_, nullptr)) on_close(self_);
+    }
+
+    tcp::socket socket_;
+    const std::size_t max_pending_;
+    ClusterMetrics& metrics_;
+
+    std::string node_name_;
+    std::string peer_name_;  // set by the peer's Hello
+    bool self_ = false;
+    OnFrame on_frame_;
+    OnClose on_close_;
+
+    std::mutex mu_;
+    std::string pending_;
+    std::size_t pending_frames_ = 0;
+    bool writing_ = false;
+    bool closed_ = false;
+
+    // Strand only.
+    std::string inflight_;
+    std::string in_;
+    std::size_t used_ = 0;
+};
+
+// "<hostname>:<port>-<ulid>". The address is no use here: every node
+// bound to 0.0.0.0 on the shared cluster port would get the same name and
+// take its peers' hellos for its own.
+std::string default_node_name(unsigned short port) {
+    char host[256] = {};
+    if (::gethostname(host, sizeof(host) - 1) != 0) std::strcpy(host, "node");
+    return std::string(host) + ":" + std::to_string(port) + "-" + chat::IDGenerator().next().to_string();
+}
+
+} // namespace
+
+class Cluster::Impl : public std::enable_shared_from_this<Impl> {
+public:
+    Impl(asio::io_context& ioc, ClusterOptions options)
+        : ioc_(ioc),
+          options_(std::move(options)),
+          own_registry_(options_.metrics ? nullptr : std::make_unique<metrics::Registry>()),
+          metrics_(options_.metrics ? *options_.metrics : *own_registry_),
+          acceptor_(ioc) {
+        if (options_.node_name.empty()) options_.node_name = default_node_name(options_.port);
+    }
+
+    void start() {
+        const tcp::endpoint endpoint(asio::ip::make_address(options_.address), options_.port);
+        acceptor_.open(endpoint.protocol());
+        acceptor_.set_option(asio::socket_base::reuse_address(true));
+        acceptor_.bind(endpoint);
+        acceptor_.listen(asio::socket_base::max_listen_connections);
+        do_accept();
+
+        // Started again after stop(): the peers are already known.
+        if (!peers_.empty()) {
+            for (auto& peer : peers_) peer->dial();
+            return;
+        }
+
+        for (const auto& address : options_.peers) {
+            const auto colon = address.rfind(':');
+            if (colon == std::string::npos) {
+                logging::warn("cluster", "ignoring peer '{}' (expected host:port)", address);
+                continue;
+            }
+            auto peer = std::make_shared<Peer>(*this, address.substr(0, colon), address.substr(colon + 1));
+            peers_.push_back(peer);
+            peer->dial();
+        }
+    }
+
+    void stop() {
+        error_code ec;
+        acceptor_.close(ec);
+        for (auto& peer : peers_) peer->stop();
+
+        std::lock_guard<std::mutex> lk(interest_mu_);
+        for (auto& link : inbound_) link->close();
+    }
+
+    void joined(std::string_view room_id) {
+        std::lock_guard<std::mutex> lk(interest_mu_);
+        auto it = local_.find(room_id);
+        if (it == local_.end()) it = local_.emplace(std::string(room_id), 0).first;
+        if (++it->second == 1) announce(LinkType::Subscribe, room_id);
+    }
+
+    void left(std::string_view room_id) {
+        std::lock_guard<std::mutex> lk(interest_mu_);
+        auto it = local_.find(room_id);
+        if (it == local_.end()) return;
+        if (--it->second == 0) {
+            local_.erase(it);
+            announce(LinkType::Unsubscribe, room_id);
+        }
+    }
+
+    void publish(std::string_view room_id, const networking::Payload& json,
+                 const networking::Payload& binary) {
+        const std::string_view json_frame = json ? std::string_view(json->data()) : std::string_view();
+        const std::string_view binary_frame = binary ? std::string_view(binary->data()) : std::string_view();
+        for (auto& peer : peers_) peer->publish(room_id, json_frame, binary_frame);
+    }
+
+    bool remote_interest(std::string_view room_id) const {
+        for (auto& peer : peers_) {
+            if (peer->wants(room_id)) return true;
+        }
+        return false;
+    }
+
+    OnPublish on_publish_;
+
+private:
+    // A node we dial: where our messages for it go, and where it tells us
+    // which rooms it wants. Redials after reconnect_delay whenever the link
+    // drops; the peer resends its interest on every new link.
+    class Peer : public std::enable_shared_from_this<Peer> {
+    public:
+        Peer(Impl& cluster, std::string host, std::string port)
+            : cluster_(cluster),
+              host_(std::move(host)),
+              port_(std::move(port)),
+              strand_(asio::make_strand(cluster.ioc_)),
+              resolver_(strand_),
+              timer_(strand_) {}
+
+        // Also resumes a stopped peer.
+        void dial() {
+            asio::post(strand_, [self = shared_from_this()] {
+                self->stopped_ = false;
+                self->connect();
+            });
+        }
+
+        void stop() {
+            asio::post(strand_, [self = shared_from_this()] {
+                self->stopped_ = true;
+                ++self->epoch_;
+                self->timer_.cancel();
+                self->resolver_.cancel();
+                std::lock_guard<std::mutex> lk(self->mu_);
+                if (self->link_) self->link_->close();
+            });
+        }
+
+        bool wants(std::string_view room_id) const {
+            std::lock_guard<std::mutex> lk(mu_);
+            return interest_.find(room_id) != interest_.end();
+        }
+
+        void publish(std::string_view room_id, std::string_view json, std::string_view binary) {
+            std::lock_guard<std::mutex> lk(mu_);
+            if (!link_ || interest_.find(room_id) == interest_.end()) return;
+
+            const std::size_t bytes = frame_size({room_id, json, binary});
+            const bool sent = link_->send(bytes, [&](std::string& out) {
+                append_frame(out, LinkType::Publish, {room_id, json, binary});
+            });
+            if (sent) {
+                cluster_.metrics_.forwarded.inc();
+                cluster_.metrics_.forwarded_bytes.inc(bytes);
+            } else {
+                cluster_.metrics_.dropped.inc();
+            }
+        }
+
+    private:
+        // Strand only. Completions from before a stop() carry a stale epoch
+        // and are dropped, so a restarted peer never dials twice.
+        void connect() {
+            if (stopped_) return;
+            resolver_.async_resolve(host_, port_,
+                [self = shared_from_this(), epoch = epoch_](error_code resolve_ec,
+                                                            tcp::resolver::results_type results) {
+                    if (epoch != self->epoch_) return;
+                    if (resolve_ec) return self->retry();
+                    auto socket = std::make_shared<tcp::socket>(self->strand_);
+                    asio::async_connect(*socket, results,
+                        [self, socket, epoch](error_code ec, const tcp::endpoint&) {
+                            if (epoch != self->epoch_) return;
+                            if (ec) return self->retry();
+                            socket->set_option(tcp::no_delay(true), ec);
+                            self->connected(std::move(*socket));
+                        });
+                });
+        }
+
+        void connected(tcp::socket socket) {
+            auto link = std::make_shared<Link>(std::move(socket), cluster_.options_.max_pending_bytes,
+                                               cluster_.metrics_);
+            {
+                std::lock_guard<std::mutex> lk(mu_);
+                link_ = link;
+            }
+            cluster_.metrics_.peers.add(1);
+
+            link->start(cluster_.options_.node_name,
+                [self = shared_from_this()](const LinkFrame& f) { self->on_frame(f); },
+                [self = shared_from_this(), raw = link.get(), epoch = epoch_](bool reached_self) {
+                    self->on_close(raw, epoch, reached_self);
+                });
+        }
+
+        void on_frame(const LinkFrame& f) {
+            if (f.count != 1) return;
+            std::lock_guard<std::mutex> lk(mu_);
+            if (f.type == LinkType::Subscribe) {
+                interest_.emplace(f.fields[0]);
+            } else if (f.type == LinkType::Unsubscribe) {
+                auto it = interest_.find(f.fields[0]);
+                if (it != interest_.end()) interest_.erase(it);
+            }
+        }
+
+        // Runs on the link's strand. link may already have been replaced
+        // if the peer was stopped and dialed again meanwhile.
+        void on_close(const Link* link, std::uint64_t epoch, bool reached_self) {
+            {
+                std::lock_guard<std::mutex> lk(mu_);
+                if (link_.get() == link) {
+                    link_.reset();
+                    interest_.clear();
+                }
+            }
+            cluster_.metrics_.peers.add(-1);
+
+            if (reached_self) {
+                logging::info("cluster", "{}:{} is this node; not dialing it", host_, port_);
+                return;
+            }
+            asio::post(strand_, [self = shared_from_this(), epoch] {
+                if (epoch == self->epoch_) self->retry();
+            });
+        }
+
+        // Strand only.
+        void retry() {
+            if (stopped_) return;
+            timer_.expires_after(cluster_.options_.reconnect_delay);
+            timer_.async_wait([self = shared_from_this(), epoch = epoch_](error_code ec) {
+                if (!ec && epoch == self->epoch_) self->connect();
+            });
+        }
+
+        Impl& cluster_;
+        const std::string host_;
+        const std::string port_;
+
+        asio::strand<asio::io_context::executor_type> strand_;
+        tcp::resolver resolver_;
+        asio::steady_timer timer_;
+        bool stopped_ = false;     // strand only
+        std::uint64_t epoch_ = 0;  // strand only; bumped by stop()
+
+        mutable std::mutex mu_;
+        std::shared_ptr<Link> link_;
+        std::set<std::string, std::less<>> interest_;  // rooms the peer has members in
+    };
+
+    void do_accept() {
+        acceptor_.async_accept(
+            asio::make_strand(ioc_),
+            [self = shared_from_this()](error_code ec, tcp::socket socket) {
+                if (ec) {
+                    if (ec == asio::error::operation_aborted) return;
+                    logging::warn("cluster", "accept: {}", ec);
+                    return self->do_accept();
+                }
+                socket.set_option(tcp::no_delay(true), ec);
+                self->accepted(std::move(socket));
+                self->do_accept();
+            });
+    }
+
+    // A peer dialed us: it publishes on this link, and we keep it told
+    // which rooms we have members in.
+    void accepted(tcp::socket socket) {
+        auto link = std::make_shared<Link>(std::move(socket), options_.max_pending_bytes, metrics_);
+
+        // Hello, then the current interest, then live updates: all queued
+        // under interest_mu_ so none can be missed or reordered.
+        std::lock_guard<std::mutex> lk(interest_mu_);
+        inbound_.push_back(link);
+        link->start(options_.node_name,
+            [self = shared_from_this()](const LinkFrame& f) {
+                if (f.type != LinkType::Publish || f.count != 3) return;
+                self->metrics_.received.inc();
+                if (self->on_publish_) self->on_publish_(f.fields[0], f.fields[1], f.fields[2]);
+            },
+            [self = shared_from_this(), raw = link.get()](bool) {
+                std::lock_guard<std::mutex> guard(self->interest_mu_);
+                auto& links = self->inbound_;
+                links.erase(std::remove_if(links.begin(), links.end(),
+                                           [&](const auto& l) { return l.get() == raw; }),
+                            links.end());
+            });
+        for (const auto& [room_id, members] : local_) {
+            link->send(frame_size({room_id}), [&](std::string& out) {
+                append_frame(out, LinkType::Subscribe, {room_id});
+            });
+        }
+    }
+
+    // Call with interest_mu_ held.
+    void announce(LinkType type, std::string_view room_id) {
+        for (auto& link : inbound_) {
+            link->send(frame_size({room_id}), [&](std::string& out) { append_frame(out, type, {room_id}); });
+        }
+    }
+
+    asio::io_context& ioc_;
+    ClusterOptions options_;
+
+    std::unique_ptr<metrics::Registry> own_registry_;
+    ClusterMetrics metrics_;
+
+    tcp::acceptor acceptor_;
+    std::vector<std::shared_ptr<Peer>> peers_;  // fixed after start()
+
+    std::mutex interest_mu_;
+    std::map<std::string, std::size_t, std::less<>> local_;  // room -> local members
+    std::vector<std::shared_ptr<Link>> inbound_;
+};
+
+Cluster::Cluster(asio::io_context& ioc, ClusterOptions options)
+    : impl_(std::make_shared<Impl>(ioc, std::move(options))) {}
+
+Cluster::~Cluster() { impl_->stop(); }
+
+void Cluster::set_on_publish(OnPublish cb) { impl_->on_publish_ = std::move(cb); }
+void Cluster::start() { impl_->start(); }
+void Cluster::stop() { impl_->stop(); }
+
+void Cluster::joined(std::string_view room_id) { impl_->joined(room_id); }
+void Cluster::left(std::string_view room_id) { impl_->left(room_id); }
+
+void Cluster::publish(std::string_view room_id, const networking::Payload& json,
+                      const networking::Payload& binary) {
+    impl_->publish(room_id, json, binary);
+}
+
+bool Cluster::remote_interest(std::string_view room_id) const { return impl_->remote_interest(room_id); }
+
+} // namespace simplechat::cluster
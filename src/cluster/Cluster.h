@@ -0,0 +1,94 @@
+#pragma once
+
+#include "metrics/Metrics.h"
+#include "networking/Payload.h"
+
+#include <boost/asio/io_context.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace simplechat::cluster {
+
+struct ClusterOptions {
+    // For logs and self-dial detection, so it must differ between nodes.
+    // Default: "<hostname>:<port>-<ulid>", fresh for each process.
+    std::string node_name;
+
+    // Where peers dial in. Cluster mode is on when port is non-zero.
+    std::string address = "0.0.0.0";
+    unsigned short port = 0;
+
+    // "host:port" of every other node. Every node should list all the others.
+    std::vector<std::string> peers;
+
+    // Forwarded bytes buffered per peer while a write is in flight; beyond
+    // this, messages for that peer are dropped (and counted).
+    std::size_t max_pending_bytes = 16 * 1024 * 1024;
+    std::chrono::milliseconds reconnect_delay = std::chrono::seconds(1);
+
+    // Registry for forwarded/received/dropped counters and batch sizes. If
+    // null the cluster keeps them in a private registry.
+    metrics::Registry* metrics = nullptr;
+};
+
+// Shares rooms between SimpleChat nodes.
+//
+// Each node dials every peer and accepts their dials (see Link.hpp). Local
+// chat messages are forwarded, already encoded, to the peers that have
+// members in the room; each receiving node fans them out to its own members
+// only. Forwarding is batched: frames for a peer accumulate in one buffer
+// while the previous write is in flight, so a busy link costs one write per
+// batch and producers never wait for the network.
+//
+// Interest is reference-counted from joined()/left(); a node tells its
+// peers when a room gains its first local member or loses its last, and
+// sends its full set when a peer (re)connects.
+//
+// Ordering is per sender: messages from one client reach every node in the
+// order sent. Messages from senders on different nodes may interleave
+// differently on each node.
+class Cluster {
+public:
+    // A message published on a peer: room id, then the frame in each wire
+    // format. The binary frame carries the origin's room handle. The views
+    // are only valid for the duration of the call.
+    using OnPublish = std::function<void(std::string_view room_id, std::string_view json,
+                                         std::string_view binary)>;
+
+    Cluster(boost::asio::io_context& ioc, ClusterOptions options);
+    ~Cluster();
+
+    Cluster(const Cluster&) = delete;
+    Cluster& operator=(const Cluster&) = delete;
+
+    void set_on_publish(OnPublish cb);
+
+    // Listen and dial the peers. May be called again after stop(); throws
+    // boost::system::system_error if the port cannot be bound.
+    void start();
+    void stop();
+
+    // A local client entered / left room_id.
+    void joined(std::string_view room_id);
+    void left(std::string_view room_id);
+
+    // Forwards a locally published message to every peer with members in
+    // room_id. Thread-safe; never blocks on the network.
+    void publish(std::string_view room_id, const networking::Payload& json,
+                 const networking::Payload& binary);
+
+    // Whether some connected peer has members in room_id.
+    bool remote_interest(std::string_view room_id) const;
+
+private:
+    class Impl;
+    std::shared_ptr<Impl> impl_;
+};
+
+} // namespace simplechat::cluster
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+
+namespace simplechat::cluster {
+
+// Node-to-node link protocol.
+//
+// A link is one TCP connection from a dialing node to an accepting node.
+// Every frame is a little-endian u32 length (of what follows), a u8 type,
+// then u32-length-prefixed fields:
+//
+//   Hello        both ways, first     magic, node name
+//   Subscribe    acceptor -> dialer   room_id          acceptor has members there
+//   Unsubscribe  acceptor -> dialer   room_id          ...and now has none
+//   Publish      dialer -> acceptor   room_id, json frame, binary frame
+//
+// A node publishes only on links it dialed, and interest travels back on
+// the link it governs, so the two directions between a pair of nodes are
+// independent and need no matching by name.
+enum class LinkType : std::uint8_t {
+    Hello       = 1,
+    Subscribe   = 2,
+    Unsubscribe = 3,
+    Publish     = 4,
+};
+
+inline constexpr std::string_view kLinkMagic = "simplechat.link.v1";
+inline constexpr std::size_t kMaxLinkFields = 3;
+inline constexpr std::size_t kMaxLinkFrame = 16 * 1024 * 1024;
+
+struct LinkFrame {
+    LinkType type{};
+    std::array<std::string_view, kMaxLinkFields> fields;
+    std::size_t count = 0;
+};
+
+inline void put_u32(std::string& out, std::uint32_t v) {
+    const char b[4] = {static_cast<char>(v), static_cast<char>(v >> 8),
+                       static_cast<char>(v >> 16), static_cast<char>(v >> 24)};
+    out.append(b, 4);
+}
+
+inline std::uint32_t get_u32(const char* p) noexcept {
+    const auto* b = reinterpret_cast<const unsigned char*>(p);
+    return std::uint32_t(b[0]) | std::uint32_t(b[1]) << 8 | std::uint32_t(b[2]) << 16 |
+           std::uint32_t(b[3]) << 24;
+}
+
+// Appends one frame to out.
+inline void append_frame(std::string& out, LinkType type, std::initializer_list<std::string_view> fields) {
+    std::size_t body = 1;
+    for (const auto f : fields) body += 4 + f.size();
+
+    out.reserve(out.size() + 4 + body);
+    put_u32(out, static_cast<std::uint32_t>(body));
+    out.push_back(static_cast<char>(type));
+    for (const auto f : fields) {
+        put_u32(out, static_cast<std::uint32_t>(f.size()));
+        out.append(f.data(), f.size());
+    }
+}
+
+inline std::size_t frame_size(std::initializer_list<std::string_view> fields) noexcept {
+    std::size_t n = 5;
+    for (const auto f : fields) n += 4 + f.size();
+    return n;
+}
+
+// Calls fn(const LinkFrame&) for every complete frame at the front of in;
+// views point into in. Returns the bytes consumed, or npos if the stream is
+// malformed (oversized frame or a field running past its frame).
+template <class Fn>
+std::size_t parse_frames(std::string_view in, Fn&& fn) {
+    std::size_t pos = 0;
+    while (in.size() - pos >= 4) {
+        const std::size_t body = get_u32(in.data() + pos);
+        if (body == 0 || body > kMaxLinkFrame) return std::string_view::npos;
+        if (in.size() - pos - 4 < body) break;
+
+        const std::string_view frame = in.substr(pos + 4, body);
+        LinkFrame out;
+        out.type = static_cast<LinkType>(frame[0]);
+
+        std::size_t at = 1;
+        while (at < frame.size()) {
+            if (frame.size() - at < 4 || out.count == kMaxLinkFields) return std::string_view::npos;
+            const std::size_t len = get_u32(frame.data() + at);
+            at += 4;
+            if (frame.size() - at < len) return std::string_view::npos;
+            out.fields[out.count++] = frame.substr(at, len);
+            at += len;
+        }
+
+        fn(static_cast<const LinkFrame&>(out));
+        pos += 4 + body;
+    }
+    return pos;
+}
+
+} // namespace simplechat::cluster
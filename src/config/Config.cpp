@@ -0,0 +1,303 @@
+#include "config/Config.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <string_view>
+#include <vector>
+
+namespace simplechat::config {
+
+namespace {
+
+std::string trim(std::string_view s) {
+    const auto first = s.find_first_not_of(" \t\r");
+    if (first == std::string_view::npos) return {};
+    const auto last = s.find_last_not_of(" \t\r");
+    return std::string(s.substr(first, last - first + 1));
+}
+
+std::uint64_t to_uint(const std::string& key, const std::string& v,
+                      std::uint64_t max = std::numeric_limits<std::uint64_t>::max()) {
+    std::size_t used = 0;
+    unsigned long long n = 0;
+    try {
+        n = std::stoull(v, &used);
+    } catch (const std::exception&) {
+        used = 0;
+    }
+    if (used == 0 || used != v.size() || v.front() == '-' || n > max) {
+        throw ConfigError(key + ": expected an integer up to " + std::to_string(max) + ", got '" + v + "'");
+    }
+    return n;
+}
+
+int to_int_in(const std::string& key, const std::string& v, int lo, int hi) {
+    const auto n = to_uint(key, v, static_cast<std::uint64_t>(hi));
+    if (n < static_cast<std::uint64_t>(lo)) {
+        throw ConfigError(key + ": expected " + std::to_string(lo) + ".." + std::to_string(hi) + ", got '" + v + "'");
+    }
+    return static_cast<int>(n);
+}
+
+double to_double(const std::string& key, const std::string& v) {
+    std::size_t used = 0;
+    double d = 0;
+    try {
+        d = std::stod(v, &used);
+    } catch (const std::exception&) {
+        used = 0;
+    }
+    if (used == 0 || used != v.size() || d < 0) {
+        throw ConfigError(key + ": expected a non-negative number, got '" + v + "'");
+    }
+    return d;
+}
+
+bool to_bool(const std::string& key, const std::string& v) {
+    if (v == "1" || v == "true" || v == "yes" || v == "on") return true;
+    if (v == "0" || v == "false" || v == "no" || v == "off") return false;
+    throw ConfigError(key + ": expected true/false, got '" + v + "'");
+}
+
+logging::Level to_level(const std::string& key, const std::string& v) {
+    logging::Level level;
+    if (!logging::parse_level(v, level)) {
+        throw ConfigError(key + ": expected debug/info/warn/error/off, got '" + v + "'");
+    }
+    return level;
+}
+
+networking::OverflowPolicy to_overflow(const std::string& key, const std::string& v) {
+    const auto policy = networking::overflow_policy_of(v);
+    if (!policy) throw ConfigError(key + ": expected drop-oldest/drop-newest/disconnect, got '" + v + "'");
+    return *policy;
+}
+
+unsigned short to_port(const std::string& key, const std::string& v) {
+    return static_cast<unsigned short>(to_uint(key, v, 65535));
+}
+
+std::chrono::milliseconds to_ms(const std::string& key, const std::string& v) {
+    return std::chrono::milliseconds(to_uint(key, v));
+}
+
+// "a:1, b:2" -> {"a:1", "b:2"}; every entry must be host:port.
+std::vector<std::string> to_peers(const std::string& key, const std::string& v) {
+    std::vector<std::string> out;
+    std::size_t start = 0;
+    while (start <= v.size()) {
+        const auto comma = std::min(v.find(',', start), v.size());
+        std::string peer = trim(std::string_view(v).substr(start, comma - start));
+        start = comma + 1;
+        if (peer.empty()) continue;
+
+        const auto colon = peer.rfind(':');
+        if (colon == std::string::npos || colon == 0) {
+            throw ConfigError(key + ": expected host:port, got '" + peer + "'");
+        }
+        to_port(key, peer.substr(colon + 1));
+        out.push_back(std::move(peer));
+    }
+    return out;
+}
+
+struct Key {
+    const char* name;
+    const char* help;
+    void (*apply)(ServerConfig&, const std::string& key, const std::string& value);
+    bool flag = false;  // boolean: "--name" alone means true
+};
+
+bool is_bool(const std::string& v) {
+    return v == "1" || v == "true" || v == "yes" || v == "on" ||
+           v == "0" || v == "false" || v == "no" || v == "off";
+}
+
+const std::vector<Key>& keys() {
+    static const std::vector<Key> table = {
+        {"port", "WebSocket listen port",
+         [](ServerConfig& c, const std::string& k, const std::string& v) { c.port = to_port(k, v); }},
+        {"threads", "io threads (0 = hardware threads)",
+         [](ServerConfig& c, const std::string& k, const std::string& v) {
+             c.threads = static_cast<unsigned>(to_uint(k, v, 1024));
+         }},
+        {"debug", "echo debug_join/debug_msg to the sender",
+         [](ServerConfig& c, const std::string& k, const std::string& v) { c.debug = to_bool(k, v); }, true},
+        {"log-level", "least severe log level written: debug, info, warn, error or off",
+         [](ServerConfig& c, const std::string& k, const std::string& v) { c.log_level = to_level(k, v); }},
+        {"data-dir", "message log directory ('-' or empty = no persistence)",
+         [](ServerConfig& c, const std::string&, const std::string& v) { c.data_dir = v == "-" ? "" : v; }},
+        {"metrics-address", "metrics endpoint bind address",
+         [](ServerConfig& c, const std::string&, const std::string& v) { c.metrics_address = v; }},
+        {"metrics-port", "metrics endpoint port (0 = off)",
+         [](ServerConfig& c, const std::string& k, const std::string& v) { c.metrics_port = to_port(k, v); }},
+
+        {"client-msgs-per-sec", "per-connection message rate (0 = unlimited)",
+         [](ServerConfig& c, const std::string& k, const std::string& v) { c.client_rate.messages_per_second = to_double(k, v); }},
+        {"client-msg-burst", "per-connection message burst",
+         [](ServerConfig& c, const std::string& k, const std::string& v) { c.client_rate.message_burst = to_double(k, v); }},
+        {"client-bytes-per-sec", "per-connection byte rate (0 = unlimited)",
+         [](ServerConfig& c, const std::string& k, const std::string& v) { c.client_rate.bytes_per_second = to_double(k, v); }},
+        {"client-byte-burst", "per-connection byte burst",
+         [](ServerConfig& c, const std::string& k, const std::string& v) { c.client_rate.byte_burst = to_double(k, v); }},
+        {"room-msgs-per-sec", "per-room chat message rate (0 = unlimited)",
+         [](ServerConfig& c, const std::string& k, const std::string& v) { c.room_rate.messages_per_second = to_double(k, v); }},
+        {"room-msg-burst", "per-room chat message burst",
+         [](ServerConfig& c, const std::string& k, const std::string& v) { c.room_rate.message_burst = to_double(k, v); }},
+        {"room-bytes-per-sec", "per-room chat byte rate (0 = unlimited)",
+         [](ServerConfig& c, const std::string& k, const std::string& v) { c.room_rate.bytes_per_second = to_double(k, v); }},
+        {"room-byte-burst", "per-room chat byte burst",
+         [](ServerConfig& c, const std::string& k, const std::string& v) { c.room_rate.byte_burst = to_double(k, v); }},
+
+        {"history-messages", "messages kept per room for replay",
+         [](ServerConfig& c, const std::string& k, const std::string& v) { c.history.max_messages = to_uint(k, v); }},
+        {"history-bytes", "bytes kept per room for replay",
+         [](ServerConfig& c, const std::string& k, const std::string& v) { c.history.max_bytes = to_uint(k, v); }},
+        {"max-queue-bytes", "per-session outbound queue cap in bytes",
+         [](ServerConfig& c, const std::string& k, const std::string& v) { c.max_queue_bytes = to_uint(k, v); }},
+        {"max-queue-messages", "per-session outbound queue cap in frames",
+         [](ServerConfig& c, const std::string& k, const std::string& v) { c.max_queue_messages = to_uint(k, v); }},
+        {"overflow", "full outbound queue: drop-oldest, drop-newest or disconnect",
+         [](ServerConfig& c, const std::string& k, const std::string& v) { c.overflow = to_overflow(k, v); }},
+        {"write-high-water", "bytes coalesced ahead of the socket before frames queue",
+         [](ServerConfig& c, const std::string& k, const std::string& v) { c.write_high_water = to_uint(k, v); }},
+        {"ping-interval-ms", "ping clients silent for this long",
+         [](ServerConfig& c, const std::string& k, const std::string& v) { c.ping_interval = to_ms(k, v); }},
+        {"idle-timeout-ms", "close clients silent for this long (0 = never)",
+         [](ServerConfig& c, const std::string& k, const std::string& v) { c.idle_timeout = to_ms(k, v); }},
+        {"deflate", "offer permessage-deflate",
+         [](ServerConfig& c, const std::string& k, const std::string& v) { c.deflate.enabled = to_bool(k, v); }, true},
+        {"deflate-window-bits", "server_max_window_bits offered, 9..15",
+         [](ServerConfig& c, const std::string& k, const std::string& v) { c.deflate.window_bits = to_int_in(k, v, 9, 15); }},
+        {"deflate-mem-level", "zlib memory level, 1..9",
+         [](ServerConfig& c, const std::string& k, const std::string& v) { c.deflate.mem_level = to_int_in(k, v, 1, 9); }},
+        {"deflate-level", "zlib compression level, 0..9",
+         [](ServerConfig& c, const std::string& k, const std::string& v) { c.deflate.level = to_int_in(k, v, 0, 9); }},
+        {"deflate-min-size", "messages smaller than this go out uncompressed",
+         [](ServerConfig& c, const std::string& k, const std::string& v) { c.deflate.min_size = to_uint(k, v); }},
+        {"deflate-shared-frames", "compress each broadcast once for every recipient",
+         [](ServerConfig& c, const std::string& k, const std::string& v) { c.deflate.shared_frames = to_bool(k, v); }, true},
+
+        {"node-name", "this node's name in the cluster (default: hostname:port-<ulid>)",
+         [](ServerConfig& c, const std::string&, const std::string& v) { c.node_name = v; }},
+        {"cluster-address", "peer link bind address",
+         [](ServerConfig& c, const std::string&, const std::string& v) { c.cluster_address = v; }},
+        {"cluster-port", "peer link port (0 = single node)",
+         [](ServerConfig& c, const std::string& k, const std::string& v) { c.cluster_port = to_port(k, v); }},
+        {"cluster-peers", "comma-separated host:port of the other nodes",
+         [](ServerConfig& c, const std::string& k, const std::string& v) { c.cluster_peers = to_peers(k, v); }},
+
+        {"presence-ms", "batch join/leave notices per room over this window",
+         [](ServerConfig& c, const std::string& k, const std::string& v) { c.presence_window = to_ms(k, v); }},
+        {"presence-names-max", "rooms larger than this get presence counts only",
+         [](ServerConfig& c, const std::string& k, const std::string& v) { c.presence_names_max = to_uint(k, v); }},
+
+        {"handoff-socket", "Unix socket for hot restart (empty = off)",
+         [](ServerConfig& c, const std::string&, const std::string& v) { c.handoff_socket = v; }},
+        {"drain-ms", "spread client reconnects over this long when handing off",
+         [](ServerConfig& c, const std::string& k, const std::string& v) { c.drain_period = to_ms(k, v); }},
+        {"restore-grace-ms", "drop restored rooms nobody rejoined within this long, unless they have history",
+         [](ServerConfig& c, const std::string& k, const std::string& v) { c.restore_grace = to_ms(k, v); }},
+    };
+    return table;
+}
+
+const Key& find(const std::string& name) {
+    const auto& table = keys();
+    const auto it = std::find_if(table.begin(), table.end(),
+                                 [&](const Key& k) { return name == k.name; });
+    if (it == table.end()) throw ConfigError("unknown option '" + name + "'");
+    return *it;
+}
+
+void load_file(ServerConfig& cfg, const std::string& path) {
+    std::ifstream in(path);
+    if (!in) throw ConfigError("cannot open config file '" + path + "'");
+
+    std::string line;
+    for (int lineno = 1; std::getline(in, line); ++lineno) {
+        const auto hash = line.find('#');
+        if (hash != std::string::npos) line.resize(hash);
+        if (trim(line).empty()) continue;
+
+        const auto eq = line.find('=');
+        if (eq == std::string::npos) {
+            throw ConfigError(path + ":" + std::to_string(lineno) + ": expected 'key = value'");
+        }
+        try {
+            set(cfg, trim(std::string_view(line).substr(0, eq)), trim(std::string_view(line).substr(eq + 1)));
+        } catch (const ConfigError& e) {
+            throw ConfigError(path + ":" + std::to_string(lineno) + ": " + e.what());
+        }
+    }
+}
+
+} // namespace
+
+void set(ServerConfig& cfg, const std::string& key, const std::string& value) {
+    find(key).apply(cfg, key, value);
+}
+
+ServerConfig load(int argc, char* argv[]) {
+    ServerConfig cfg;
+    std::vector<std::string> args(argv + 1, argv + argc);
+
+    // The file goes first wherever --config appears, so the CLI overrides it.
+    for (std::size_t i = 0; i < args.size(); ++i) {
+        if (args[i] == "--config") {
+            if (i + 1 == args.size()) throw ConfigError("--config needs a path");
+            load_file(cfg, args[i + 1]);
+            args.erase(args.begin() + i, args.begin() + i + 2);
+            break;
+        }
+        if (args[i].rfind("--config=", 0) == 0) {
+            load_file(cfg, args[i].substr(9));
+            args.erase(args.begin() + i);
+            break;
+        }
+    }
+
+    static const char* const positional[] = {"port", "threads", "data-dir", "metrics-port"};
+    std::size_t next_positional = 0;
+
+    for (std::size_t i = 0; i < args.size(); ++i) {
+        const std::string& arg = args[i];
+        if (arg.rfind("--", 0) != 0) {
+            if (next_positional == std::size(positional)) {
+                throw ConfigError("unexpected argument '" + arg + "'");
+            }
+            set(cfg, positional[next_positional++], arg);
+            continue;
+        }
+
+        std::string key = arg.substr(2);
+        std::string value;
+        if (const auto eq = key.find('='); eq != std::string::npos) {
+            value = key.substr(eq + 1);
+            key.resize(eq);
+        } else if (find(key).flag) {
+            // Flags take a value only if one follows, so "--debug 9002" works.
+            value = i + 1 < args.size() && is_bool(args[i + 1]) ? args[++i] : "true";
+        } else if (i + 1 < args.size()) {
+            value = args[++i];
+        } else {
+            throw ConfigError("--" + key + " needs a value");
+        }
+        set(cfg, key, value);
+    }
+    return cfg;
+}
+
+void print_usage(std::ostream& out, const char* argv0) {
+    out << "usage: " << argv0 << " [--config FILE] [--key value ...] [port] [threads] [data_dir] [metrics_port]\n"
+        << "keys (also valid as 'key = value' lines in FILE):\n";
+    for (const auto& k : keys()) {
+        const std::string name = k.name;
+        out << "  --" << name << std::string(name.size() < 22 ? 22 - name.size() : 1, ' ') << k.help << "\n";
+    }
+}
+
+} // namespace simplechat::config
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "chat/History.h"
+#include "chat/RateLimit.hpp"
+#include "logging/Log.h"
+#include "networking/Deflate.h"
+#include "networking/Overflow.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace simplechat::config {
+
+// Everything the server can be told at startup. Defaults are production
+// settings; debug traffic is off unless asked for.
+struct ServerConfig {
+    unsigned short port = 9002;
+    unsigned threads = 0;  // 0: one per hardware thread
+    bool debug = false;    // debug_join / debug_msg echoes to the sender
+    logging::Level log_level = logging::Level::Info;
+
+    std::string data_dir;  // empty: nothing is persisted
+
+    std::string metrics_address = "127.0.0.1";
+    unsigned short metrics_port = 9102;  // 0: no metrics endpoint
+
+    // Ingress budgets (see chat::RateLimit; zero rate = unlimited).
+    chat::RateLimit client_rate{20, 40, 64 * 1024, 256 * 1024};
+    chat::RateLimit room_rate{1000, 2000, 1024 * 1024, 4 * 1024 * 1024};
+
+    chat::HistoryLimits history;
+
+    // Per-session outbound queue caps and liveness (WebSocketServer::Options).
+    std::size_t max_queue_bytes = 4 * 1024 * 1024;
+    std::size_t max_queue_messages = 4096;
+    networking::OverflowPolicy overflow = networking::OverflowPolicy::DropOldest;
+    std::size_t write_high_water = 64 * 1024;
+    std::chrono::milliseconds ping_interval = std::chrono::seconds(20);
+    std::chrono::milliseconds idle_timeout = std::chrono::seconds(60);
+    networking::DeflateOptions deflate;
+
+    // Cluster mode (cluster::ClusterOptions); off while cluster_port is 0.
+    std::string node_name;  // default: "<hostname>:<cluster_port>-<ulid>"
+    std::string cluster_address = "0.0.0.0";
+    unsigned short cluster_port = 0;
+    std::vector<std::string> cluster_peers;  // host:port of every other node
+
+    // Join/leave notices go out batched per room every presence_window
+    // (0: as soon as possible, still one frame per room). Rooms with more
+    // members than presence_names_max get counts without names.
+    std::chrono::milliseconds presence_window{100};
+    std::size_t presence_names_max = 500;
+
+    // Hot restart (networking/Handoff.h). A process started with the same
+    // socket path as a running one takes over its listener and rooms.
+    std::string handoff_socket;  // empty: off
+    std::chrono::milliseconds drain_period = std::chrono::seconds(10);
+    // Rooms restored from the log or a predecessor that nobody has rejoined
+    // after this long are torn down, unless they have history to replay.
+    std::chrono::milliseconds restore_grace = std::chrono::minutes(1);
+};
+
+class ConfigError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// Builds the configuration from, in increasing precedence: defaults, the
+// file named by --config, then the remaining command line.
+//
+// File: one "key = value" per line; '#' starts a comment.
+// CLI:  --key value | --key=value | --debug (bare flag = true).
+//       Bare arguments are read as [port] [threads] [data_dir] [metrics_port].
+//
+// Throws ConfigError naming the offending key or line.
+ServerConfig load(int argc, char* argv[]);
+
+// Applies one key to cfg; what both the file and the CLI go through.
+void set(ServerConfig& cfg, const std::string& key, const std::string& value);
+
+// Key reference for --help.
+void print_usage(std::ostream& out, const char* argv0);
+
+} // namespace simplechat::config
@@ -0,0 +1,335 @@
+#include "logging/Log.h"
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+namespace simplechat::logging {
+
+namespace {
+
+using detail::Arg;
+using detail::Record;
+
+constexpr std::size_t kRingSize = 1024;  // records per thread
+constexpr auto kFlushInterval = std::chrono::milliseconds(50);
+
+// Per call site: kBurst records per kRateWindow.
+constexpr std::uint32_t kBurst = 20;
+constexpr std::int64_t kRateWindow = 1'000'000'000;
+constexpr std::size_t kSites = 512;
+
+// Single producer (the owning thread), single consumer (the writer).
+struct Ring {
+    std::array<Record, kRingSize> slots;
+    alignas(64) std::atomic<std::size_t> head{0};  // next to read
+    alignas(64) std::atomic<std::size_t> tail{0};  // next to write
+    std::atomic<std::uint64_t> dropped{0};
+    std::atomic<bool> retired{false};  // owner exited; freed once drained
+    std::uint32_t thread = 0;
+};
+
+// Lossy by design: sites that collide in the table share (or reset) a
+// budget, which only ever lets a few extra records through.
+struct Site {
+    std::atomic<const char*> format{nullptr};
+    std::atomic<std::int64_t> window{0};
+    std::atomic<std::uint32_t> count{0};
+    std::atomic<std::uint32_t> suppressed{0};
+};
+
+const char* level_name(Level level) noexcept {
+    switch (level) {
+        case Level::Debug: return "DEBUG";
+        case Level::Info:  return "INFO ";
+        case Level::Warn:  return "WARN ";
+        case Level::Error: return "ERROR";
+        case Level::Off:   break;
+    }
+    return "?    ";
+}
+
+std::int64_t now_ns() noexcept {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void format_arg(std::string& out, const Record& r, const Arg& a) {
+    switch (a.kind) {
+        case Arg::Kind::Int:    out += std::to_string(a.i); break;
+        case Arg::Kind::Uint:   out += std::to_string(a.u); break;
+        case Arg::Kind::Double: out += std::to_string(a.d); break;
+        case Arg::Kind::Text:   out.append(r.text + a.text.offset, a.text.length); break;
+        case Arg::Kind::Error:  out += a.error.describe(a.error.category, a.error.value); break;
+    }
+}
+
+// "2026-01-02T03:04:05.678Z INFO  ws#3: text\n"
+void format_record(std::string& out, const Record& r) {
+    const std::time_t secs = static_cast<std::time_t>(r.time_ns / 1'000'000'000);
+    const int millis = static_cast<int>((r.time_ns / 1'000'000) % 1000);
+    std::tm tm{};
+    ::gmtime_r(&secs, &tm);
+
+    char stamp[40];
+    const int n = std::snprintf(stamp, sizeof(stamp), "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ ",
+                                tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour,
+                                tm.tm_min, tm.tm_sec, millis);
+    out.append(stamp, static_cast<std::size_t>(n));
+    out += level_name(r.level);
+    out += ' ';
+    out += r.component;
+    out += '#';
+    out += std::to_string(r.thread);
+    out += ": ";
+
+    std::size_t next = 0;
+    for (const char* p = r.format; *p; ++p) {
+        if (p[0] == '{' && p[1] == '}') {
+            if (next < r.nargs) format_arg(out, r, r.args[next++]);
+            ++p;
+        } else {
+            out += *p;
+        }
+    }
+    if (r.suppressed) {
+        out += " (+";
+        out += std::to_string(r.suppressed);
+        out += " similar suppressed)";
+    }
+    out += '\n';
+}
+
+void write_out(const std::string& text) noexcept {
+    const char* p = text.data();
+    std::size_t left = text.size();
+    while (left > 0) {
+        const ssize_t n = ::write(STDERR_FILENO, p, left);
+        if (n <= 0) return;  // nowhere left to report it
+        p += n;
+        left -= static_cast<std::size_t>(n);
+    }
+}
+
+class Logger {
+public:
+    Logger() : writer_([this] { run(); }) {}
+    ~Logger() { stop(); }
+
+    std::shared_ptr<Ring> attach() {
+        auto ring = std::make_shared<Ring>();
+        std::lock_guard<std::mutex> lk(rings_mu_);
+        ring->thread = next_thread_++;
+        rings_.push_back(ring);
+        return ring;
+    }
+
+    void wake() { cv_.notify_one(); }
+
+    bool stopped() const noexcept { return stopped_.load(std::memory_order_acquire); }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            if (stopping_) return;
+            stopping_ = true;
+        }
+        cv_.notify_one();
+        if (writer_.joinable()) writer_.join();
+        stopped_.store(true, std::memory_order_release);
+        drain();  // anything that raced the writer's last pass
+    }
+
+    Site& site(const char* format) noexcept {
+        return sites_[(reinterpret_cast<std::uintptr_t>(format) >> 3) % kSites];
+    }
+
+private:
+    void run() {
+        std::unique_lock<std::mutex> lk(mu_);
+        while (!stopping_) {
+            cv_.wait_for(lk, kFlushInterval);
+            lk.unlock();
+            drain();
+            lk.lock();
+        }
+        lk.unlock();
+        drain();
+    }
+
+    void drain() {
+        std::lock_guard<std::mutex> drain_lk(drain_mu_);
+        std::vector<std::shared_ptr<Ring>> rings;
+        {
+            std::lock_guard<std::mutex> lk(rings_mu_);
+            rings = rings_;
+        }
+
+        batch_.clear();
+        for (const auto& ring : rings) {
+            const bool retired = ring->retired.load(std::memory_order_acquire);
+            std::size_t head = ring->head.load(std::memory_order_relaxed);
+            const std::size_t tail = ring->tail.load(std::memory_order_acquire);
+            for (; head != tail; ++head) format_record(batch_, ring->slots[head % kRingSize]);
+            ring->head.store(head, std::memory_order_release);
+
+            if (const auto dropped = ring->dropped.exchange(0, std::memory_order_relaxed)) {
+                Record r{};
+                r.time_ns = now_ns();
+                r.component = "logger";
+                r.format = "dropped {} records (ring full)";
+                r.level = Level::Warn;
+                r.thread = ring->thread;
+                r.nargs = 1;
+                r.args[0].kind = Arg::Kind::Uint;
+                r.args[0].u = dropped;
+                format_record(batch_, r);
+            }
+
+            if (retired) {
+                std::lock_guard<std::mutex> lk(rings_mu_);
+                rings_.erase(std::find(rings_.begin(), rings_.end(), ring));
+            }
+        }
+        if (!batch_.empty()) write_out(batch_);
+    }
+
+    std::mutex mu_;
+    std::condition_variable cv_;
+    bool stopping_ = false;
+    std::atomic<bool> stopped_{false};
+
+    std::mutex rings_mu_;
+    std::vector<std::shared_ptr<Ring>> rings_;
+    std::uint32_t next_thread_ = 1;
+
+    std::mutex drain_mu_;  // the writer's last pass vs stop()'s
+    std::string batch_;
+
+    std::array<Site, kSites> sites_;
+    std::thread writer_;  // last: starts once the rest is built
+};
+
+Logger& logger() {
+    static Logger instance;
+    return instance;
+}
+
+// The calling thread's ring, registered on first use and retired when the
+// thread exits.
+struct LocalRing {
+    LocalRing() : ring(logger().attach()) {}
+    ~LocalRing() { ring->retired.store(true, std::memory_order_release); }
+    std::shared_ptr<Ring> ring;
+};
+
+Ring& local_ring() {
+    thread_local LocalRing local;
+    return *local.ring;
+}
+
+// Once the writer is gone, records are formatted here and written directly.
+thread_local Record sync_record;
+thread_local bool sync_pending = false;
+
+} // namespace
+
+bool parse_level(std::string_view name, Level& out) noexcept {
+    static constexpr std::pair<std::string_view, Level> kNames[] = {
+        {"debug", Level::Debug}, {"info", Level::Info}, {"warn", Level::Warn},
+        {"error", Level::Error}, {"off", Level::Off}};
+    for (const auto& [n, level] : kNames) {
+        if (n == name) {
+            out = level;
+            return true;
+        }
+    }
+    return false;
+}
+
+void set_level(Level level) noexcept {
+    detail::threshold.store(static_cast<std::uint8_t>(level), std::memory_order_relaxed);
+}
+
+void shutdown() noexcept { logger().stop(); }
+
+namespace detail {
+
+Record* begin(Level level, const char* component, const char* format) noexcept {
+    Logger& log = logger();
+    const std::int64_t now = now_ns();
+
+    // Rate limit per call site.
+    Site& site = log.site(format);
+    std::uint32_t suppressed = 0;
+    if (site.format.load(std::memory_order_relaxed) != format) {
+        site.format.store(format, std::memory_order_relaxed);
+        site.window.store(now, std::memory_order_relaxed);
+        site.count.store(0, std::memory_order_relaxed);
+        site.suppressed.store(0, std::memory_order_relaxed);
+    } else if (now - site.window.load(std::memory_order_relaxed) >= kRateWindow) {
+        site.window.store(now, std::memory_order_relaxed);
+        site.count.store(0, std::memory_order_relaxed);
+        suppressed = site.suppressed.exchange(0, std::memory_order_relaxed);
+    }
+    if (site.count.fetch_add(1, std::memory_order_relaxed) >= kBurst) {
+        site.suppressed.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Record* r;
+    std::uint32_t thread = 0;
+    if (log.stopped()) {
+        r = &sync_record;
+        sync_pending = true;
+    } else {
+        Ring& ring = local_ring();
+        const std::size_t tail = ring.tail.load(std::memory_order_relaxed);
+        if (tail - ring.head.load(std::memory_order_acquire) == kRingSize) {
+            ring.dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        r = &ring.slots[tail % kRingSize];
+        thread = ring.thread;
+    }
+
+    r->time_ns = now;
+    r->component = component;
+    r->format = format;
+    r->level = level;
+    r->nargs = 0;
+    r->text_size = 0;
+    r->suppressed = suppressed;
+    r->thread = thread;
+    return r;
+}
+
+void commit(Level level) noexcept {
+    if (sync_pending) {
+        sync_pending = false;
+        try {
+            std::string line;
+            format_record(line, sync_record);
+            write_out(line);
+        } catch (...) {
+        }
+        return;
+    }
+
+    Ring& ring = local_ring();
+    ring.tail.store(ring.tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    // Errors go out now; everything else waits for the next flush tick.
+    if (level >= Level::Error) logger().wake();
+}
+
+} // namespace detail
+
+} // namespace simplechat::logging
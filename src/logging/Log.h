@@ -0,0 +1,172 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace simplechat::logging {
+
+enum class Level : std::uint8_t { Debug, Info, Warn, Error, Off };
+
+// "debug" | "info" | "warn" | "error" | "off"; false if unknown.
+bool parse_level(std::string_view name, Level& out) noexcept;
+
+// Asynchronous logger.
+//
+//   logging::warn("ws", "session {} {}: {}", id, what, ec);
+//
+// A call below the current level is one relaxed load and a branch. Anything
+// else is captured into the calling thread's ring as raw arguments (numbers,
+// a copy of the text, an error code's category and value); a background
+// thread formats the records and writes them to stderr in batches, so io
+// threads never take the stderr lock or format anything. A full ring drops
+// the record (counted) rather than block.
+//
+// Each call site (its format string) may log kBurst records per second;
+// the rest are counted, and the count rides on the site's next record.
+//
+// The format is a string literal with {} for each argument in order.
+namespace detail {
+
+inline std::atomic<std::uint8_t> threshold{static_cast<std::uint8_t>(Level::Info)};
+
+inline constexpr std::size_t kMaxArgs = 6;
+inline constexpr std::size_t kTextBytes = 192;  // shared by the string arguments
+
+using DescribeError = std::string (*)(const void* category, int value);
+
+struct Arg {
+    enum class Kind : std::uint8_t { Int, Uint, Double, Text, Error };
+
+    struct TextRef {
+        std::uint16_t offset;
+        std::uint16_t length;
+    };
+    struct ErrorRef {
+        const void* category;
+        DescribeError describe;
+        int value;
+    };
+
+    Kind kind;
+    union {
+        std::int64_t i;
+        std::uint64_t u;
+        double d;
+        TextRef text;
+        ErrorRef error;
+    };
+};
+
+struct Record {
+    std::int64_t time_ns;  // system_clock
+    const char* component;
+    const char* format;
+    Level level;
+    std::uint8_t nargs;
+    std::uint16_t text_size;
+    std::uint32_t suppressed;  // repeats of this site dropped before it
+    std::uint32_t thread;
+    Arg args[kMaxArgs];
+    char text[kTextBytes];
+};
+
+// Claims the next slot in the calling thread's ring; nullptr if the site
+// is over its rate or the ring is full. commit() publishes it.
+Record* begin(Level level, const char* component, const char* format) noexcept;
+void commit(Level level) noexcept;
+
+template <class Category>
+std::string describe(const void* category, int value) {
+    return static_cast<const Category*>(category)->message(value);
+}
+
+template <class T, class = void>
+struct is_error_code : std::false_type {};
+template <class T>
+struct is_error_code<T, std::void_t<decltype(std::declval<const T&>().category()),
+                                    decltype(std::declval<const T&>().value())>> : std::true_type {};
+
+inline void pack_text(Record& r, Arg& a, std::string_view s) noexcept {
+    const std::size_t n = std::min(s.size(), kTextBytes - r.text_size);
+    a.kind = Arg::Kind::Text;
+    a.text = {r.text_size, static_cast<std::uint16_t>(n)};
+    std::memcpy(r.text + r.text_size, s.data(), n);
+    r.text_size = static_cast<std::uint16_t>(r.text_size + n);
+}
+
+template <class T>
+void pack(Record& r, const T& v) noexcept {
+    if (r.nargs == kMaxArgs) return;
+    Arg& a = r.args[r.nargs++];
+
+    if constexpr (std::is_same_v<T, bool>) {
+        pack_text(r, a, v ? "true" : "false");
+    } else if constexpr (std::is_enum_v<T>) {
+        a.kind = Arg::Kind::Int;
+        a.i = static_cast<std::int64_t>(v);
+    } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+        a.kind = Arg::Kind::Int;
+        a.i = v;
+    } else if constexpr (std::is_integral_v<T>) {
+        a.kind = Arg::Kind::Uint;
+        a.u = v;
+    } else if constexpr (std::is_floating_point_v<T>) {
+        a.kind = Arg::Kind::Double;
+        a.d = v;
+    } else if constexpr (is_error_code<T>::value) {
+        // Categories are static objects, so the message can be looked up
+        // later, on the writer thread.
+        using Category = std::remove_cv_t<std::remove_reference_t<decltype(v.category())>>;
+        a.kind = Arg::Kind::Error;
+        a.error = {&v.category(), &describe<Category>, v.value()};
+    } else {
+        pack_text(r, a, std::string_view(v));
+    }
+}
+
+} // namespace detail
+
+inline bool enabled(Level level) noexcept {
+    return static_cast<std::uint8_t>(level) >= detail::threshold.load(std::memory_order_relaxed);
+}
+
+void set_level(Level level) noexcept;
+
+template <class... Args>
+void write(Level level, const char* component, const char* format, const Args&... args) noexcept {
+    if (!enabled(level)) return;
+    detail::Record* r = detail::begin(level, component, format);
+    if (!r) return;
+    (detail::pack(*r, args), ...);
+    detail::commit(level);
+}
+
+template <class... Args>
+void debug(const char* component, const char* format, const Args&... args) noexcept {
+    write(Level::Debug, component, format, args...);
+}
+template <class... Args>
+void info(const char* component, const char* format, const Args&... args) noexcept {
+    write(Level::Info, component, format, args...);
+}
+template <class... Args>
+void warn(const char* component, const char* format, const Args&... args) noexcept {
+    write(Level::Warn, component, format, args...);
+}
+template <class... Args>
+void error(const char* component, const char* format, const Args&... args) noexcept {
+    write(Level::Error, component, format, args...);
+}
+
+// Writes out everything queued and stops the writer thread; records logged
+// afterwards are written synchronously. Call before exiting.
+void shutdown() noexcept;
+
+} // namespace simplechat::logging
@@ -0,0 +1,175 @@
+#include "memory/Pool.h"
+
+#include <mutex>
+#include <vector>
+
+namespace simplechat::memory {
+
+namespace {
+
+constexpr std::size_t kMinBlock = 16;
+constexpr unsigned kClasses = 10;  // 16 B << 0 .. 16 B << 9 (8 KiB)
+
+static_assert((kMinBlock << (kClasses - 1)) == kMaxBlock, "size classes must end at kMaxBlock");
+
+// Smallest c with (kMinBlock << c) >= bytes.
+unsigned class_of(std::size_t bytes) noexcept {
+    if (bytes <= kMinBlock) return 0;
+    return static_cast<unsigned>(64 - __builtin_clzll(static_cast<unsigned long long>(bytes - 1))) - 4;
+}
+
+struct FreeBlock {
+    FreeBlock* next;
+};
+
+// Per-thread lists. Trivially destructible, so blocks freed by other
+// thread_local or static destructors after the thread's cleanup below still
+// find valid state (and go straight to the heap).
+struct BlockCache {
+    FreeBlock* head[kClasses];
+    std::size_t count[kClasses];
+    bool closed;
+};
+
+thread_local BlockCache blocks{};
+
+// Shared stack of kBatch-long chains per class. Also trivially destructible.
+constexpr std::size_t kMaxCentralBatches = 256;
+
+struct Central {
+    std::mutex mu;
+    FreeBlock* batches[kClasses][kMaxCentralBatches];
+    std::size_t depth[kClasses];
+};
+
+Central central{};
+
+std::size_t central_limit(unsigned c) noexcept {
+    const std::size_t fit = kMaxCentralBytes / (kBatch * (kMinBlock << c));
+    return fit < kMaxCentralBatches ? fit : kMaxCentralBatches;
+}
+
+void free_chain(FreeBlock* b) noexcept {
+    while (b) {
+        FreeBlock* next = b->next;
+        ::operator delete(b);
+        b = next;
+    }
+}
+
+// Moves the first kBatch blocks of the thread's list to the central stack.
+void spill(unsigned c) noexcept {
+    FreeBlock* chain = blocks.head[c];
+    FreeBlock* tail = chain;
+    for (std::size_t i = 1; i < kBatch; ++i) tail = tail->next;
+    blocks.head[c] = tail->next;
+    blocks.count[c] -= kBatch;
+    tail->next = nullptr;
+
+    {
+        std::lock_guard<std::mutex> lk(central.mu);
+        if (central.depth[c] < central_limit(c)) {
+            central.batches[c][central.depth[c]++] = chain;
+            return;
+        }
+    }
+    free_chain(chain);
+}
+
+// Refills an empty thread list with one batch; false if there is none.
+bool refill(unsigned c) noexcept {
+    std::lock_guard<std::mutex> lk(central.mu);
+    if (central.depth[c] == 0) return false;
+    blocks.head[c] = central.batches[c][--central.depth[c]];
+    blocks.count[c] = kBatch;
+    return true;
+}
+
+thread_local bool buffers_closed = false;
+
+struct BufferCache {
+    std::vector<std::string> free;
+
+    BufferCache() { free.reserve(kMaxBuffers); }
+    ~BufferCache() { buffers_closed = true; }
+};
+
+BufferCache& buffers() {
+    thread_local BufferCache cache;
+    return cache;
+}
+
+// Returns every cached block to the heap when the thread exits.
+struct ThreadCleanup {
+    ~ThreadCleanup() {
+        for (unsigned c = 0; c < kClasses; ++c) {
+            free_chain(blocks.head[c]);
+            blocks.head[c] = nullptr;
+            blocks.count[c] = 0;
+        }
+        blocks.closed = true;
+    }
+};
+
+void register_cleanup() noexcept {
+    thread_local ThreadCleanup cleanup;
+    (void)cleanup;
+}
+
+} // namespace
+
+void* allocate(std::size_t bytes) {
+    if (bytes > kMaxBlock) return ::operator new(bytes);
+    register_cleanup();
+
+    const unsigned c = class_of(bytes);
+    if (blocks.head[c] || refill(c)) {
+        FreeBlock* b = blocks.head[c];
+        blocks.head[c] = b->next;
+        --blocks.count[c];
+        return b;
+    }
+    return ::operator new(kMinBlock << c);
+}
+
+void deallocate(void* p, std::size_t bytes) noexcept {
+    if (!p) return;
+    if (bytes > kMaxBlock) return ::operator delete(p);
+
+    register_cleanup();
+    if (blocks.closed) return ::operator delete(p);
+
+    const unsigned c = class_of(bytes);
+    auto* b = static_cast<FreeBlock*>(p);
+    b->next = blocks.head[c];
+    blocks.head[c] = b;
+    if (++blocks.count[c] == 2 * kBatch) spill(c);
+}
+
+std::string acquire_buffer(std::size_t reserve) {
+    std::string out;
+    if (buffers_closed) {
+        out.reserve(reserve);
+        return out;
+    }
+    auto& cache = buffers();
+    if (!cache.free.empty()) {
+        out = std::move(cache.free.back());
+        cache.free.pop_back();
+    }
+    out.reserve(reserve);
+    return out;
+}
+
+void release_buffer(std::string&& buffer) noexcept {
+    // Inline (SSO) strings own nothing worth keeping.
+    if (buffer.capacity() <= std::string().capacity() || buffer.capacity() > kMaxBufferBytes) return;
+
+    if (buffers_closed) return;
+    auto& cache = buffers();
+    if (cache.free.size() == kMaxBuffers) return;
+    buffer.clear();
+    cache.free.push_back(std::move(buffer));
+}
+
+} // namespace simplechat::memory
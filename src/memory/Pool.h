@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace simplechat::memory {
+
+// Size-class block pool with per-thread free lists.
+//
+// Requests up to kMaxBlock bytes are rounded up to a power of two (16 B ..
+// 8 KiB) and served from the calling thread's free list for that class, so a
+// recycled block costs a pointer pop and no lock. Freed blocks go to the
+// freeing thread's list. Blocks often die on a different thread than the
+// one that made them (a frame posted to another session's strand), so full
+// lists pass batches of kBatch blocks to a shared central list and empty
+// ones take a batch back: one lock per kBatch operations. The central list
+// keeps at most kMaxCentralBytes per class and frees the rest. Larger
+// requests go straight to operator new.
+inline constexpr std::size_t kMaxBlock = 8 * 1024;
+inline constexpr std::size_t kBatch = 32;
+inline constexpr std::size_t kMaxCentralBytes = 4 * 1024 * 1024;
+
+void* allocate(std::size_t bytes);
+void deallocate(void* p, std::size_t bytes) noexcept;
+
+// Standard allocator over the pool. Stateless: all instances are equal and
+// memory may be freed through any of them, on any thread.
+template <class T>
+class PoolAllocator {
+public:
+    using value_type = T;
+
+    PoolAllocator() noexcept = default;
+    template <class U>
+    PoolAllocator(const PoolAllocator<U>&) noexcept {}
+
+    T* allocate(std::size_t n) {
+        static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "over-aligned type");
+        if (n > std::size_t(-1) / sizeof(T)) throw std::bad_array_new_length();
+        return static_cast<T*>(memory::allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept { memory::deallocate(p, n * sizeof(T)); }
+};
+
+template <class T, class U>
+bool operator==(const PoolAllocator<T>&, const PoolAllocator<U>&) noexcept { return true; }
+template <class T, class U>
+bool operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&) noexcept { return false; }
+
+// Completion-handler wrapper whose associated allocator is the pool, so Asio
+// allocates the operation that carries it (e.g. a post() to a strand) from
+// the pool instead of the heap. Only for handlers with no associated
+// executor of their own: the wrapper hides it.
+template <class Handler>
+class Pooled {
+public:
+    using allocator_type = PoolAllocator<void>;
+
+    explicit Pooled(Handler handler) : handler_(std::move(handler)) {}
+
+    allocator_type get_allocator() const noexcept { return {}; }
+
+    template <class... Args>
+    decltype(auto) operator()(Args&&... args) { return handler_(std::forward<Args>(args)...); }
+
+private:
+    Handler handler_;
+};
+
+template <class Handler>
+Pooled<std::decay_t<Handler>> pooled(Handler&& handler) {
+    return Pooled<std::decay_t<Handler>>(std::forward<Handler>(handler));
+}
+
+// Recycled string buffers for encoded frames. acquire_buffer returns an
+// empty string with at least `reserve` capacity, reusing a released buffer
+// when the thread has one; release_buffer keeps the capacity for the next
+// frame (up to kMaxBufferBytes per buffer, kMaxBuffers per thread).
+inline constexpr std::size_t kMaxBufferBytes = 64 * 1024;
+inline constexpr std::size_t kMaxBuffers = 256;
+
+std::string acquire_buffer(std::size_t reserve);
+void release_buffer(std::string&& buffer) noexcept;
+
+} // namespace simplechat::memory
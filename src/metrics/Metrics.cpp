@@ -0,0 +1,141 @@
+#include "metrics/Metrics.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <utility>
+
+namespace simplechat::metrics {
+
+std::size_t this_thread_shard() noexcept {
+    static std::atomic<std::size_t> next{0};
+    thread_local const std::size_t shard = next.fetch_add(1, std::memory_order_relaxed) % kShards;
+    return shard;
+}
+
+std::uint64_t Counter::value() const noexcept {
+    std::uint64_t sum = 0;
+    for (const auto& s : shards_) sum += s.value.load(std::memory_order_relaxed);
+    return sum;
+}
+
+Histogram::Histogram(std::vector<double> bounds)
+    : bounds_(std::move(bounds)),
+      shards_(new Shard[kShards]) {
+    std::sort(bounds_.begin(), bounds_.end());
+    if (bounds_.size() > kMaxBuckets) bounds_.resize(kMaxBuckets);
+}
+
+void Histogram::observe(double v) noexcept {
+    auto& shard = shards_[this_thread_shard()];
+
+    std::size_t i = 0;
+    while (i < bounds_.size() && v > bounds_[i]) ++i;
+    shard.buckets[i].fetch_add(1, std::memory_order_relaxed);
+
+    // Only this thread (or the few sharing its shard) writes here.
+    double sum = shard.sum.load(std::memory_order_relaxed);
+    while (!shard.sum.compare_exchange_weak(sum, sum + v, std::memory_order_relaxed)) {}
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+    Snapshot snap;
+    snap.bounds = bounds_;
+    snap.cumulative.assign(bounds_.size() + 1, 0);
+
+    for (std::size_t s = 0; s < kShards; ++s) {
+        const auto& shard = shards_[s];
+        for (std::size_t i = 0; i <= bounds_.size(); ++i) {
+            snap.cumulative[i] += shard.buckets[i].load(std::memory_order_relaxed);
+        }
+        snap.sum += shard.sum.load(std::memory_order_relaxed);
+    }
+    for (std::size_t i = 1; i < snap.cumulative.size(); ++i) snap.cumulative[i] += snap.cumulative[i - 1];
+    snap.count = snap.cumulative.back();
+    return snap;
+}
+
+std::vector<double> latency_buckets() {
+    return {0.00001, 0.000025, 0.00005, 0.0001, 0.00025, 0.0005,
+            0.001, 0.0025, 0.005, 0.01, 0.025, 0.05,
+            0.1, 0.25, 0.5, 1, 2.5, 5, 10};
+}
+
+std::vector<double> size_buckets() {
+    return {1, 4, 16, 64, 256, 1024, 4096, 16384, 65536};
+}
+
+Counter& Registry::counter(std::string name, std::string help) {
+    std::lock_guard<std::mutex> lk(mu_);
+    Entry e{std::move(name), std::move(help), Kind::Counter, std::make_unique<Counter>(), nullptr, nullptr};
+    entries_.push_back(std::move(e));
+    return *entries_.back().counter;
+}
+
+Gauge& Registry::gauge(std::string name, std::string help) {
+    std::lock_guard<std::mutex> lk(mu_);
+    Entry e{std::move(name), std::move(help), Kind::Gauge, nullptr, std::make_unique<Gauge>(), nullptr};
+    entries_.push_back(std::move(e));
+    return *entries_.back().gauge;
+}
+
+Histogram& Registry::histogram(std::string name, std::string help, std::vector<double> bounds) {
+    std::lock_guard<std::mutex> lk(mu_);
+    Entry e{std::move(name), std::move(help), Kind::Histogram, nullptr, nullptr,
+            std::make_unique<Histogram>(std::move(bounds))};
+    entries_.push_back(std::move(e));
+    return *entries_.back().histogram;
+}
+
+namespace {
+
+// Shortest form that reads back as v, so bounds render as 1e-05, not 1.0000000000000001e-05.
+void append_number(std::string& out, double v) {
+    char buf[32];
+    for (int precision = 6; precision <= 17; ++precision) {
+        std::snprintf(buf, sizeof(buf), "%.*g", precision, v);
+        if (std::strtod(buf, nullptr) == v) break;
+    }
+    out += buf;
+}
+
+} // namespace
+
+std::string Registry::render() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    std::string out;
+    out.reserve(entries_.size() * 256);
+
+    for (const auto& e : entries_) {
+        out += "# HELP " + e.name + " " + e.help + "\n";
+        switch (e.kind) {
+            case Kind::Counter:
+                out += "# TYPE " + e.name + " counter\n";
+                out += e.name + " " + std::to_string(e.counter->value()) + "\n";
+                break;
+
+            case Kind::Gauge:
+                out += "# TYPE " + e.name + " gauge\n";
+                out += e.name + " " + std::to_string(e.gauge->value()) + "\n";
+                break;
+
+            case Kind::Histogram: {
+                out += "# TYPE " + e.name + " histogram\n";
+                const auto snap = e.histogram->snapshot();
+                for (std::size_t i = 0; i < snap.bounds.size(); ++i) {
+                    out += e.name + "_bucket{le=\"";
+                    append_number(out, snap.bounds[i]);
+                    out += "\"} " + std::to_string(snap.cumulative[i]) + "\n";
+                }
+                out += e.name + "_bucket{le=\"+Inf\"} " + std::to_string(snap.count) + "\n";
+                out += e.name + "_sum ";
+                append_number(out, snap.sum);
+                out += "\n" + e.name + "_count " + std::to_string(snap.count) + "\n";
+                break;
+            }
+        }
+    }
+    return out;
+}
+
+} // namespace simplechat::metrics
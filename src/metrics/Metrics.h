@@ -0,0 +1,110 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace simplechat::metrics {
+
+// Per-thread sharding: every thread writes its own cache line, and readers
+// sum over all shards. Threads are assigned a shard round-robin on first use;
+// with more threads than shards some share one, which stays correct (the
+// adds are atomic), just no longer contention-free.
+inline constexpr std::size_t kShards = 32;
+
+std::size_t this_thread_shard() noexcept;
+
+class Counter {
+public:
+    void inc(std::uint64_t n = 1) noexcept {
+        shards_[this_thread_shard()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    std::uint64_t value() const noexcept;
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<std::uint64_t> value{0};
+    };
+    std::array<Shard, kShards> shards_;
+};
+
+// Last-value metric (open connections, ...). A single atomic: gauges move in
+// both directions and are updated far less often than counters.
+class Gauge {
+public:
+    void add(std::int64_t n) noexcept { value_.fetch_add(n, std::memory_order_relaxed); }
+    void set(std::int64_t v) noexcept { value_.store(v, std::memory_order_relaxed); }
+    std::int64_t value() const noexcept { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<std::int64_t> value_{0};
+};
+
+// Fixed-bucket histogram (Prometheus semantics: bucket i counts values
+// <= bounds[i], plus an implicit +Inf).
+class Histogram {
+public:
+    static constexpr std::size_t kMaxBuckets = 24;
+
+    explicit Histogram(std::vector<double> bounds);
+
+    void observe(double v) noexcept;
+
+    struct Snapshot {
+        std::vector<double> bounds;
+        std::vector<std::uint64_t> cumulative;  // bounds.size() + 1 (+Inf)
+        double sum = 0;
+        std::uint64_t count = 0;
+    };
+    Snapshot snapshot() const;
+
+private:
+    struct alignas(64) Shard {
+        std::array<std::atomic<std::uint64_t>, kMaxBuckets + 1> buckets{};
+        std::atomic<double> sum{0};
+    };
+
+    std::vector<double> bounds_;
+    std::unique_ptr<Shard[]> shards_;
+};
+
+// Common bucket layouts.
+std::vector<double> latency_buckets();   // 10us .. 10s, seconds
+std::vector<double> size_buckets();      // 1 .. 64Ki, powers of four
+
+// Owns named metrics and renders them in the Prometheus text format.
+// Registration is not a hot path (mutex); returned references stay valid
+// for the registry's lifetime.
+class Registry {
+public:
+    Counter& counter(std::string name, std::string help);
+    Gauge& gauge(std::string name, std::string help);
+    Histogram& histogram(std::string name, std::string help, std::vector<double> bounds);
+
+    // Text exposition format, version 0.0.4.
+    std::string render() const;
+
+private:
+    enum class Kind { Counter, Gauge, Histogram };
+
+    struct Entry {
+        std::string name;
+        std::string help;
+        Kind kind;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::unique_ptr<Histogram> histogram;
+    };
+
+    mutable std::mutex mu_;
+    std::vector<Entry> entries_;
+};
+
+} // namespace simplechat::metrics
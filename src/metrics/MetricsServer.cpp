@@ -0,0 +1,115 @@
+#include "metrics/MetricsServer.h"
+
+#include "logging/Log.h"
+
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+
+#include <chrono>
+
+namespace simplechat::metrics {
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace asio = boost::asio;
+using tcp = asio::ip::tcp;
+
+class MetricsServer::Impl : public std::enable_shared_from_this<Impl> {
+public:
+    Impl(asio::io_context& ioc, const std::string& address, unsigned short port, const Registry& registry)
+        : ioc_(ioc),
+          endpoint_(asio::ip::make_address(address), port),
+          acceptor_(ioc, endpoint_),
+          registry_(registry) {}
+
+    void start() {
+        if (!acceptor_.is_open()) {
+            acceptor_.open(endpoint_.protocol());
+            acceptor_.set_option(asio::socket_base::reuse_address(true));
+            acceptor_.bind(endpoint_);
+            acceptor_.listen(asio::socket_base::max_listen_connections);
+        }
+        do_accept();
+    }
+
+    void stop() {
+        beast::error_code ec;
+        acceptor_.close(ec);
+    }
+
+private:
+    struct Connection {
+        explicit Connection(tcp::socket socket) : stream(std::move(socket)) {}
+
+        beast::tcp_stream stream;
+        beast::flat_buffer buffer;
+        http::request<http::empty_body> req;
+        http::response<http::string_body> res;
+    };
+
+    void do_accept() {
+        acceptor_.async_accept(
+            asio::make_strand(ioc_),
+            [self = shared_from_this()](beast::error_code ec, tcp::socket socket) {
+                if (ec) {
+                    if (ec == asio::error::operation_aborted) return;
+                    logging::warn("metrics", "accept: {}", ec);
+                    return self->do_accept();
+                }
+                self->serve(std::make_shared<Connection>(std::move(socket)));
+                self->do_accept();
+            });
+    }
+
+    void serve(std::shared_ptr<Connection> conn) {
+        conn->stream.expires_after(std::chrono::seconds(10));
+        http::async_read(
+            conn->stream, conn->buffer, conn->req,
+            [self = shared_from_this(), conn](beast::error_code ec, std::size_t) {
+                if (ec) return;
+                self->respond(conn);
+            });
+    }
+
+    void respond(const std::shared_ptr<Connection>& conn) {
+        auto& res = conn->res;
+        res.version(conn->req.version());
+        res.keep_alive(false);
+
+        if (conn->req.method() == http::verb::get && conn->req.target() == "/metrics") {
+            res.result(http::status::ok);
+            res.set(http::field::content_type, "text/plain; version=0.0.4");
+            res.body() = registry_.render();
+        } else {
+            res.result(http::status::not_found);
+            res.set(http::field::content_type, "text/plain");
+            res.body() = "not found\n";
+        }
+        res.prepare_payload();
+
+        http::async_write(
+            conn->stream, res,
+            [conn](beast::error_code, std::size_t) {
+                beast::error_code ec;
+                conn->stream.socket().shutdown(tcp::socket::shutdown_send, ec);
+            });
+    }
+
+    asio::io_context& ioc_;
+    const tcp::endpoint endpoint_;
+    tcp::acceptor acceptor_;
+    const Registry& registry_;
+};
+
+MetricsServer::MetricsServer(asio::io_context& ioc, const std::string& address,
+                             unsigned short port, const Registry& registry)
+    : impl_(std::make_shared<Impl>(ioc, address, port, registry)) {}
+
+MetricsServer::~MetricsServer() { impl_->stop(); }
+
+void MetricsServer::start() { impl_->start(); }
+void MetricsServer::stop() { impl_->stop(); }
+
+} // namespace simplechat::metrics
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "metrics/Metrics.h"
+
+#include <boost/asio/io_context.hpp>
+
+#include <memory>
+#include <string>
+
+namespace simplechat::metrics {
+
+// Minimal HTTP/1.1 endpoint for Prometheus scrapes: GET /metrics returns
+// registry.render(), anything else 404. Runs on the caller's io_context, one
+// request per connection.
+class MetricsServer {
+public:
+    MetricsServer(boost::asio::io_context& ioc, const std::string& address,
+                  unsigned short port, const Registry& registry);
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    // May be called again after stop(); throws boost::system::system_error
+    // if the port has been taken meanwhile.
+    void start();
+    void stop();
+
+private:
+    class Impl;
+    std::shared_ptr<Impl> impl_;
+};
+
+} // namespace simplechat::metrics
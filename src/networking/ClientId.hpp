@@ -0,0 +1,11 @@
+#pragma once
+#include <cstdint>
+
+namespace simplechat::networking {
+
+// Numeric handle for one accepted WebSocket connection:
+// (generation << 32) | slot index in the server's SessionTable. Never 0, and
+// not reused for a later connection in the same slot.
+using ClientId = std::uint64_t;
+
+} // namespace simplechat::networking
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/beast/core/bind_handler.hpp>
+#include <boost/beast/core/error.hpp>
+#include <boost/beast/core/role.hpp>
+#include <boost/beast/websocket/teardown.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace simplechat::networking {
+
+// Write-combining layer that sits between websocket::stream and the socket.
+//
+// Beast issues one write per WebSocket frame. Here each frame is queued and
+// the write completes right away; everything queued goes to the socket as one
+// gathered write. While that write is in flight, further frames accumulate
+// and leave together in the next one, so a busy session costs one syscall per
+// batch instead of one per message.
+//
+// Frames written through async_write_some are copied, since Beast reuses its
+// buffers once the write completes; consecutive copies share one chunk.
+// Frames the owner built whole go through async_write_frame instead: the body
+// is referenced in place and the object owning it is held until it is sent.
+//
+// Once more than high_water_mark() bytes are buffered, new writes complete
+// only after the socket drains. The session's own queue then grows and its
+// overflow policy applies.
+//
+// Not thread-safe: all calls must come from the stream's executor (strand).
+template <class NextLayer>
+class CoalescingStream {
+public:
+    using next_layer_type = NextLayer;
+    using executor_type = typename NextLayer::executor_type;
+
+    template <class... Args>
+    explicit CoalescingStream(Args&&... args)
+        : next_(std::forward<Args>(args)...) {}
+
+    executor_type get_executor() noexcept { return next_.get_executor(); }
+
+    next_layer_type& next_layer() noexcept { return next_; }
+    const next_layer_type& next_layer() const noexcept { return next_; }
+
+    std::size_t high_water_mark() const noexcept { return high_water_; }
+    void high_water_mark(std::size_t bytes) noexcept { high_water_ = bytes; }
+
+    // The owner is kept alive while a flush is in flight.
+    void keep_alive(std::weak_ptr<void> owner) { owner_ = std::move(owner); }
+
+    // Bytes accepted from the WebSocket layer but not yet written to the socket.
+    std::size_t buffered() const noexcept { return pending_bytes_ + inflight_bytes_; }
+
+    template <class MutableBufferSequence, class ReadHandler>
+    auto async_read_some(const MutableBufferSequence& buffers, ReadHandler&& handler) {
+        return next_.async_read_some(buffers, std::forward<ReadHandler>(handler));
+    }
+
+    template <class ConstBufferSequence, class WriteHandler>
+    auto async_write_some(const ConstBufferSequence& buffers, WriteHandler&& handler) {
+        return boost::asio::async_initiate<WriteHandler, void(boost::beast::error_code, std::size_t)>(
+            [this](auto h, const ConstBufferSequence& b) {
+                if (error_) return complete(std::move(h), error_, 0);
+                const std::size_t n = boost::asio::buffer_size(b);
+                copy(b, n);
+                queued(n, std::move(h));
+            },
+            handler, buffers);
+    }
+
+    // Queues a complete frame: `header` is copied, `body` is sent in place and
+    // must stay valid while `keep` is alive. Completes like async_write_some.
+    template <class WriteHandler>
+    auto async_write_frame(boost::asio::const_buffer header,
+                           boost::asio::const_buffer body,
+                           std::shared_ptr<const void> keep,
+                           WriteHandler&& handler) {
+        return boost::asio::async_initiate<WriteHandler, void(boost::beast::error_code, std::size_t)>(
+            [this, header, body](auto h, std::shared_ptr<const void> keep) {
+                if (error_) return complete(std::move(h), error_, 0);
+                copy(header, header.size());
+                if (body.size() > 0) {
+                    pending_.push_back({std::move(keep), {}, body});
+                    pending_bytes_ += body.size();
+                }
+                queued(header.size() + body.size(), std::move(h));
+            },
+            handler, std::move(keep));
+    }
+
+    // Flush buffered frames before shutting the socket down, so a close
+    // frame accepted above is not lost.
+    template <class TeardownHandler>
+    friend void async_teardown(boost::beast::role_type role,
+                               CoalescingStream& stream,
+                               TeardownHandler&& handler) {
+        auto h = std::make_shared<std::decay_t<TeardownHandler>>(
+            std::forward<TeardownHandler>(handler));
+        stream.when_drained([&stream, role, h] {
+            using boost::beast::websocket::async_teardown;
+            async_teardown(role, stream.next_, std::move(*h));
+        });
+    }
+
+private:
+    // A run of queued bytes: either a copy or a view kept valid by `keep`.
+    struct Chunk {
+        std::shared_ptr<const void> keep;
+        std::string copy;
+        boost::asio::const_buffer view;
+
+        boost::asio::const_buffer buffer() const {
+            return keep ? view : boost::asio::buffer(copy);
+        }
+    };
+
+    template <class Buffers>
+    void copy(const Buffers& buffers, std::size_t n) {
+        if (n == 0) return;
+        if (pending_.empty() || pending_.back().keep) pending_.emplace_back();
+        std::string& out = pending_.back().copy;
+        const std::size_t at = out.size();
+        out.resize(at + n);
+        boost::asio::buffer_copy(boost::asio::buffer(&out[at], n), buffers);
+        pending_bytes_ += n;
+    }
+
+    template <class Handler>
+    void queued(std::size_t n, Handler handler) {
+        if (!writing_) flush();
+
+        if (buffered() < high_water_) return complete(std::move(handler), {}, n);
+
+        // Backpressure: hold the completion until the socket catches up.
+        auto h = std::make_shared<Handler>(std::move(handler));
+        blocked_.emplace_back([this, h, n](boost::beast::error_code ec) {
+            complete(std::move(*h), ec, ec ? 0 : n);
+        });
+    }
+
+    void flush() {
+        writing_ = true;
+        std::swap(pending_, inflight_);
+        std::swap(pending_bytes_, inflight_bytes_);
+
+        // inflight_ is left alone until the write completes, so the views stay put.
+        gather_.clear();
+        for (const auto& chunk : inflight_) gather_.push_back(chunk.buffer());
+
+        boost::asio::async_write(
+            next_, gather_,
+            [this, owner = owner_.lock()](boost::beast::error_code ec, std::size_t) {
+                inflight_.clear();
+                inflight_bytes_ = 0;
+                writing_ = false;
+
+                if (ec) error_ = ec;
+                else if (!pending_.empty()) flush();
+
+                auto blocked = std::move(blocked_);
+                blocked_.clear();
+                for (auto& resume : blocked) resume(error_);
+
+                if (!writing_) {
+                    auto drained = std::move(drained_);
+                    drained_.clear();
+                    for (auto& fn : drained) fn();
+                }
+            });
+    }
+
+    void when_drained(std::function<void()> fn) {
+        if (!writing_) {
+            boost::asio::post(next_.get_executor(), std::move(fn));
+            return;
+        }
+        drained_.push_back(std::move(fn));
+    }
+
+    // Completions are always posted, never invoked from inside the initiating call.
+    template <class Handler>
+    void complete(Handler&& handler, boost::beast::error_code ec, std::size_t n) {
+        boost::asio::post(next_.get_executor(),
+                          boost::beast::bind_front_handler(std::forward<Handler>(handler), ec, n));
+    }
+
+    NextLayer next_;
+    std::weak_ptr<void> owner_;
+
+    std::vector<Chunk> pending_;
+    std::vector<Chunk> inflight_;
+    std::vector<boost::asio::const_buffer> gather_;
+    std::size_t pending_bytes_ = 0;
+    std::size_t inflight_bytes_ = 0;
+    bool writing_ = false;
+    boost::beast::error_code error_;
+    std::size_t high_water_ = 64 * 1024;
+
+    std::vector<std::function<void(boost::beast::error_code)>> blocked_;
+    std::vector<std::function<void()>> drained_;
+};
+
+} // namespace simplechat::networking
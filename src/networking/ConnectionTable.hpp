@@ -0,0 +1,141 @@
+#pragma once
+
+#include "networking/ClientId.hpp"
+#include "networking/Session.hpp"
+#include "networking/SessionTable.hpp"
+#include "protocol/Wire.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+namespace simplechat::networking {
+
+// The application's per-connection state, indexed by the slot half of the
+// ClientId: the same dense index the server's SessionTable hands out, so a
+// lookup is index arithmetic plus a generation compare, with no hashing and
+// no lock.
+//
+// Rows are stored as parallel arrays. The fields every inbound message and
+// every send needs (id, room handle, user handle, wire format) each get
+// their own array, so walking them touches contiguous memory; the cold
+// Session record sits in a separate array beside them.
+//
+// A row belongs to its connection: only that connection's callbacks,
+// serialized on its strand, touch it. WebSocketServer keeps the slot
+// reserved until on_disconnect has returned, so a later connection's
+// insert() into the same slot happens after this one's erase().
+class ConnectionTable {
+    struct Chunk;
+
+public:
+    static constexpr std::size_t kChunkSize = 1024;
+    static constexpr std::size_t kMaxChunks = 1024;
+
+    static_assert(kChunkSize * kMaxChunks >=
+                      SessionTable<int>::kChunkSize * SessionTable<int>::kMaxChunks,
+                  "must cover every slot the server can hand out");
+
+    // Handle to one live row. Cheap to copy; valid until erase(id()).
+    class Row {
+    public:
+        Row() = default;
+
+        explicit operator bool() const noexcept { return chunk_ != nullptr; }
+
+        ClientId id() const noexcept { return chunk_->id[at_]; }
+        std::uint32_t& room() const noexcept { return chunk_->room[at_]; }  // chat::RoomHandle
+        std::uint32_t& user_handle() const noexcept { return chunk_->user_handle[at_]; }
+        protocol::Wire& wire() const noexcept { return chunk_->wire[at_]; }
+        Session& session() const noexcept { return *chunk_->cold[at_]; }
+
+    private:
+        friend class ConnectionTable;
+        Row(Chunk* chunk, std::size_t at) noexcept : chunk_(chunk), at_(at) {}
+
+        Chunk* chunk_ = nullptr;
+        std::size_t at_ = 0;
+    };
+
+    ConnectionTable() = default;
+    ConnectionTable(const ConnectionTable&) = delete;
+    ConnectionTable& operator=(const ConnectionTable&) = delete;
+
+    ~ConnectionTable() {
+        for (auto& c : chunks_) delete c.load(std::memory_order_relaxed);
+    }
+
+    // Claims id's row with zeroed hot fields. Returns an empty Row if the
+    // slot is out of range.
+    Row insert(ClientId id, Session session) {
+        const std::size_t index = slot_of(id);
+        if (index >= kChunkSize * kMaxChunks) return {};
+
+        Chunk* chunk = chunks_[index / kChunkSize].load(std::memory_order_acquire);
+        if (!chunk) chunk = grow(index / kChunkSize);
+
+        const std::size_t at = index % kChunkSize;
+        chunk->id[at] = id;
+        chunk->room[at] = 0;
+        chunk->user_handle[at] = 0;
+        chunk->wire[at] = protocol::Wire::Json;
+        chunk->cold[at].emplace(std::move(session));
+        size_.fetch_add(1, std::memory_order_relaxed);
+        return {chunk, at};
+    }
+
+    // Empty Row if id is not (or no longer) in the table.
+    Row find(ClientId id) const noexcept {
+        const std::size_t index = slot_of(id);
+        if (index >= kChunkSize * kMaxChunks) return {};
+
+        Chunk* chunk = chunks_[index / kChunkSize].load(std::memory_order_acquire);
+        const std::size_t at = index % kChunkSize;
+        if (!chunk || chunk->id[at] != id) return {};
+        return {chunk, at};
+    }
+
+    bool erase(ClientId id) {
+        const Row row = find(id);
+        if (!row) return false;
+        row.chunk_->id[row.at_] = 0;
+        row.chunk_->cold[row.at_].reset();
+        size_.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    std::size_t size() const noexcept { return size_.load(std::memory_order_relaxed); }
+
+private:
+    struct Chunk {
+        // Hot, one array per field. id is 0 for a vacant row.
+        std::array<ClientId, kChunkSize> id{};
+        std::array<std::uint32_t, kChunkSize> room{};
+        std::array<std::uint32_t, kChunkSize> user_handle{};
+        std::array<protocol::Wire, kChunkSize> wire{};
+        // Cold.
+        std::array<std::optional<Session>, kChunkSize> cold;
+    };
+
+    static std::size_t slot_of(ClientId id) noexcept { return static_cast<std::uint32_t>(id); }
+
+    Chunk* grow(std::size_t n) {
+        std::lock_guard<std::mutex> lk(grow_mu_);
+        Chunk* chunk = chunks_[n].load(std::memory_order_relaxed);
+        if (!chunk) {
+            chunk = new Chunk;
+            chunks_[n].store(chunk, std::memory_order_release);
+        }
+        return chunk;
+    }
+
+    std::array<std::atomic<Chunk*>, kMaxChunks> chunks_{};
+    std::mutex grow_mu_;
+    std::atomic<std::size_t> size_{0};
+};
+
+} // namespace simplechat::networking
@@ -0,0 +1,155 @@
+#include "networking/Deflate.h"
+
+#include <boost/beast/zlib/deflate_stream.hpp>
+
+#include <cstdint>
+
+namespace simplechat::networking {
+
+namespace zlib = boost::beast::zlib;
+
+namespace {
+
+std::string_view trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+    return s;
+}
+
+bool iequals(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        const char x = (a[i] >= 'A' && a[i] <= 'Z') ? static_cast<char>(a[i] - 'A' + 'a') : a[i];
+        if (x != b[i]) return false;
+    }
+    return true;
+}
+
+bool window_bits(std::string_view v, int& out) {
+    if (v.empty() || v.size() > 2) return false;
+    int n = 0;
+    for (char c : v) {
+        if (c < '0' || c > '9') return false;
+        n = n * 10 + (c - '0');
+    }
+    if (n < 8 || n > 15) return false;
+    out = n;
+    return true;
+}
+
+// One element: name *( ";" param [ "=" value ] ).
+std::optional<DeflateParams> parse_element(std::string_view element) {
+    auto semi = element.find(';');
+    if (!iequals(trim(element.substr(0, semi)), "permessage-deflate")) return std::nullopt;
+
+    DeflateParams params;
+    unsigned seen = 0;
+    while (semi != std::string_view::npos) {
+        element.remove_prefix(semi + 1);
+        semi = element.find(';');
+        const std::string_view param = element.substr(0, semi);
+
+        const auto eq = param.find('=');
+        const std::string_view key = trim(param.substr(0, eq));
+        const bool has_value = eq != std::string_view::npos;
+        std::string_view value = has_value ? trim(param.substr(eq + 1)) : std::string_view{};
+        if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
+            value = value.substr(1, value.size() - 2);
+        }
+
+        unsigned bit;
+        bool ok;
+        if (iequals(key, "server_no_context_takeover")) {
+            bit = 1;
+            ok = !has_value;
+            params.server_no_context_takeover = true;
+        } else if (iequals(key, "client_no_context_takeover")) {
+            bit = 2;
+            ok = !has_value;
+            params.client_no_context_takeover = true;
+        } else if (iequals(key, "server_max_window_bits")) {
+            bit = 4;
+            ok = window_bits(value, params.server_max_window_bits);
+        } else if (iequals(key, "client_max_window_bits")) {
+            // A client may offer it bare: "I can take any size".
+            bit = 8;
+            ok = !has_value || window_bits(value, params.client_max_window_bits);
+        } else {
+            return std::nullopt;
+        }
+        if (!ok || (seen & bit)) return std::nullopt;
+        seen |= bit;
+    }
+    return params;
+}
+
+} // namespace
+
+std::optional<DeflateParams> parse_deflate_extension(std::string_view header) {
+    while (!header.empty()) {
+        const auto comma = header.find(',');
+        if (auto params = parse_element(header.substr(0, comma))) return params;
+        header = comma == std::string_view::npos ? std::string_view{} : header.substr(comma + 1);
+    }
+    return std::nullopt;
+}
+
+std::string make_frame_header(std::size_t length, bool binary, bool compressed) {
+    std::string h;
+    h.reserve(10);
+
+    // FIN | RSV1 (permessage-deflate) | opcode
+    h.push_back(static_cast<char>(0x80 | (compressed ? 0x40 : 0x00) | (binary ? 0x2 : 0x1)));
+
+    // Server frames are never masked.
+    if (length < 126) {
+        h.push_back(static_cast<char>(length));
+    } else if (length <= 0xFFFF) {
+        h.push_back(static_cast<char>(126));
+        h.push_back(static_cast<char>((length >> 8) & 0xFF));
+        h.push_back(static_cast<char>(length & 0xFF));
+    } else {
+        h.push_back(static_cast<char>(127));
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            h.push_back(static_cast<char>((static_cast<std::uint64_t>(length) >> shift) & 0xFF));
+        }
+    }
+    return h;
+}
+
+std::string make_deflated_frame(std::string_view data, bool binary, const DeflateOptions& opt) {
+    // One compressor per thread; reset() reuses its window when the
+    // parameters do not change.
+    thread_local zlib::deflate_stream ds;
+    ds.reset(opt.level, opt.window_bits, opt.mem_level, zlib::Strategy::normal);
+
+    // Leave room for the frame header in front of the compressed bytes.
+    constexpr std::size_t kMaxHeader = 10;
+    std::string body(kMaxHeader + ds.upper_bound(data.size()) + 16, '\0');
+
+    zlib::z_params zs;
+    zs.next_in = data.data();
+    zs.avail_in = data.size();
+    zs.next_out = &body[kMaxHeader];
+    zs.avail_out = body.size() - kMaxHeader;
+
+    boost::beast::error_code ec;
+    ds.write(zs, zlib::Flush::sync, ec);
+    if (ec) return {};
+
+    std::size_t n = zs.total_out;
+    const auto* out = reinterpret_cast<const unsigned char*>(&body[kMaxHeader]);
+    // RFC 7692 7.2.1: drop the empty stored block a sync flush appends.
+    if (n >= 4 && out[n - 4] == 0x00 && out[n - 3] == 0x00 && out[n - 2] == 0xFF && out[n - 1] == 0xFF) {
+        n -= 4;
+    }
+
+    const std::string header = make_frame_header(n, binary, true);
+    const std::size_t start = kMaxHeader - header.size();
+    body.replace(start, header.size(), header);
+    body.resize(kMaxHeader + n);
+    body.erase(0, start);
+    return body;
+}
+
+} // namespace simplechat::networking
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace simplechat::networking {
+
+// permessage-deflate (RFC 7692) settings for the server role.
+struct DeflateOptions {
+    bool enabled = true;
+    int window_bits = 15;         // server_max_window_bits, 9..15
+    int mem_level = 4;            // 1..9
+    int level = 6;                // 0..9
+    std::size_t min_size = 256;   // smaller messages go out uncompressed
+
+    // Compress each broadcast payload once and send the same frame to every
+    // recipient. Forces server_no_context_takeover so frames are independent.
+    bool shared_frames = true;
+};
+
+// permessage-deflate parameters from a Sec-WebSocket-Extensions header.
+struct DeflateParams {
+    bool server_no_context_takeover = false;
+    bool client_no_context_takeover = false;
+    int server_max_window_bits = 15;
+    int client_max_window_bits = 15;
+};
+
+// Reads the first well-formed permessage-deflate element of a
+// Sec-WebSocket-Extensions value (RFC 7692 section 7). Elements with unknown
+// or repeated parameters, or window bits outside 8..15, are skipped; nullopt
+// if none is left.
+std::optional<DeflateParams> parse_deflate_extension(std::string_view header);
+
+// Encodes a complete, final server-to-client WebSocket frame whose payload is
+// data deflated with a fresh context (RSV1 set, trailing 00 00 ff ff removed).
+// Returns an empty string if compression fails.
+std::string make_deflated_frame(std::string_view data, bool binary, const DeflateOptions& opt);
+
+// Header for an unmasked, final server-to-client frame of the given length.
+std::string make_frame_header(std::size_t length, bool binary, bool compressed);
+
+} // namespace simplechat::networking
@@ -0,0 +1,270 @@
+#include "networking/Handoff.h"
+
+#include "logging/Log.h"
+
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <system_error>
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace simplechat::networking {
+
+namespace asio = boost::asio;
+using local = asio::local::stream_protocol;
+
+namespace {
+
+// Predecessor -> successor: "SCHO", u32 little-endian state length, with the
+// listening fd attached; then the state. Successor -> predecessor: one ack byte.
+constexpr char kMagic[4] = {'S', 'C', 'H', 'O'};
+constexpr std::size_t kHeader = 8;
+constexpr char kAck = 'k';
+
+// A predecessor that takes longer than this to answer is treated as gone.
+constexpr int kTimeoutSeconds = 30;
+
+[[noreturn]] void throw_errno(const std::string& what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+void send_header(int channel, int listen_fd, std::uint32_t state_len) {
+    char header[kHeader];
+    std::memcpy(header, kMagic, 4);
+    for (int i = 0; i < 4; ++i) header[4 + i] = static_cast<char>(state_len >> (8 * i));
+
+    iovec iov{header, kHeader};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    std::memcpy(CMSG_DATA(cmsg), &listen_fd, sizeof(int));
+
+    // The fd rides on the first byte, so a short send is retried without it.
+    ssize_t sent;
+    do sent = ::sendmsg(channel, &msg, MSG_NOSIGNAL);
+    while (sent < 0 && errno == EINTR);
+    if (sent < 0) throw_errno("handoff: send");
+
+    for (std::size_t at = static_cast<std::size_t>(sent); at < kHeader;) {
+        const ssize_t n = ::send(channel, header + at, kHeader - at, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) throw_errno("handoff: send");
+        at += static_cast<std::size_t>(n);
+    }
+}
+
+void read_exact(int channel, char* out, std::size_t len) {
+    while (len > 0) {
+        const ssize_t n = ::read(channel, out, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) throw_errno("handoff: read");
+        if (n == 0) throw std::system_error(ECONNRESET, std::generic_category(), "handoff: predecessor hung up");
+        out += n;
+        len -= static_cast<std::size_t>(n);
+    }
+}
+
+} // namespace
+
+// ---- Predecessor ----
+
+class HandoffServer::Impl : public std::enable_shared_from_this<Impl> {
+public:
+    Impl(asio::io_context& ioc, std::string path) : path_(std::move(path)), acceptor_(ioc) {}
+
+    void start(int listen_fd, Prepare prepare, Done done) {
+        listen_fd_ = listen_fd;
+        prepare_ = std::move(prepare);
+        done_ = std::move(done);
+
+        ::unlink(path_.c_str());
+        const local::endpoint endpoint(path_);
+        acceptor_.open(endpoint.protocol());
+        acceptor_.bind(endpoint);
+        acceptor_.listen(1);
+        do_accept();
+    }
+
+    void stop() {
+        boost::system::error_code ec;
+        acceptor_.close(ec);
+        if (peer_) peer_->close(ec);
+        // Once handed off the path belongs to the successor.
+        if (!handed_off_) ::unlink(path_.c_str());
+    }
+
+private:
+    void do_accept() {
+        acceptor_.async_accept([self = shared_from_this()](boost::system::error_code ec, local::socket socket) {
+            if (ec) {
+                if (ec == asio::error::operation_aborted) return;
+                logging::warn("handoff", "accept: {}", ec);
+                return self->do_accept();
+            }
+            self->hand_over(std::move(socket));
+        });
+    }
+
+    void hand_over(local::socket socket) {
+        logging::info("handoff", "successor connected, handing over");
+        const std::string state = prepare_();
+
+        try {
+            send_header(socket.native_handle(), listen_fd_, static_cast<std::uint32_t>(state.size()));
+            asio::write(socket, asio::buffer(state));
+        } catch (const std::system_error& e) {
+            logging::error("handoff", "{}", e.what());
+            return failed();
+        }
+
+        peer_ = std::make_shared<local::socket>(std::move(socket));
+        asio::async_read(*peer_, asio::buffer(&ack_, 1),
+                         [self = shared_from_this()](boost::system::error_code ec, std::size_t) {
+            self->peer_.reset();
+            if (ec || self->ack_ != kAck) {
+                if (ec == asio::error::operation_aborted) return;
+                logging::warn("handoff", "successor went away before taking over");
+                return self->failed();
+            }
+
+            self->handed_off_ = true;
+            boost::system::error_code ignored;
+            self->acceptor_.close(ignored);
+            self->done_(true);
+        });
+    }
+
+    // Still serving; the next successor can try again.
+    void failed() {
+        done_(false);
+        do_accept();
+    }
+
+    const std::string path_;
+    local::acceptor acceptor_;
+    std::shared_ptr<local::socket> peer_;
+    char ack_ = 0;
+    bool handed_off_ = false;
+
+    int listen_fd_ = -1;
+    Prepare prepare_;
+    Done done_;
+};
+
+HandoffServer::HandoffServer(asio::io_context& ioc, std::string path)
+    : impl_(std::make_shared<Impl>(ioc, std::move(path))) {}
+
+HandoffServer::~HandoffServer() { impl_->stop(); }
+
+void HandoffServer::start(int listen_fd, Prepare prepare, Done done) {
+    impl_->start(listen_fd, std::move(prepare), std::move(done));
+}
+
+void HandoffServer::stop() { impl_->stop(); }
+
+// ---- Successor ----
+
+std::optional<Handoff> Handoff::take_over(const std::string& path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        throw std::system_error(ENAMETOOLONG, std::generic_category(), "handoff: " + path);
+    }
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+    const int channel = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (channel < 0) throw_errno("handoff: socket");
+
+    if (::connect(channel, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) < 0) {
+        const int err = errno;
+        ::close(channel);
+        // No socket file, or a stale one nobody listens on: a cold start.
+        if (err == ENOENT || err == ECONNREFUSED) return std::nullopt;
+        throw std::system_error(err, std::generic_category(), "handoff: connect " + path);
+    }
+
+    // Owns the channel from here, so every throw below closes it.
+    Handoff handoff(channel, -1, {});
+
+    timeval timeout{kTimeoutSeconds, 0};
+    ::setsockopt(channel, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    char header[kHeader];
+    iovec iov{header, kHeader};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t got;
+    do got = ::recvmsg(channel, &msg, MSG_CMSG_CLOEXEC);
+    while (got < 0 && errno == EINTR);
+    if (got < 0) throw_errno("handoff: receive");
+    if (got == 0) throw std::system_error(ECONNRESET, std::generic_category(), "handoff: predecessor hung up");
+
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            std::memcpy(&handoff.listen_fd_, CMSG_DATA(cmsg), sizeof(int));
+        }
+    }
+    read_exact(channel, header + got, kHeader - static_cast<std::size_t>(got));
+
+    if (handoff.listen_fd_ < 0 || std::memcmp(header, kMagic, 4) != 0) {
+        throw std::system_error(EPROTO, std::generic_category(), "handoff: bad handover");
+    }
+
+    std::uint32_t state_len = 0;
+    for (int i = 0; i < 4; ++i) state_len |= std::uint32_t(static_cast<unsigned char>(header[4 + i])) << (8 * i);
+    handoff.state_.resize(state_len);
+    read_exact(channel, handoff.state_.data(), state_len);
+    return handoff;
+}
+
+Handoff::Handoff(Handoff&& other) noexcept
+    : channel_(std::exchange(other.channel_, -1)),
+      listen_fd_(std::exchange(other.listen_fd_, -1)),
+      state_(std::move(other.state_)) {}
+
+Handoff& Handoff::operator=(Handoff&& other) noexcept {
+    std::swap(channel_, other.channel_);
+    std::swap(listen_fd_, other.listen_fd_);
+    std::swap(state_, other.state_);
+    return *this;
+}
+
+Handoff::~Handoff() {
+    if (channel_ >= 0) ::close(channel_);
+    if (listen_fd_ >= 0) ::close(listen_fd_);
+}
+
+void Handoff::complete() {
+    if (channel_ < 0) return;
+    ssize_t n;
+    do n = ::send(channel_, &kAck, 1, MSG_NOSIGNAL);
+    while (n < 0 && errno == EINTR);
+    if (n != 1) logging::warn("handoff", "could not reach the predecessor: {}", std::strerror(errno));
+    ::close(channel_);
+    channel_ = -1;
+}
+
+} // namespace simplechat::networking
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <boost/asio/io_context.hpp>
+
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+
+namespace simplechat::networking {
+
+// Hot restart: an outgoing process hands its client listener to its
+// successor over a Unix socket, so the port never stops accepting.
+//
+//   1. The successor connects to the predecessor's handoff socket.
+//   2. The predecessor releases what the successor must own (log, other
+//      listeners), then sends the listening fd (SCM_RIGHTS) and an opaque
+//      state blob.
+//   3. The successor restores the state, starts accepting on the fd and
+//      calls Handoff::complete().
+//   4. The predecessor stops accepting, drains its clients and exits.
+//
+// Both processes accept on the same socket between 3 and 4, so no
+// connection is refused. Established WebSocket connections are not moved:
+// their framing and compression state lives in the old process, and they
+// reconnect to the new one as they are drained. From step 2 on, what they
+// send could be neither logged nor forwarded, so the server refuses it with
+// an error instead; the state blob carries users' tokens, so reconnecting
+// clients resume as the same users.
+
+// Predecessor side: waits for a successor on path.
+class HandoffServer {
+public:
+    // Builds the state blob; runs on an io thread.
+    using Prepare = std::function<std::string()>;
+    // ok: the successor acknowledged and is accepting. Otherwise it went
+    // away part way and this process is still the one serving.
+    using Done = std::function<void(bool ok)>;
+
+    HandoffServer(boost::asio::io_context& ioc, std::string path);
+    ~HandoffServer();
+
+    HandoffServer(const HandoffServer&) = delete;
+    HandoffServer& operator=(const HandoffServer&) = delete;
+
+    // Replaces any stale socket file at path. Throws std::system_error if
+    // it cannot listen there.
+    void start(int listen_fd, Prepare prepare, Done done);
+    void stop();
+
+private:
+    class Impl;
+    std::shared_ptr<Impl> impl_;
+};
+
+// Successor side: what the predecessor handed over.
+class Handoff {
+public:
+    // Connects to path. nullopt if nothing is listening there (a cold
+    // start); throws std::system_error if a predecessor answered but the
+    // exchange failed.
+    static std::optional<Handoff> take_over(const std::string& path);
+
+    Handoff(Handoff&& other) noexcept;
+    Handoff& operator=(Handoff&& other) noexcept;
+    ~Handoff();
+
+    // The listening socket, for WebSocketServer::Options::listen_fd; the
+    // caller owns it from here on. Closed with the Handoff if never taken.
+    int release_listener() noexcept { return std::exchange(listen_fd_, -1); }
+    const std::string& state() const noexcept { return state_; }
+
+    // Tells the predecessor to stop accepting and drain.
+    void complete();
+
+private:
+    Handoff(int channel, int listen_fd, std::string state) noexcept
+        : channel_(channel), listen_fd_(listen_fd), state_(std::move(state)) {}
+
+    int channel_ = -1;
+    int listen_fd_ = -1;
+    std::string state_;
+};
+
+} // namespace simplechat::networking
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace simplechat::networking {
+
+// What a session does when its outbound queue is full.
+enum class OverflowPolicy : std::uint8_t {
+    DropOldest,  // evict queued frames from the front until the new one fits
+    DropNewest,  // discard the frame being sent
+    Disconnect   // close the slow consumer
+};
+
+// "drop-oldest" | "drop-newest" | "disconnect"; nullopt if unknown.
+inline std::optional<OverflowPolicy> overflow_policy_of(std::string_view name) noexcept {
+    if (name == "drop-oldest") return OverflowPolicy::DropOldest;
+    if (name == "drop-newest") return OverflowPolicy::DropNewest;
+    if (name == "disconnect") return OverflowPolicy::Disconnect;
+    return std::nullopt;
+}
+
+} // namespace simplechat::networking
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "networking/Deflate.h"
+#include "memory/Pool.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace simplechat::networking {
+
+// Immutable outbound message. One instance is shared by every recipient of a
+// broadcast; derived encodings are built lazily, once, on first use.
+class OutboundMessage {
+public:
+    explicit OutboundMessage(std::string data, bool binary = false)
+        : data_(std::move(data)), binary_(binary) {}
+
+    // The buffers go back to the pool for the next frame this thread encodes.
+    ~OutboundMessage() {
+        memory::release_buffer(std::move(data_));
+        memory::release_buffer(std::move(deflated_));
+    }
+
+    OutboundMessage(const OutboundMessage&) = delete;
+    OutboundMessage& operator=(const OutboundMessage&) = delete;
+
+    const std::string& data() const noexcept { return data_; }
+    std::size_t size() const noexcept { return data_.size(); }
+    bool binary() const noexcept { return binary_; }
+
+    // Complete compressed frame for sessions that negotiated permessage-deflate
+    // with compatible parameters. Thread-safe; compresses at most once.
+    // Empty if compression failed (callers fall back to the plain path).
+    const std::string& deflated_frame(const DeflateOptions& opt) const {
+        std::call_once(deflated_once_, [&] { deflated_ = make_deflated_frame(data_, binary_, opt); });
+        return deflated_;
+    }
+
+private:
+    std::string data_;
+    bool binary_;
+
+    mutable std::once_flag deflated_once_;
+    mutable std::string deflated_;
+};
+
+// Immutable, ref-counted outbound frame. One Payload can sit in the write queue
+// of every recipient of a broadcast without copying the bytes.
+using Payload = std::shared_ptr<const OutboundMessage>;
+
+// Object and control block come from the pool in one block.
+inline Payload make_payload(std::string msg, bool binary = false) {
+    return std::allocate_shared<OutboundMessage>(memory::PoolAllocator<OutboundMessage>{},
+                                                 std::move(msg), binary);
+}
+
+} // namespace simplechat::networking
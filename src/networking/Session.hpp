@@ -1,20 +1,23 @@
 #pragma once
-#include <chrono>
-#include <string>
+#include "chat/RateLimit.hpp"
+#include "chat/Ulid.hpp"
+#include "chat/User.h"
 
 namespace simplechat::networking {
 
+// Cold half of a connection's record in ConnectionTable: what is needed to
+// describe the client, not to route its messages. The room handle, user
+// handle and wire format live in the table's hot arrays.
 struct Session {
-    using Clock = std::chrono::steady_clock;
+    chat::Ulid client_id;  // "client-<ulid>" on the wire
+    chat::User user;       // id and name shared with the user's other sessions (chat::UserDirectory)
 
-    std::string client_id;  // "client-<ulid>"
-    std::string user_id;     // "user-<ulid>"
-    std::string room_id;     // "room-<id>"
-
-    Clock::time_point connected_at{};
-    Clock::time_point last_seen{};
-
-    void touch() noexcept { last_seen = Clock::now(); }
+    // Per-connection ingress budget, checked before a frame is parsed.
+    chat::Throttle throttle;
+    // Set while frames are being shed, so the client hears about it once
+    // per episode rather than once per frame.
+    bool client_throttled = false;
+    bool room_throttled = false;
 };
 
-} // namespace simplechat::networking
\ No newline at end of file
+} // namespace simplechat::networking
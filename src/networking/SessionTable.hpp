@@ -0,0 +1,172 @@
+#pragma once
+
+#include "networking/ClientId.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace simplechat::networking {
+
+// Dense table of live sessions addressed by ClientId.
+//
+// A ClientId is (generation << 32) | slot index. Looking one up is an index
+// into a chunk plus a single fetch_add on that slot's state word, so send()
+// and broadcast() are wait-free and never touch a shared lock or cache line.
+// Each slot's state packs:
+//
+//   bits 63..32  generation, bumped when the slot is vacated
+//   bit  31      live
+//   bits 30..0   readers currently inside visit()
+//
+// A visitor increments the reader count and checks generation + live in the
+// same atomic op; erase() bumps the generation, clears live, and waits for the
+// readers already inside to leave before releasing the value. Slot reuse only
+// happens after that, so a stale id can never reach a newer session.
+//
+// insert()/erase() (accept and close paths) take a mutex for the free list.
+template <class T>
+class SessionTable {
+public:
+    static constexpr std::size_t kChunkSize = 4096;
+    static constexpr std::size_t kMaxChunks = 256;  // ~1M concurrent sessions
+
+    SessionTable() = default;
+    SessionTable(const SessionTable&) = delete;
+    SessionTable& operator=(const SessionTable&) = delete;
+
+    ~SessionTable() {
+        for (auto& c : chunks_) delete c.load(std::memory_order_relaxed);
+    }
+
+    // make(id) builds the value for the new id. Returns 0 if the table is full.
+    template <class Make>
+    ClientId insert(Make&& make) {
+        std::lock_guard<std::mutex> lk(mu_);
+
+        std::uint32_t index;
+        if (!free_.empty()) {
+            index = free_.back();
+            free_.pop_back();
+        } else {
+            if (next_index_ == kChunkSize * kMaxChunks) return 0;
+            index = next_index_++;
+            auto& chunk = chunks_[index / kChunkSize];
+            if (!chunk.load(std::memory_order_relaxed)) {
+                chunk.store(new Chunk, std::memory_order_release);
+            }
+        }
+
+        Slot& slot = slot_at(index);
+        const std::uint64_t state = slot.state.load(std::memory_order_relaxed);
+        const ClientId id = (state & kGenMask) | index;
+
+        slot.value = make(id);
+        // Publish: visitors that see live also see the value.
+        slot.state.fetch_add(kLive, std::memory_order_release);
+        ++size_;
+        return id;
+    }
+
+    // Runs fn(T&) if id is live. Wait-free.
+    template <class Fn>
+    bool visit(ClientId id, Fn&& fn) {
+        Slot* slot = find_slot(id);
+        if (!slot) return false;
+
+        const std::uint64_t state = slot->state.fetch_add(1, std::memory_order_acquire);
+        const bool hit = (state & kLive) && (state & kGenMask) == (id & kGenMask);
+        if (hit) fn(*slot->value);
+        slot->state.fetch_sub(1, std::memory_order_release);
+        return hit;
+    }
+
+    // Vacates id; false if it was already gone. Must not be called from
+    // inside visit() on the same id.
+    bool erase(ClientId id) {
+        Slot* slot = find_slot(id);
+        if (!slot) return false;
+
+        std::uint64_t state = slot->state.load(std::memory_order_relaxed);
+        do {
+            if (!(state & kLive) || (state & kGenMask) != (id & kGenMask)) return false;
+        } while (!slot->state.compare_exchange_weak(
+            state, state + kGenOne - kLive, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+        // Readers that got in before the flip hold the value briefly.
+        while (slot->state.load(std::memory_order_acquire) & kReaderMask) std::this_thread::yield();
+        std::shared_ptr<T> value = std::move(slot->value);
+
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            free_.push_back(static_cast<std::uint32_t>(id & kIndexMask));
+            --size_;
+        }
+        return true;
+    }
+
+    // Snapshot of every live value; used for shutdown, not on hot paths.
+    std::vector<std::shared_ptr<T>> snapshot() {
+        std::uint32_t used;
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            used = next_index_;
+        }
+
+        std::vector<std::shared_ptr<T>> out;
+        for (std::uint32_t i = 0; i < used; ++i) {
+            Slot& slot = slot_at(i);
+            const std::uint64_t state = slot.state.load(std::memory_order_relaxed);
+            visit((state & kGenMask) | i, [&](T&) { out.push_back(slot.value); });
+        }
+        return out;
+    }
+
+    std::size_t size() const {
+        std::lock_guard<std::mutex> lk(mu_);
+        return size_;
+    }
+
+private:
+    static constexpr std::uint64_t kReaderMask = (std::uint64_t(1) << 31) - 1;
+    static constexpr std::uint64_t kLive       = std::uint64_t(1) << 31;
+    static constexpr std::uint64_t kGenOne     = std::uint64_t(1) << 32;
+    static constexpr std::uint64_t kGenMask    = ~(kGenOne - 1);
+    static constexpr std::uint64_t kIndexMask  = kGenOne - 1;
+
+    struct alignas(64) Slot {
+        // Generation starts at 1 so no id is ever 0.
+        std::atomic<std::uint64_t> state{kGenOne};
+        std::shared_ptr<T> value;
+    };
+
+    struct Chunk {
+        std::array<Slot, kChunkSize> slots;
+    };
+
+    Slot& slot_at(std::uint32_t index) {
+        return chunks_[index / kChunkSize].load(std::memory_order_acquire)->slots[index % kChunkSize];
+    }
+
+    Slot* find_slot(ClientId id) {
+        const std::uint64_t index = id & kIndexMask;
+        if (index >= kChunkSize * kMaxChunks) return nullptr;
+        Chunk* chunk = chunks_[index / kChunkSize].load(std::memory_order_acquire);
+        return chunk ? &chunk->slots[index % kChunkSize] : nullptr;
+    }
+
+    std::array<std::atomic<Chunk*>, kMaxChunks> chunks_{};
+
+    mutable std::mutex mu_;
+    std::vector<std::uint32_t> free_;
+    std::uint32_t next_index_ = 0;
+    std::size_t size_ = 0;
+};
+
+} // namespace simplechat::networking
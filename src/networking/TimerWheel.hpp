@@ -0,0 +1,95 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace simplechat::networking {
+
+// Hierarchical timer wheel over integer ticks (the Varghese/Lauck scheme the
+// Linux kernel used for years).
+//
+// Level 0 has one slot per tick for the next 256 ticks; each level above has
+// 256 slots, each 256x wider than the one below. schedule() is O(1). When
+// level 0 wraps, the current slot of level 1 is redistributed downwards
+// (and level 2's when level 1 wraps, ...), so each entry moves at most once
+// per level and advance() costs O(expired + cascaded), never O(all entries).
+//
+// Entries can't be cancelled: callers hold values that can be checked for
+// staleness when they fire (a ClientId whose generation has moved on) and
+// simply drop them. Not thread-safe.
+template <class T>
+class TimerWheel {
+public:
+    static constexpr unsigned kLevels = 4;
+    static constexpr unsigned kSlotBits = 8;
+    static constexpr std::size_t kSlots = std::size_t(1) << kSlotBits;
+    static constexpr std::uint64_t kMaxDelay = (std::uint64_t(1) << (kSlotBits * kLevels)) - 1;
+
+    std::uint64_t now() const noexcept { return now_; }
+    std::size_t size() const noexcept { return size_; }
+
+    // Fires value at the first advance() that reaches deadline (at least the
+    // next tick; deadlines beyond kMaxDelay are clamped).
+    void schedule(std::uint64_t deadline, T value) {
+        if (deadline <= now_) deadline = now_ + 1;
+        if (deadline - now_ > kMaxDelay) deadline = now_ + kMaxDelay;
+        place({deadline, std::move(value)});
+        ++size_;
+    }
+
+    // Moves time forward to tick `to`, calling fire(T&&) for every entry due.
+    // fire may schedule() new entries.
+    template <class Fire>
+    void advance(std::uint64_t to, Fire&& fire) {
+        while (now_ < to) {
+            ++now_;
+            cascade(1);
+
+            auto due = std::move(levels_[0][now_ & kMask]);
+            levels_[0][now_ & kMask].clear();
+            size_ -= due.size();
+            for (auto& e : due) fire(std::move(e.value));
+        }
+    }
+
+private:
+    static constexpr std::uint64_t kMask = kSlots - 1;
+
+    struct Entry {
+        std::uint64_t deadline;
+        T value;
+    };
+
+    using Slot = std::vector<Entry>;
+
+    static std::size_t index(std::uint64_t tick, unsigned level) noexcept {
+        return static_cast<std::size_t>((tick >> (kSlotBits * level)) & kMask);
+    }
+
+    void place(Entry e) {
+        const std::uint64_t delay = e.deadline - now_;
+        unsigned level = 0;
+        while (level + 1 < kLevels && delay >= (std::uint64_t(1) << (kSlotBits * (level + 1)))) ++level;
+        levels_[level][index(e.deadline, level)].push_back(std::move(e));
+    }
+
+    // Entering a new span of `level`: move its current slot down. Recurses
+    // upward only when this level wrapped too.
+    void cascade(unsigned level) {
+        if (level >= kLevels || index(now_, level - 1) != 0) return;
+        cascade(level + 1);
+
+        auto moved = std::move(levels_[level][index(now_, level)]);
+        levels_[level][index(now_, level)].clear();
+        for (auto& e : moved) place(std::move(e));
+    }
+
+    std::array<std::array<Slot, kSlots>, kLevels> levels_{};
+    std::uint64_t now_ = 0;
+    std::size_t size_ = 0;
+};
+
+} // namespace simplechat::networking
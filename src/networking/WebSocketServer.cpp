@@ -1,53 +1,173 @@
 #include "WebSocketServer.h"
+#include "CoalescingStream.hpp"
+#include "SessionTable.hpp"
+#include "TimerWheel.hpp"
+#include "logging/Log.h"
+#include "memory/Pool.h"
 
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/asio/strand.hpp>
 #include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
 #include <boost/beast/websocket.hpp>
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <deque>
-#include <iostream>
+#include <functional>
 #include <memory>
 #include <mutex>
-#include <unordered_map>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 namespace simplechat::networking {
 
 namespace beast = boost::beast;
+namespace http = beast::http;
 namespace websocket = beast::websocket;
 namespace asio = boost::asio;
 using tcp = asio::ip::tcp;
 
+using Clock = std::chrono::steady_clock;
+
+// Use the io_context executor type for compatibility with older Boost.Asio.
+using Strand = asio::strand<asio::io_context::executor_type>;
+
+// Typed on the strand rather than beast::tcp_stream's any_io_executor: the
+// type-erased executor heap-allocates a copy of the strand every time it is
+// copied, which Beast and Asio do several times per read and write.
+using SocketStream = beast::basic_stream<tcp, Strand>;
+using StrandSocket = SocketStream::socket_type;
+
+static double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Handles into the registry; every update is a per-thread relaxed add.
+struct ServerMetrics {
+    explicit ServerMetrics(metrics::Registry& r)
+        : accepted(r.counter("simplechat_ws_connections_accepted_total", "WebSocket handshakes completed")),
+          handshake_failures(r.counter("simplechat_ws_handshake_failures_total", "Connections that failed before the WebSocket handshake completed")),
+          closed(r.counter("simplechat_ws_connections_closed_total", "WebSocket connections closed")),
+          open(r.gauge("simplechat_ws_connections_open", "WebSocket connections currently open")),
+          frames_in(r.counter("simplechat_ws_frames_in_total", "Messages received from clients")),
+          bytes_in(r.counter("simplechat_ws_bytes_in_total", "Message payload bytes received from clients")),
+          frames_out(r.counter("simplechat_ws_frames_out_total", "Messages written to clients")),
+          bytes_out(r.counter("simplechat_ws_bytes_out_total", "Message payload bytes written to clients")),
+          dropped_frames(r.counter("simplechat_ws_dropped_frames_total", "Outbound messages dropped by the overflow policy")),
+          dropped_bytes(r.counter("simplechat_ws_dropped_bytes_total", "Outbound bytes dropped by the overflow policy")),
+          evicted(r.counter("simplechat_ws_evicted_sessions_total", "Sessions closed by the Disconnect overflow policy")),
+          idle_closed(r.counter("simplechat_ws_idle_closed_total", "Sessions closed after idle_timeout without traffic")),
+          pings(r.counter("simplechat_ws_pings_sent_total", "Keep-alive pings sent to quiet sessions")),
+          queue_depth(r.histogram("simplechat_ws_queue_depth", "Session outbound queue length seen by each enqueued message", metrics::size_buckets())),
+          write_seconds(r.histogram("simplechat_ws_write_seconds", "Time from enqueue until the message was written", metrics::latency_buckets())),
+          fanout(r.histogram("simplechat_broadcast_fanout", "Recipients per broadcast call", metrics::size_buckets())),
+          broadcast_seconds(r.histogram("simplechat_broadcast_seconds", "Time spent fanning out one broadcast call", metrics::latency_buckets())) {}
+
+    metrics::Counter& accepted;
+    metrics::Counter& handshake_failures;
+    metrics::Counter& closed;
+    metrics::Gauge& open;
+    metrics::Counter& frames_in;
+    metrics::Counter& bytes_in;
+    metrics::Counter& frames_out;
+    metrics::Counter& bytes_out;
+    metrics::Counter& dropped_frames;
+    metrics::Counter& dropped_bytes;
+    metrics::Counter& evicted;
+    metrics::Counter& idle_closed;
+    metrics::Counter& pings;
+    metrics::Histogram& queue_depth;
+    metrics::Histogram& write_seconds;
+    metrics::Histogram& fanout;
+    metrics::Histogram& broadcast_seconds;
+};
+
 class WebSocketServer::Impl {
 public:
-    Impl(asio::io_context& ioc, unsigned short port)
+    Impl(asio::io_context& ioc, unsigned short port, Options options)
         : ioc_(ioc),
-          acceptor_(ioc, tcp::endpoint(tcp::v4(), port)) {}
-
-    void start() { do_accept(); }
+          acceptor_(make_acceptor(ioc, port, options.listen_fd)),
+          options_(options),
+          own_registry_(options.metrics ? nullptr : std::make_unique<metrics::Registry>()),
+          metrics_(options.metrics ? *options.metrics : *own_registry_),
+          reaper_strand_(asio::make_strand(ioc)),
+          reaper_timer_(reaper_strand_),
+          epoch_(Clock::now()),
+          ping_ticks_(to_ticks(options.ping_interval)),
+          idle_ticks_(to_ticks(options.idle_timeout)),
+          drain_timer_(reaper_strand_) {}
+
+    void start() {
+        do_accept();
+        if (reaping()) asio::post(reaper_strand_, [this] { reaper_tick(); });
+    }
 
     void stop() {
         beast::error_code ec;
         acceptor_.close(ec);
+        asio::post(reaper_strand_, [this] {
+            reaper_timer_.cancel();
+            drain_timer_.cancel();
+        });
 
         // Close all sessions
-        std::lock_guard<std::mutex> lk(mu_);
-        for (auto& [id, s] : sessions_) {
+        for (auto& s : sessions_.snapshot()) {
+            sessions_.erase(s->id());
             s->close();
         }
-        sessions_.clear();
     }
 
-    void send(ClientId client, const std::string& msg) {
-        std::shared_ptr<class Session> s;
-        {
-            std::lock_guard<std::mutex> lk(mu_);
-            auto it = sessions_.find(client);
-            if (it == sessions_.end()) return;
-            s = it->second;
+    void drain(std::chrono::milliseconds period, std::function<void()> done) {
+        beast::error_code ec;
+        acceptor_.close(ec);
+
+        asio::post(reaper_strand_, [this, period, done = std::move(done)]() mutable {
+            draining_ = sessions_.snapshot();
+            const auto ticks = std::max<std::size_t>(1, static_cast<std::size_t>(period / kDrainTick));
+            drain_slice_ = (draining_.size() + ticks - 1) / ticks;
+            on_drained_ = std::move(done);
+            drain_tick();
+        });
+    }
+
+    int listener() { return acceptor_.native_handle(); }
+
+    // Lookups below are wait-free (see SessionTable); Session::send only
+    // posts to the session's strand.
+    void send(ClientId client, Payload msg) {
+        sessions_.visit(client, [&](Session& s) { s.send(std::move(msg)); });
+    }
+
+    void send(ClientId client, std::vector<Payload> msgs) {
+        sessions_.visit(client, [&](Session& s) { s.send(std::move(msgs)); });
+    }
+
+    void broadcast(const std::vector<ClientId>& clients, const Payload& msg) {
+        const auto started = Clock::now();
+        for (ClientId client : clients) {
+            sessions_.visit(client, [&](Session& s) { s.send(msg); });
         }
-        s->send(msg);
+        metrics_.fanout.observe(static_cast<double>(clients.size()));
+        metrics_.broadcast_seconds.observe(seconds_since(started));
+    }
+
+    std::string subprotocol(ClientId client) {
+        std::string out;
+        sessions_.visit(client, [&](Session& s) { out = s.subprotocol(); });
+        return out;
+    }
+
+    Stats stats() const {
+        Stats s;
+        s.dropped_frames = metrics_.dropped_frames.value();
+        s.dropped_bytes = metrics_.dropped_bytes.value();
+        s.evicted_sessions = metrics_.evicted.value();
+        s.idle_closed_sessions = metrics_.idle_closed.value();
+        return s;
     }
 
     void set_on_connect(OnConnect cb) { on_connect_ = std::move(cb); }
@@ -57,49 +177,232 @@ public:
 private:
     class Session : public std::enable_shared_from_this<Session> {
     public:
-        Session(Impl& server, tcp::socket socket, ClientId id)
+        Session(Impl& server, StrandSocket socket, Strand strand, ClientId id)
             : server_(server),
               id_(id),
               ws_(std::move(socket)),
-              strand_(asio::make_strand(server_.ioc_)) {}
+              strand_(std::move(strand)) {}
 
         ClientId id() const { return id_; }
 
-        void start() {
-            // For minimal setup: accept immediately.
-            ws_.set_option(websocket::stream_base::timeout::suggested(beast::role_type::server));
+        // Reaper tick of the last inbound frame; read from the reaper strand.
+        std::uint64_t last_active() const noexcept {
+            return last_active_.load(std::memory_order_relaxed);
+        }
 
-            ws_.async_accept(
+        // Fixed once the handshake completes.
+        const std::string& subprotocol() const { return subprotocol_; }
+
+        void start() {
+            ws_.next_layer().keep_alive(shared_from_this());
+            ws_.next_layer().high_water_mark(server_.options_.write_high_water);
+
+            // Read the upgrade request ourselves so we know which extensions
+            // the client offered before the handshake completes.
+            beast::get_lowest_layer(ws_).expires_after(std::chrono::seconds(30));
+            http::async_read(
+                ws_.next_layer(), buffer_, upgrade_,
                 asio::bind_executor(
                     strand_,
-                    [self = shared_from_this()](beast::error_code ec) {
-                        if (ec) return self->fail("accept", ec);
-
-                        if (self->server_.on_connect_) self->server_.on_connect_(self->id_);
-                        self->do_read();
+                    [self = shared_from_this()](beast::error_code ec, std::size_t) {
+                        if (ec) return self->abort("handshake", ec);
+                        self->do_accept();
                     }));
         }
 
-        void send(const std::string& msg) {
+        // One post per message (per recipient, for a broadcast): the
+        // operation comes from the pool, not the heap.
+        void send(Payload msg) {
+            asio::post(
+                strand_,
+                memory::pooled([self = shared_from_this(), msg = std::move(msg)]() mutable {
+                    const bool writing = !self->write_queue_.empty();
+                    self->enqueue(std::move(msg));
+                    if (!writing && !self->write_queue_.empty()) self->do_write();
+                }));
+        }
+
+        void send(std::vector<Payload> msgs) {
             asio::post(
                 strand_,
-                [self = shared_from_this(), msg] {
-                    bool writing = !self->write_queue_.empty();
-                    self->write_queue_.push_back(msg);
-                    if (!writing) self->do_write();
+                memory::pooled([self = shared_from_this(), msgs = std::move(msgs)]() mutable {
+                    const bool writing = !self->write_queue_.empty();
+                    for (auto& msg : msgs) self->enqueue(std::move(msg));
+                    if (!writing && !self->write_queue_.empty()) self->do_write();
+                }));
+        }
+
+        // Keep-alive for a quiet client; its pong counts as activity.
+        void ping() {
+            asio::post(
+                strand_,
+                [self = shared_from_this()] {
+                    if (self->closed_ || self->evicted_ || self->pinging_) return;
+                    self->pinging_ = true;
+                    self->server_.metrics_.pings.inc();
+                    self->ws_.async_ping(
+                        {}, asio::bind_executor(self->strand_, [self](beast::error_code) {
+                            self->pinging_ = false;
+                        }));
                 });
         }
 
-        void close() {
+        // Idle past the timeout. Hard close, as for eviction: a half-open peer
+        // would never answer a close frame.
+        void expire() {
             asio::post(
                 strand_,
                 [self = shared_from_this()] {
-                    beast::error_code ec;
-                    self->ws_.close(websocket::close_code::normal, ec);
+                    if (self->closed_ || self->evicted_) return;
+                    self->evicted_ = true;
+                    self->server_.metrics_.idle_closed.inc();
+                    self->ws_.next_layer().next_layer().close();
+                });
+        }
+
+        void close(websocket::close_code code = websocket::close_code::normal) {
+            asio::post(
+                strand_,
+                [self = shared_from_this(), code] {
+                    self->closing_ = true;
+                    self->ws_.async_close(
+                        code,
+                        asio::bind_executor(self->strand_, [self](beast::error_code) {}));
                 });
         }
 
     private:
+        void do_accept() {
+            // The websocket stream has its own timeouts from here on.
+            beast::get_lowest_layer(ws_).expires_never();
+            auto timeouts = websocket::stream_base::timeout::suggested(beast::role_type::server);
+            if (server_.reaping()) {
+                // The server's timer wheel replaces Beast's per-stream idle timer.
+                timeouts.idle_timeout = websocket::stream_base::none();
+                timeouts.keep_alive_pings = false;
+                ws_.control_callback([this](websocket::frame_type, beast::string_view) { touch(); });
+            }
+            ws_.set_option(timeouts);
+            configure_deflate();
+            select_subprotocol();
+
+            // Runs once the response is built, deflate answer included.
+            ws_.set_option(websocket::stream_base::decorator(
+                [this](websocket::response_type& res) {
+                    if (!subprotocol_.empty()) res.set(http::field::sec_websocket_protocol, subprotocol_);
+                    const auto extensions = res[http::field::sec_websocket_extensions];
+                    on_deflate_response({extensions.data(), extensions.size()});
+                }));
+
+            ws_.async_accept(
+                upgrade_,
+                asio::bind_executor(
+                    strand_,
+                    [self = shared_from_this()](beast::error_code ec) {
+                        if (ec) return self->abort("accept", ec);
+                        self->upgrade_ = {};
+                        self->server_.metrics_.accepted.inc();
+                        self->server_.metrics_.open.add(1);
+                        self->touch();
+                        self->server_.watch(self->id_);
+
+                        if (self->server_.on_connect_) self->server_.on_connect_(self->id_);
+                        self->do_read();
+                    }));
+        }
+
+        void configure_deflate() {
+            const auto& opt = server_.options_.deflate;
+            if (!opt.enabled) return;
+
+            websocket::permessage_deflate pmd;
+            pmd.server_enable = true;
+            pmd.server_max_window_bits = opt.window_bits;
+            pmd.memLevel = opt.mem_level;
+            pmd.compLevel = opt.level;
+            pmd.server_no_context_takeover = opt.shared_frames;
+            ws_.set_option(pmd);
+        }
+
+        // Called from the handshake decorator, after Beast has negotiated and
+        // written its answer to the client's offer.
+        void on_deflate_response(std::string_view extensions) {
+            const auto& opt = server_.options_.deflate;
+            const auto params = parse_deflate_extension(extensions);
+
+            deflate_ = params.has_value();
+            // Shared frames are built with a fresh context and opt.window_bits;
+            // a client that limited the server window cannot decode them.
+            shared_deflate_ = deflate_ && opt.shared_frames && params->server_no_context_takeover &&
+                              params->server_max_window_bits >= opt.window_bits;
+        }
+
+        void select_subprotocol() {
+            const auto& supported = server_.options_.subprotocols;
+            if (supported.empty()) return;
+
+            // Offered as a comma-separated list, client preference first.
+            const auto header = upgrade_[http::field::sec_websocket_protocol];
+            std::string_view offered(header.data(), header.size());
+            while (!offered.empty() && subprotocol_.empty()) {
+                const auto comma = offered.find(',');
+                std::string_view token = offered.substr(0, comma);
+                offered = comma == std::string_view::npos ? std::string_view{} : offered.substr(comma + 1);
+
+                while (!token.empty() && (token.front() == ' ' || token.front() == '\t')) token.remove_prefix(1);
+                while (!token.empty() && (token.back() == ' ' || token.back() == '\t')) token.remove_suffix(1);
+
+                for (const auto& p : supported) {
+                    if (p == token) { subprotocol_ = p; break; }
+                }
+            }
+        }
+
+        void enqueue(Payload msg) {
+            if (!admit(msg->size())) return;
+            server_.metrics_.queue_depth.observe(static_cast<double>(write_queue_.size()));
+            queued_bytes_ += msg->size();
+            write_queue_.push_back({std::move(msg), Clock::now()});
+        }
+
+        // Applies the overflow policy; returns false if the new frame must be dropped.
+        bool admit(std::size_t bytes) {
+            const auto& opt = server_.options_;
+            auto fits = [&] {
+                return write_queue_.size() < opt.max_queue_messages &&
+                       queued_bytes_ + bytes <= opt.max_queue_bytes;
+            };
+            if (evicted_) return false;
+            if (fits()) return true;
+
+            switch (opt.overflow) {
+                case OverflowPolicy::DropNewest:
+                    server_.count_drop(bytes);
+                    return false;
+
+                case OverflowPolicy::DropOldest:
+                    // front() is owned by the write in progress; evict behind it.
+                    while (write_queue_.size() > 1 && !fits()) {
+                        auto victim = write_queue_.begin() + 1;
+                        queued_bytes_ -= victim->msg->size();
+                        server_.count_drop(victim->msg->size());
+                        write_queue_.erase(victim);
+                    }
+                    if (fits()) return true;
+                    server_.count_drop(bytes);
+                    return false;
+
+                case OverflowPolicy::Disconnect:
+                    evicted_ = true;
+                    server_.metrics_.evicted.inc();
+                    server_.count_drop(bytes);
+                    // Hard close: a close frame would only queue behind the backlog.
+                    ws_.next_layer().next_layer().close();
+                    return false;
+            }
+            return false;
+        }
+
         void do_read() {
             ws_.async_read(
                 buffer_,
@@ -107,73 +410,155 @@ private:
                     strand_,
                     [self = shared_from_this()](beast::error_code ec, std::size_t) {
                         if (ec) return self->on_close_or_fail(ec);
+                        self->touch();
 
-                        std::string msg = beast::buffers_to_string(self->buffer_.data());
-                        self->buffer_.consume(self->buffer_.size());
+                        // flat_buffer is contiguous: hand out a view, no copy.
+                        const auto data = self->buffer_.cdata();
+                        std::string_view msg(static_cast<const char*>(data.data()), data.size());
+                        self->server_.metrics_.frames_in.inc();
+                        self->server_.metrics_.bytes_in.inc(msg.size());
 
                         if (self->server_.on_message_) self->server_.on_message_(self->id_, msg);
+                        self->buffer_.consume(self->buffer_.size());
 
                         self->do_read();
                     }));
         }
 
         void do_write() {
-            ws_.text(true);
-            ws_.async_write(
-                asio::buffer(write_queue_.front()),
-                asio::bind_executor(
-                    strand_,
-                    [self = shared_from_this()](beast::error_code ec, std::size_t) {
-                        if (ec) return self->on_close_or_fail(ec);
+            const auto& msg = *write_queue_.front().msg;
+            const auto& deflate = server_.options_.deflate;
+            const bool compress = deflate_ && msg.size() >= deflate.min_size;
 
-                        self->write_queue_.pop_front();
-                        if (!self->write_queue_.empty()) self->do_write();
-                    }));
+            auto on_write = asio::bind_executor(
+                strand_,
+                [self = shared_from_this()](beast::error_code ec, std::size_t) {
+                    if (ec) return self->on_close_or_fail(ec);
+
+                    const auto& done = self->write_queue_.front();
+                    auto& m = self->server_.metrics_;
+                    m.frames_out.inc();
+                    m.bytes_out.inc(done.msg->size());
+                    m.write_seconds.observe(seconds_since(done.queued_at));
+
+                    self->queued_bytes_ -= done.msg->size();
+                    self->write_queue_.pop_front();
+                    if (!self->write_queue_.empty()) self->do_write();
+                });
+
+            // Pre-built frames bypass Beast and go straight to the coalescing
+            // layer, which sends the payload in place and holds it until it
+            // is on the socket. Beast is idle between our writes, so only its
+            // control frames can interleave, which the protocol allows.
+            const Payload& payload = write_queue_.front().msg;
+            if (ws_.is_open()) {
+                if (compress && shared_deflate_) {
+                    // Compressed once and shared with every other recipient.
+                    const std::string& frame = msg.deflated_frame(deflate);
+                    if (!frame.empty()) {
+                        return ws_.next_layer().async_write_frame(
+                            {}, asio::buffer(frame), payload, std::move(on_write));
+                    }
+                }
+                if (!compress) {
+                    // Uncompressed (RSV1 clear): no deflate negotiated, or a
+                    // message below the threshold not worth the overhead.
+                    const std::string header = make_frame_header(msg.size(), msg.binary(), false);
+                    return ws_.next_layer().async_write_frame(
+                        asio::buffer(header), asio::buffer(msg.data()), payload, std::move(on_write));
+                }
+            }
+
+            ws_.binary(msg.binary());
+            ws_.async_write(asio::buffer(msg.data()), std::move(on_write));
         }
 
         void on_close_or_fail(beast::error_code ec) {
+            // Both the read and the write path land here; report once.
+            if (closed_) return;
+            closed_ = true;
+
             // WebSocket close is common; treat it as disconnect.
-            if (ec == websocket::error::closed) {
-                server_.remove_session(id_);
-                if (server_.on_disconnect_) server_.on_disconnect_(id_);
-                return;
-            }
-            fail("io", ec);
-            server_.remove_session(id_);
+            // Our own close aborts the pending read; that is not a failure.
+            if (ec != websocket::error::closed && !evicted_ && !closing_) fail("io", ec);
+
+            server_.metrics_.closed.inc();
+            server_.metrics_.open.add(-1);
+            // The slot stays reserved until the application has let go of
+            // the id, so state it keys by slot cannot meet the next occupant.
             if (server_.on_disconnect_) server_.on_disconnect_(id_);
+            server_.remove_session(id_);
+        }
+
+        // Handshake failed: on_connect never ran, so just drop the session.
+        void abort(const char* what, beast::error_code ec) {
+            fail(what, ec);
+            server_.metrics_.handshake_failures.inc();
+            server_.remove_session(id_);
+        }
+
+        void touch() noexcept {
+            last_active_.store(server_.now_tick_.load(std::memory_order_relaxed),
+                               std::memory_order_relaxed);
         }
 
         void fail(const char* what, beast::error_code ec) {
-            std::cerr << "[Session " << id_ << "] " << what << ": " << ec.message() << "\n";
+            // Mostly peers going away; rate limiting keeps a mass disconnect to a few lines.
+            logging::info("ws", "session {} {}: {}", id_, what, ec);
         }
 
         Impl& server_;
         ClientId id_;
 
-        websocket::stream<beast::tcp_stream> ws_;
-        // Use the io_context executor type for compatibility with older Boost.Asio.
-        asio::strand<asio::io_context::executor_type> strand_;
+        websocket::stream<CoalescingStream<SocketStream>> ws_;
+        Strand strand_;
 
         beast::flat_buffer buffer_;
-        std::deque<std::string> write_queue_;
+        http::request<http::string_body> upgrade_;
+        std::string subprotocol_;
+        bool deflate_ = false;         // permessage-deflate negotiated
+        bool shared_deflate_ = false;  // ...and compatible with shared frames
+
+        struct Queued {
+            Payload msg;
+            Clock::time_point queued_at;
+        };
+
+        // Deque blocks are pooled, so a queue that fills and drains
+        // repeatedly stops touching the heap.
+        std::deque<Queued, memory::PoolAllocator<Queued>> write_queue_;
+        std::size_t queued_bytes_ = 0;
+        bool evicted_ = false;  // closed by the server (overflow or idle)
+        bool closing_ = false;  // close() sent the close frame
+        bool closed_ = false;
+        bool pinging_ = false;
+        std::atomic<std::uint64_t> last_active_{0};
     };
 
     void do_accept() {
+        // The socket is bound to the session's strand so Beast's internal
+        // timers and our handlers never run concurrently when ioc has
+        // several threads.
+        auto strand = asio::make_strand(ioc_);
         acceptor_.async_accept(
-            [this](beast::error_code ec, tcp::socket socket) {
+            strand,
+            [this, strand](beast::error_code ec, StrandSocket socket) {
                 if (ec) {
                     // If acceptor closed during shutdown, ignore.
                     if (ec == asio::error::operation_aborted) return;
-                    std::cerr << "[accept] " << ec.message() << "\n";
+                    logging::warn("ws", "accept: {}", ec);
                     return do_accept();
                 }
 
-                auto id = next_client_id_++;
-                auto session = std::make_shared<Session>(*this, std::move(socket), id);
-
-                {
-                    std::lock_guard<std::mutex> lk(mu_);
-                    sessions_[id] = session;
+                std::shared_ptr<Session> session;
+                const ClientId id = sessions_.insert([&](ClientId assigned) {
+                    session = std::allocate_shared<Session>(memory::PoolAllocator<Session>{}, *this,
+                                                            std::move(socket), strand, assigned);
+                    return session;
+                });
+                if (id == 0) {
+                    logging::warn("ws", "accept: session table full");
+                    return do_accept();
                 }
 
                 session->start();
@@ -181,19 +566,113 @@ private:
             });
     }
 
-    void remove_session(ClientId id) {
-        std::lock_guard<std::mutex> lk(mu_);
-        sessions_.erase(id);
+    void remove_session(ClientId id) { sessions_.erase(id); }
+
+    // ---- Idle reaping ----
+    //
+    // Every live session has one entry in idle_wheel_, due when it could next
+    // need a ping or a close. Activity only stores the current tick into the
+    // session; when the entry fires the reaper looks at that and either acts
+    // or re-files the entry at the new deadline. A tick therefore costs
+    // O(entries due), and a busy session costs one re-file per ping_interval.
+    // Entries for closed sessions fail the SessionTable lookup and vanish.
+
+    static constexpr std::chrono::milliseconds kReaperTick{250};
+
+    static std::uint64_t to_ticks(std::chrono::milliseconds d) {
+        return static_cast<std::uint64_t>((d + kReaperTick - std::chrono::milliseconds(1)) / kReaperTick);
+    }
+
+    bool reaping() const noexcept { return idle_ticks_ > 0; }
+
+    void watch(ClientId id) {
+        if (!reaping()) return;
+        asio::post(reaper_strand_, [this, id] {
+            idle_wheel_.schedule(now_tick_.load(std::memory_order_relaxed) + next_check(0), id);
+        });
+    }
+
+    // Ticks from the last activity until the reaper should look again.
+    std::uint64_t next_check(std::uint64_t idle) const noexcept {
+        return ping_ticks_ > idle && ping_ticks_ < idle_ticks_ ? ping_ticks_ : idle_ticks_;
+    }
+
+    void reaper_tick() {
+        const auto elapsed = Clock::now() - epoch_;
+        const std::uint64_t now = static_cast<std::uint64_t>(elapsed / kReaperTick);
+        now_tick_.store(now, std::memory_order_relaxed);
+
+        idle_wheel_.advance(now, [&](ClientId id) {
+            sessions_.visit(id, [&](Session& s) {
+                const std::uint64_t last = s.last_active();
+                const std::uint64_t idle = now > last ? now - last : 0;
+                if (idle >= idle_ticks_) return s.expire();
+                if (idle >= ping_ticks_) s.ping();
+                idle_wheel_.schedule(last + next_check(idle), id);
+            });
+        });
+
+        reaper_timer_.expires_at(epoch_ + (now + 1) * kReaperTick);
+        reaper_timer_.async_wait([this](beast::error_code ec) {
+            if (!ec) reaper_tick();
+        });
+    }
+
+    // ---- Draining (hot restart) ----
+
+    static constexpr std::chrono::milliseconds kDrainTick{100};
+
+    void drain_tick() {
+        const std::size_t n = std::min(drain_slice_, draining_.size());
+        for (std::size_t i = 0; i < n; ++i) {
+            draining_.back()->close(websocket::close_code::service_restart);
+            draining_.pop_back();
+        }
+        if (draining_.empty()) {
+            if (on_drained_) std::exchange(on_drained_, nullptr)();
+            return;
+        }
+
+        drain_timer_.expires_after(kDrainTick);
+        drain_timer_.async_wait([this](beast::error_code ec) {
+            if (!ec) drain_tick();
+        });
+    }
+
+    static tcp::acceptor make_acceptor(asio::io_context& ioc, unsigned short port, int listen_fd) {
+        if (listen_fd >= 0) return tcp::acceptor(ioc, tcp::v4(), listen_fd);
+        return tcp::acceptor(ioc, tcp::endpoint(tcp::v4(), port));
+    }
+
+    void count_drop(std::size_t bytes) {
+        metrics_.dropped_frames.inc();
+        metrics_.dropped_bytes.inc(bytes);
     }
 
 private:
     asio::io_context& ioc_;
     tcp::acceptor acceptor_;
+    const Options options_;
+
+    std::unique_ptr<metrics::Registry> own_registry_;
+    ServerMetrics metrics_;
 
-    std::atomic<ClientId> next_client_id_{1};
+    SessionTable<Session> sessions_;
 
-    std::mutex mu_;
-    std::unordered_map<ClientId, std::shared_ptr<Session>> sessions_;
+    // Reaper state is only touched on reaper_strand_, except now_tick_.
+    Strand reaper_strand_;
+    asio::steady_timer reaper_timer_;
+    TimerWheel<ClientId> idle_wheel_;
+    const Clock::time_point epoch_;
+    const std::uint64_t ping_ticks_;
+    const std::uint64_t idle_ticks_;
+    std::atomic<std::uint64_t> now_tick_{0};
+
+    // Drain state, on reaper_strand_ too.
+    asio::steady_timer drain_timer_;
+    std::vector<std::shared_ptr<Session>> draining_;
+    std::size_t drain_slice_ = 0;
+    std::function<void()> on_drained_;
 
     OnConnect on_connect_;
     OnDisconnect on_disconnect_;
@@ -203,7 +682,10 @@ private:
 // ---- WebSocketServer wrapper ----
 
 WebSocketServer::WebSocketServer(asio::io_context& ioc, unsigned short port)
-    : impl_(new Impl(ioc, port)) {}
+    : WebSocketServer(ioc, port, Options{}) {}
+
+WebSocketServer::WebSocketServer(asio::io_context& ioc, unsigned short port, Options options)
+    : impl_(new Impl(ioc, port, options)) {}
 
 void WebSocketServer::set_on_connect(OnConnect cb) { impl_->set_on_connect(std::move(cb)); }
 void WebSocketServer::set_on_disconnect(OnDisconnect cb) { impl_->set_on_disconnect(std::move(cb)); }
@@ -212,7 +694,24 @@ void WebSocketServer::set_on_message(OnMessage cb) { impl_->set_on_message(std::
 void WebSocketServer::start() { impl_->start(); }
 void WebSocketServer::stop() { impl_->stop(); }
 
-void WebSocketServer::send(ClientId client, const std::string& msg) { impl_->send(client, msg); }
+void WebSocketServer::drain(std::chrono::milliseconds period, std::function<void()> done) {
+    impl_->drain(period, std::move(done));
+}
+
+int WebSocketServer::listener() { return impl_->listener(); }
+
+void WebSocketServer::send(ClientId client, const std::string& msg) { impl_->send(client, make_payload(msg)); }
+void WebSocketServer::send(ClientId client, Payload msg) { impl_->send(client, std::move(msg)); }
+
+void WebSocketServer::send(ClientId client, std::vector<Payload> msgs) { impl_->send(client, std::move(msgs)); }
+
+void WebSocketServer::broadcast(const std::vector<ClientId>& clients, const Payload& msg) {
+    impl_->broadcast(clients, msg);
+}
+
+std::string WebSocketServer::subprotocol(ClientId client) const { return impl_->subprotocol(client); }
+
+WebSocketServer::Stats WebSocketServer::stats() const { return impl_->stats(); }
 
 WebSocketServer::~WebSocketServer() = default;
 
@@ -1,21 +1,75 @@
 #pragma once
 
+#include "networking/ClientId.hpp"
+#include "networking/Deflate.h"
+#include "networking/Overflow.hpp"
+#include "networking/Payload.h"
+#include "metrics/Metrics.h"
+
 #include <boost/asio/io_context.hpp>
+#include <chrono>
 #include <cstdint>
 #include <functional>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace simplechat::networking {
 
-using ClientId = std::uint64_t;
 
 class WebSocketServer {
 public:
     using OnConnect    = std::function<void(ClientId)>;
     using OnDisconnect = std::function<void(ClientId)>;
-    using OnMessage    = std::function<void(ClientId, const std::string&)>;
+    // The view points into the session's read buffer and is only valid for
+    // the duration of the call.
+    using OnMessage    = std::function<void(ClientId, std::string_view)>;
+
+    using OverflowPolicy = networking::OverflowPolicy;
+
+    struct Options {
+        // Per-session outbound caps (frames not yet handed to the socket).
+        std::size_t max_queue_bytes = 4 * 1024 * 1024;
+        std::size_t max_queue_messages = 4096;
+        OverflowPolicy overflow = OverflowPolicy::DropOldest;
+
+        // Bytes coalesced ahead of the socket before writes start to queue.
+        std::size_t write_high_water = 64 * 1024;
+
+        DeflateOptions deflate;
+
+        // Sec-WebSocket-Protocol values the server accepts. The first one the
+        // client offers is selected; clients offering none get "".
+        std::vector<std::string> subprotocols;
+
+        // Liveness, driven by one shared timer wheel instead of a timer per
+        // session. A client silent (no messages, pings or pongs) for
+        // ping_interval is pinged; one silent for idle_timeout is closed.
+        // A zero idle_timeout disables both.
+        std::chrono::milliseconds ping_interval = std::chrono::seconds(20);
+        std::chrono::milliseconds idle_timeout = std::chrono::seconds(60);
+
+        // An already-listening TCP socket to accept on instead of binding
+        // port, e.g. one inherited from the previous process (see Handoff.h).
+        // The server takes ownership.
+        int listen_fd = -1;
+
+        // Registry for the server's counters and histograms (connections,
+        // frames, bytes, queue depth, write latency, fan-out). If null the
+        // server keeps them in a private registry.
+        metrics::Registry* metrics = nullptr;
+    };
+
+    struct Stats {
+        std::uint64_t dropped_frames = 0;
+        std::uint64_t dropped_bytes = 0;
+        std::uint64_t evicted_sessions = 0;
+        std::uint64_t idle_closed_sessions = 0;
+    };
 
     WebSocketServer(boost::asio::io_context& ioc, unsigned short port);
+    WebSocketServer(boost::asio::io_context& ioc, unsigned short port, Options options);
     ~WebSocketServer();
 
     WebSocketServer(const WebSocketServer&) = delete;            
@@ -28,8 +82,29 @@ public:
     void start();  // start accepting
     void stop();   // stop accepting + close active sessions
 
+    // Stops accepting, then closes the sessions a slice at a time over
+    // `period` with close code 1012 (service restart), so their reconnects
+    // are spread out rather than arriving at once. done() runs on an io
+    // thread once every session has been asked to close.
+    void drain(std::chrono::milliseconds period, std::function<void()> done);
+
+    // The listening socket, for handing to a successor process.
+    int listener();
+
     // Send to a client (optional for now; useful for "server push")
     void send(ClientId client, const std::string& msg);
+    void send(ClientId client, Payload msg);
+    // Queues several frames in order with a single hop to the session's strand.
+    void send(ClientId client, std::vector<Payload> msgs);
+
+    // Fan-out: every recipient shares the same Payload. Unknown ids are skipped.
+    void broadcast(const std::vector<ClientId>& clients, const Payload& msg);
+
+    // Subprotocol negotiated by the client ("" if none or unknown client).
+    std::string subprotocol(ClientId client) const;
+
+    // Backpressure and idle-close counters, aggregated over all sessions since start.
+    Stats stats() const;
 
 private:
     class Impl;
@@ -0,0 +1,75 @@
+#include "protocol/BinaryCodec.h"
+#include "memory/Pool.h"
+
+namespace simplechat::protocol {
+
+BinaryWriter::BinaryWriter(MsgType type, std::uint32_t room, std::uint32_t user,
+                           std::size_t reserve)
+    : out_(memory::acquire_buffer(kHeaderSize + reserve)) {
+    out_.push_back(static_cast<char>(type));
+    out_.push_back(static_cast<char>(kBinaryVersion));
+    out_.push_back('\0');
+    out_.push_back('\0');
+    put_u32(room);
+    put_u32(user);
+}
+
+BinaryWriter& BinaryWriter::str(std::string_view s) {
+    put_u32(static_cast<std::uint32_t>(s.size()));
+    out_.append(s.data(), s.size());
+    return *this;
+}
+
+void BinaryWriter::put_u32(std::uint32_t v) {
+    out_.push_back(static_cast<char>(v & 0xFF));
+    out_.push_back(static_cast<char>((v >> 8) & 0xFF));
+    out_.push_back(static_cast<char>((v >> 16) & 0xFF));
+    out_.push_back(static_cast<char>((v >> 24) & 0xFF));
+}
+
+namespace {
+
+void patch_u32(std::string& frame, std::size_t at, std::uint32_t v) noexcept {
+    if (frame.size() < kHeaderSize) return;
+    for (int i = 0; i < 4; ++i) {
+        frame[at + i] = static_cast<char>((v >> (8 * i)) & 0xFF);
+    }
+}
+
+} // namespace
+
+void set_room_handle(std::string& frame, std::uint32_t room) noexcept { patch_u32(frame, 4, room); }
+
+void set_user_handle(std::string& frame, std::uint32_t user) noexcept { patch_u32(frame, 8, user); }
+
+BinaryReader::BinaryReader(std::string_view frame) noexcept : in_(frame) {
+    if (in_.size() < kHeaderSize) return;
+    if (static_cast<std::uint8_t>(in_[1]) != kBinaryVersion) return;
+
+    header_.type = static_cast<MsgType>(static_cast<std::uint8_t>(in_[0]));
+    pos_ = 4;
+    ok_ = u32(header_.room) && u32(header_.user);
+}
+
+bool BinaryReader::str(std::string_view& out) noexcept {
+    std::uint32_t n = 0;
+    if (!ok_ || !u32(n) || in_.size() - pos_ < n) return false;
+
+    out = in_.substr(pos_, n);
+    pos_ += n;
+    return true;
+}
+
+bool BinaryReader::u32(std::uint32_t& v) noexcept {
+    if (in_.size() - pos_ < 4) return false;
+
+    const auto* p = reinterpret_cast<const unsigned char*>(in_.data() + pos_);
+    v = static_cast<std::uint32_t>(p[0]) |
+        static_cast<std::uint32_t>(p[1]) << 8 |
+        static_cast<std::uint32_t>(p[2]) << 16 |
+        static_cast<std::uint32_t>(p[3]) << 24;
+    pos_ += 4;
+    return true;
+}
+
+} // namespace simplechat::protocol
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace simplechat::protocol {
+
+// Compact binary protocol ("simplechat.bin.v1").
+//
+// Every frame starts with a fixed 12-byte little-endian header:
+//
+//   offset  size  field
+//   0       1     type     (MsgType)
+//   1       1     version  (kBinaryVersion)
+//   2       2     reserved (0)
+//   4       4     room     numeric room handle, 0 if not applicable
+//   8       4     user     numeric user handle, 0 if not applicable
+//
+// followed by the type's fields, each a u32 byte length plus UTF-8 bytes:
+//
+//   0x01 Join       (c->s)  name [, room [, token]]   room switches rooms;
+//                                                    token resumes that user
+//   0x02 Msg        (c->s)  text
+//   0x03 Create     (c->s)  [room]          new room (generated id if omitted), joined
+//   0x04 Leave      (c->s)                  back to the lobby
+//   0x05 List       (c->s)
+//   0x06 Dm         (c->s)  to, text        to is a user_id
+//   0x81 Welcome    (s->c)  client_id, user_id, room_id, text, token
+//   0x82 System     (s->c)  text
+//   0x83 Chat       (s->c)  from, text, user_id, client_id
+//   0x84 Error      (s->c)  text
+//   0x85 DebugJoin  (s->c)  name
+//   0x86 DebugMsg   (s->c)  name, text
+//   0x87 Room       (s->c)  room_id, members          now in header.room
+//   0x88 Rooms      (s->c)  total, {room_id, members}...
+//   0x89 Presence   (s->c)  members, joined, left, {user_id, name}...
+//                           one entry per joined then per left user; none
+//                           when the room is over the names limit
+//   0x8A Direct     (s->c)  from, from_user_id, to_user_id, text
+//   0x8B Identity   (s->c)  user_id, name, token, sessions
+//
+// Counts are sent as decimal fields so every field keeps the same framing.
+// Handles replace the ULID strings of the JSON protocol; Welcome, Room and
+// Identity carry the string ids once so a client can map them. Room handles
+// are reused after a room is torn down. A user handle belongs to the user,
+// shared by all its sessions, and is never reused by the process. Chat
+// still names its sender in full: frames relayed from another node or
+// replayed from the log have user handle 0.
+enum class MsgType : std::uint8_t {
+    Join      = 0x01,
+    Msg       = 0x02,
+    Create    = 0x03,
+    Leave     = 0x04,
+    List      = 0x05,
+    Dm        = 0x06,
+
+    Welcome   = 0x81,
+    System    = 0x82,
+    Chat      = 0x83,
+    Error     = 0x84,
+    DebugJoin = 0x85,
+    DebugMsg  = 0x86,
+    Room      = 0x87,
+    Rooms     = 0x88,
+    Presence  = 0x89,
+    Direct    = 0x8A,
+    Identity  = 0x8B,
+};
+
+inline constexpr std::uint8_t kBinaryVersion = 1;
+inline constexpr std::size_t kHeaderSize = 12;
+
+struct BinaryHeader {
+    MsgType type{};
+    std::uint32_t room = 0;
+    std::uint32_t user = 0;
+};
+
+// Builds one frame. Reserve with the expected field bytes to avoid regrowth.
+class BinaryWriter {
+public:
+    BinaryWriter(MsgType type, std::uint32_t room, std::uint32_t user,
+                 std::size_t reserve = 0);
+
+    BinaryWriter& str(std::string_view s);
+
+    std::string take() { return std::move(out_); }
+
+private:
+    void put_u32(std::uint32_t v);
+
+    std::string out_;
+};
+
+// Rewrites the room handle of an encoded frame in place (handles are
+// per-process, so frames persisted by an earlier run need the current one).
+void set_room_handle(std::string& frame, std::uint32_t room) noexcept;
+
+// Same for the user handle; 0 where the sender has none in this process.
+void set_user_handle(std::string& frame, std::uint32_t user) noexcept;
+
+// Zero-copy view over a received frame; str() yields views into it.
+class BinaryReader {
+public:
+    explicit BinaryReader(std::string_view frame) noexcept;
+
+    // False if the frame is shorter than a header or has the wrong version.
+    bool ok() const noexcept { return ok_; }
+    const BinaryHeader& header() const noexcept { return header_; }
+
+    // Reads the next length-prefixed field; false on truncation.
+    bool str(std::string_view& out) noexcept;
+
+private:
+    bool u32(std::uint32_t& v) noexcept;
+
+    std::string_view in_;
+    std::size_t pos_ = 0;
+    bool ok_ = false;
+    BinaryHeader header_;
+};
+
+} // namespace simplechat::protocol
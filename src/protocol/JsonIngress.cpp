@@ -0,0 +1,54 @@
+#include "protocol/JsonIngress.h"
+
+namespace simplechat::protocol {
+
+namespace json = boost::json;
+
+Command command_of(std::string_view type) noexcept {
+    switch (type.size()) {
+        case 2: return type == "dm" ? Command::Dm : Command::Unknown;
+        case 3: return type == "msg" ? Command::Msg : Command::Unknown;
+        case 4: return type == "join" ? Command::Join
+                     : type == "list" ? Command::List : Command::Unknown;
+        case 5: return type == "leave" ? Command::Leave : Command::Unknown;
+        case 6: return type == "create" ? Command::Create : Command::Unknown;
+        default: return Command::Unknown;
+    }
+}
+
+namespace {
+
+struct Arena {
+    alignas(std::max_align_t) unsigned char buffer[JsonIngress::kArenaSize];
+    json::monotonic_resource resource{buffer, sizeof(buffer)};
+    // Constructed in place so it keeps the arena as its storage.
+    std::optional<json::value> value;
+};
+
+} // namespace
+
+const json::object* JsonIngress::parse(std::string_view frame) noexcept {
+    thread_local Arena arena;
+
+    // Drop the previous frame's DOM, then rewind the arena to its start.
+    arena.value.reset();
+    arena.resource.release();
+
+    json::error_code ec;
+    arena.value.emplace(json::parse(json::string_view(frame.data(), frame.size()), ec,
+                                    json::storage_ptr(&arena.resource)));
+    if (ec) return nullptr;
+    return arena.value->if_object();
+}
+
+std::optional<std::string_view> string_field(const json::object& obj,
+                                             std::string_view key) noexcept {
+    const json::value* v = obj.if_contains(json::string_view(key.data(), key.size()));
+    if (!v) return std::nullopt;
+
+    const json::string* s = v->if_string();
+    if (!s) return std::nullopt;
+    return std::string_view(s->data(), s->size());
+}
+
+} // namespace simplechat::protocol
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <boost/json.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace simplechat::protocol {
+
+// Commands a client can send, resolved from the "type" field without
+// building a std::string.
+enum class Command : std::uint8_t { Join, Msg, Create, Leave, List, Dm, Unknown };
+
+Command command_of(std::string_view type) noexcept;
+
+// Allocation-free parser for inbound JSON frames.
+//
+// Each io thread owns an arena; a parse resets it and builds the DOM inside,
+// so frames that fit (kArenaSize) never touch the heap. The returned object
+// and any views taken from it stay valid until the next parse() on the same
+// thread, i.e. for the rest of the message handler.
+class JsonIngress {
+public:
+    static constexpr std::size_t kArenaSize = 16 * 1024;
+
+    // nullptr if frame is not valid JSON or not an object.
+    static const boost::json::object* parse(std::string_view frame) noexcept;
+};
+
+// View of a string member, or nullopt if absent or not a string.
+std::optional<std::string_view> string_field(const boost::json::object& obj,
+                                             std::string_view key) noexcept;
+
+} // namespace simplechat::protocol
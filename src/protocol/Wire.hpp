@@ -0,0 +1,20 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+
+namespace simplechat::protocol {
+
+// Wire format negotiated per connection via Sec-WebSocket-Protocol.
+enum class Wire : std::uint8_t {
+    Json,   // text frames, one JSON object each (default)
+    Binary  // binary frames, see BinaryCodec.h
+};
+
+inline constexpr std::string_view kJsonSubprotocol   = "simplechat.json";
+inline constexpr std::string_view kBinarySubprotocol = "simplechat.bin.v1";
+
+inline Wire wire_of(std::string_view subprotocol) noexcept {
+    return subprotocol == kBinarySubprotocol ? Wire::Binary : Wire::Json;
+}
+
+} // namespace simplechat::protocol
@@ -0,0 +1,293 @@
+#include "storage/MessageLog.h"
+
+#include "logging/Log.h"
+
+#include <boost/crc.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace simplechat::storage {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr std::size_t kRecordHeader = 8;   // body_len, crc
+constexpr std::size_t kBodyHeader = 10;    // room_len, json_len, binary_len
+
+void put_u16(std::string& out, std::uint16_t v) {
+    out.push_back(static_cast<char>(v & 0xFF));
+    out.push_back(static_cast<char>((v >> 8) & 0xFF));
+}
+
+void put_u32(std::string& out, std::uint32_t v) {
+    out.push_back(static_cast<char>(v & 0xFF));
+    out.push_back(static_cast<char>((v >> 8) & 0xFF));
+    out.push_back(static_cast<char>((v >> 16) & 0xFF));
+    out.push_back(static_cast<char>((v >> 24) & 0xFF));
+}
+
+std::uint32_t get_u32(const unsigned char* p) {
+    return std::uint32_t(p[0]) | std::uint32_t(p[1]) << 8 |
+           std::uint32_t(p[2]) << 16 | std::uint32_t(p[3]) << 24;
+}
+
+std::uint16_t get_u16(const unsigned char* p) {
+    return static_cast<std::uint16_t>(p[0] | p[1] << 8);
+}
+
+std::uint32_t crc32(const void* data, std::size_t n) {
+    boost::crc_32_type crc;
+    crc.process_bytes(data, n);
+    return crc.checksum();
+}
+
+// Walks one mapped segment; returns the length of its valid prefix.
+std::size_t scan(const unsigned char* data, std::size_t size,
+                 const MessageLog::RecoverFn& fn, std::size_t& records) {
+    std::size_t pos = 0;
+    while (size - pos >= kRecordHeader) {
+        const std::uint32_t body_len = get_u32(data + pos);
+        const std::uint32_t crc = get_u32(data + pos + 4);
+        if (body_len < kBodyHeader || size - pos - kRecordHeader < body_len) break;
+
+        const unsigned char* body = data + pos + kRecordHeader;
+        if (crc32(body, body_len) != crc) break;
+
+        const std::size_t room_len = get_u16(body);
+        const std::size_t json_len = get_u32(body + 2);
+        const std::size_t binary_len = get_u32(body + 6);
+        if (kBodyHeader + room_len + json_len + binary_len != body_len) break;
+
+        const char* p = reinterpret_cast<const char*>(body + kBodyHeader);
+        LogRecord rec;
+        rec.room_id = std::string_view(p, room_len);
+        rec.json = std::string_view(p + room_len, json_len);
+        rec.binary = std::string_view(p + room_len + json_len, binary_len);
+        fn(rec);
+
+        ++records;
+        pos += kRecordHeader + body_len;
+    }
+    return pos;
+}
+
+} // namespace
+
+MessageLog::MessageLog(LogOptions options) : options_(std::move(options)) {
+    fs::create_directories(options_.dir);
+
+    // Segments are named by sequence number; new ones continue after the last.
+    for (const auto& entry : fs::directory_iterator(options_.dir)) {
+        const auto name = entry.path().filename().string();
+        if (entry.path().extension() != ".log") continue;
+        try {
+            const std::uint64_t seq = std::stoull(name);
+            if (first_seq_ == 0 || seq < first_seq_) first_seq_ = seq;
+            seq_ = std::max(seq_, seq);
+        } catch (const std::exception&) {
+            // not ours
+        }
+    }
+    if (first_seq_ == 0) first_seq_ = 1;
+}
+
+MessageLog::~MessageLog() {
+    stop();
+    // Appended after a stop() that no start() followed (a handoff racing a
+    // last message); say so rather than lose them quietly.
+    std::lock_guard<std::mutex> lk(mu_);
+    if (!pending_.empty()) {
+        logging::warn("msglog", "discarding {} bytes appended after the log stopped", pending_.size());
+    }
+}
+
+std::size_t MessageLog::recover(const RecoverFn& fn) {
+    std::size_t records = 0;
+
+    for (std::uint64_t seq = first_seq_; seq <= seq_; ++seq) {
+        const std::string path = segment_path(seq);
+        const int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+        if (fd < 0) continue;
+
+        struct stat st {};
+        if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+            ::close(fd);
+            continue;
+        }
+
+        const auto size = static_cast<std::size_t>(st.st_size);
+        void* map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            logging::error("msglog", "mmap {}: {}", path, std::strerror(errno));
+            ::close(fd);
+            continue;
+        }
+        ::madvise(map, size, MADV_SEQUENTIAL);
+
+        const std::size_t valid = scan(static_cast<const unsigned char*>(map), size, fn, records);
+        ::munmap(map, size);
+
+        if (valid != size) {
+            logging::warn("msglog", "{}: dropping {} bytes after last intact record", path, size - valid);
+            if (::ftruncate(fd, static_cast<off_t>(valid)) != 0) {
+                logging::error("msglog", "truncate {}: {}", path, std::strerror(errno));
+            }
+        }
+        ::close(fd);
+    }
+    return records;
+}
+
+void MessageLog::start() {
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        stopping_ = false;
+    }
+    open_segment();
+    writer_ = std::thread([this] { run(); });
+}
+
+void MessageLog::stop() {
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        stopping_ = true;
+    }
+    cv_.notify_one();
+    if (writer_.joinable()) writer_.join();
+
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+MessageLog::Record MessageLog::frame(std::string_view room_id, std::string_view json, std::string_view binary) {
+    const std::size_t room_len = std::min<std::size_t>(room_id.size(), 0xFFFF);
+    const std::size_t body_len = kBodyHeader + room_len + json.size() + binary.size();
+
+    Record out;
+    std::string& record = out.bytes_;
+    record.reserve(kRecordHeader + body_len);
+    put_u32(record, static_cast<std::uint32_t>(body_len));
+    put_u32(record, 0);  // crc, filled in below
+    put_u16(record, static_cast<std::uint16_t>(room_len));
+    put_u32(record, static_cast<std::uint32_t>(json.size()));
+    put_u32(record, static_cast<std::uint32_t>(binary.size()));
+    record.append(room_id.data(), room_len);
+    record.append(json.data(), json.size());
+    record.append(binary.data(), binary.size());
+
+    const std::uint32_t crc = crc32(record.data() + kRecordHeader, body_len);
+    for (int i = 0; i < 4; ++i) {
+        record[4 + i] = static_cast<char>((crc >> (8 * i)) & 0xFF);
+    }
+    return out;
+}
+
+void MessageLog::append(const Record& record) {
+    std::lock_guard<std::mutex> lk(mu_);
+    if (pending_.size() + record.size() > options_.max_pending_bytes) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    const bool wake = pending_.empty();
+    pending_.append(record.bytes_);
+    if (wake) cv_.notify_one();
+}
+
+void MessageLog::run() {
+    std::string batch;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lk(mu_);
+            cv_.wait(lk, [&] { return stopping_ || !pending_.empty(); });
+            if (pending_.empty()) return;  // stopping and drained
+            batch.clear();
+            std::swap(batch, pending_);
+        }
+        write_batch(batch);
+    }
+}
+
+void MessageLog::write_batch(const std::string& batch) {
+    if (segment_size_ > 0 && segment_size_ + batch.size() > options_.segment_bytes) {
+        open_segment();
+    }
+    if (fd_ < 0) return;
+
+    const char* p = batch.data();
+    std::size_t left = batch.size();
+    while (left > 0) {
+        const ssize_t n = ::write(fd_, p, left);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            logging::error("msglog", "write: {}", std::strerror(errno));
+            return;
+        }
+        p += n;
+        left -= static_cast<std::size_t>(n);
+    }
+    segment_size_ += batch.size();
+
+    // One sync for every record in the batch.
+    if (::fdatasync(fd_) != 0) {
+        logging::error("msglog", "fdatasync: {}", std::strerror(errno));
+    }
+}
+
+void MessageLog::open_segment() {
+    if (fd_ >= 0) ::close(fd_);
+
+    // Skips numbers taken meanwhile: a restart after a failed handoff may
+    // find segments the would-be successor wrote.
+    std::string path;
+    do {
+        ++seq_;
+        path = segment_path(seq_);
+        fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_APPEND | O_CLOEXEC, 0644);
+    } while (fd_ < 0 && errno == EEXIST);
+    segment_size_ = 0;
+    if (fd_ < 0) {
+        logging::error("msglog", "open {}: {}", path, std::strerror(errno));
+        return;
+    }
+
+    // Make the new directory entry durable too.
+    const int dir = ::open(options_.dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir >= 0) {
+        ::fsync(dir);
+        ::close(dir);
+    }
+
+    prune_segments();
+}
+
+void MessageLog::prune_segments() {
+    while (seq_ - first_seq_ + 1 > options_.max_segments) {
+        std::error_code ec;
+        fs::remove(segment_path(first_seq_), ec);
+        ++first_seq_;
+    }
+}
+
+std::string MessageLog::segment_path(std::uint64_t seq) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llu.log", static_cast<unsigned long long>(seq));
+    return (fs::path(options_.dir) / name).string();
+}
+
+} // namespace simplechat::storage
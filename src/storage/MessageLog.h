@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace simplechat::storage {
+
+struct LogOptions {
+    std::string dir;                                // created if missing
+    std::size_t segment_bytes = 64 * 1024 * 1024;   // roll to a new file past this
+    std::size_t max_segments = 16;                  // oldest are deleted beyond this
+    std::size_t max_pending_bytes = 16 * 1024 * 1024;  // appends dropped past this
+};
+
+// One persisted chat message: the room and its frames exactly as broadcast.
+// Views point into a mapped segment and are valid only during the callback.
+struct LogRecord {
+    std::string_view room_id;
+    std::string_view json;
+    std::string_view binary;
+};
+
+// Segmented append-only message log.
+//
+// frame() builds and checksums a record on the caller's thread, before it
+// takes any lock; append() only copies that into a pending buffer under the
+// log's lock, so a caller may append while holding its own. A background
+// writer swaps that buffer out, writes it with one write() and one
+// fdatasync() (group commit), so callers never wait on the disk. Records
+// appended while a sync is running go out together in the next batch.
+//
+// On disk the log is <dir>/<seq>.log segments of records:
+//
+//   u32 body_len | u32 crc32(body) | body
+//   body = u16 room_len | u32 json_len | u32 binary_len | room | json | binary
+//
+// little-endian. recover() maps each segment read-only and walks it, so
+// startup neither copies the files through read() nor reparses any JSON. A
+// torn record at the tail of the last segment (crash mid-write) is truncated.
+class MessageLog {
+public:
+    using RecoverFn = std::function<void(const LogRecord&)>;
+
+    // One framed, checksummed record, ready for append().
+    class Record {
+    public:
+        std::size_t size() const noexcept { return bytes_.size(); }
+
+    private:
+        friend class MessageLog;
+        std::string bytes_;
+    };
+
+    // Throws std::system_error if dir cannot be created.
+    explicit MessageLog(LogOptions options);
+    ~MessageLog();  // flushes pending records; warns about any held while stopped
+
+    MessageLog(const MessageLog&) = delete;
+    MessageLog& operator=(const MessageLog&) = delete;
+
+    // Replays every intact record, oldest first. Call before start().
+    // Returns the number of records replayed.
+    std::size_t recover(const RecoverFn& fn);
+
+    // Opens a fresh segment and starts the writer thread. May be called
+    // again after stop().
+    void start();
+
+    // Flushes what is pending and joins the writer.
+    void stop();
+
+    // Frames and checksums a record. Touches no shared state.
+    static Record frame(std::string_view room_id, std::string_view json, std::string_view binary);
+
+    // Copies record into the pending buffer. Non-blocking; safe from any
+    // thread. While stopped, records are held (within max_pending_bytes)
+    // for the next start(), and discarded (with a warning) if there is none.
+    void append(const Record& record);
+    void append(std::string_view room_id, std::string_view json, std::string_view binary) {
+        append(frame(room_id, json, binary));
+    }
+
+    // Records dropped because the writer fell max_pending_bytes behind.
+    std::uint64_t dropped() const noexcept { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    void run();
+    void write_batch(const std::string& batch);
+    void open_segment();
+    void prune_segments();
+    std::string segment_path(std::uint64_t seq) const;
+
+    const LogOptions options_;
+
+    std::mutex mu_;
+    std::condition_variable cv_;
+    std::string pending_;
+    bool stopping_ = false;
+    std::thread writer_;
+    std::atomic<std::uint64_t> dropped_{0};
+
+    // Writer thread only (and recover() before start()).
+    int fd_ = -1;
+    std::uint64_t first_seq_ = 0;
+    std::uint64_t seq_ = 0;
+    std::size_t segment_size_ = 0;
+};
+
+} // namespace simplechat::storage
@@ -0,0 +1,147 @@
+#include "protocol/BinaryCodec.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+using simplechat::protocol::BinaryReader;
+using simplechat::protocol::BinaryWriter;
+using simplechat::protocol::kBinaryVersion;
+using simplechat::protocol::kHeaderSize;
+using simplechat::protocol::MsgType;
+using simplechat::protocol::set_room_handle;
+using simplechat::protocol::set_user_handle;
+
+namespace {
+
+// A header followed by raw bytes, for frames the writer would not produce.
+std::string frame_with(std::string_view body, std::uint8_t type = 0x02) {
+    std::string out = BinaryWriter(static_cast<MsgType>(type), 0, 0).take();
+    out.append(body.data(), body.size());
+    return out;
+}
+
+std::string u32(std::uint32_t v) {
+    std::string out;
+    for (int i = 0; i < 4; ++i) out.push_back(static_cast<char>(v >> (8 * i)));
+    return out;
+}
+
+} // namespace
+
+TEST(BinaryCodec, RoundTrips) {
+    const std::string binary("a\0b\xff", 4);
+    const std::string frame = BinaryWriter(MsgType::Chat, 7, 0x01020304)
+                                  .str("alice")
+                                  .str("")
+                                  .str(binary)
+                                  .take();
+    ASSERT_EQ(frame.size(), kHeaderSize + 3 * 4 + 5 + 0 + 4);
+    EXPECT_EQ(static_cast<std::uint8_t>(frame[1]), kBinaryVersion);
+
+    BinaryReader in(frame);
+    ASSERT_TRUE(in.ok());
+    EXPECT_EQ(in.header().type, MsgType::Chat);
+    EXPECT_EQ(in.header().room, 7u);
+    EXPECT_EQ(in.header().user, 0x01020304u);
+
+    std::string_view a, b, c, none;
+    ASSERT_TRUE(in.str(a));
+    ASSERT_TRUE(in.str(b));
+    ASSERT_TRUE(in.str(c));
+    EXPECT_EQ(a, "alice");
+    EXPECT_EQ(b, "");
+    EXPECT_EQ(c, binary);
+    EXPECT_FALSE(in.str(none));  // end of frame
+}
+
+TEST(BinaryCodec, RejectsTruncatedHeader) {
+    const std::string frame = BinaryWriter(MsgType::Msg, 1, 2).str("hi").take();
+    for (std::size_t n = 0; n < kHeaderSize; ++n) {
+        EXPECT_FALSE(BinaryReader(std::string_view(frame).substr(0, n)).ok()) << n;
+    }
+    EXPECT_TRUE(BinaryReader(std::string_view(frame).substr(0, kHeaderSize)).ok());
+
+    std::string_view field;
+    BinaryReader bad(std::string_view(frame).substr(0, 5));
+    EXPECT_FALSE(bad.str(field));
+}
+
+TEST(BinaryCodec, RejectsOtherVersions) {
+    std::string frame = BinaryWriter(MsgType::Msg, 0, 0).str("hi").take();
+    frame[1] = static_cast<char>(kBinaryVersion + 1);
+    BinaryReader in(frame);
+    EXPECT_FALSE(in.ok());
+    std::string_view field;
+    EXPECT_FALSE(in.str(field));
+}
+
+TEST(BinaryCodec, RejectsLengthsPastTheEnd) {
+    std::string_view field;
+
+    // Length prefix itself cut short.
+    BinaryReader short_prefix(frame_with(std::string("\x02\0", 2)));
+    ASSERT_TRUE(short_prefix.ok());
+    EXPECT_FALSE(short_prefix.str(field));
+
+    // One byte missing from the body.
+    const std::string one_short = frame_with(u32(3) + "ab");
+    BinaryReader truncated(one_short);
+    EXPECT_FALSE(truncated.str(field));
+
+    // A length that would wrap a careless bounds check.
+    for (std::uint32_t n : {0xFFFFFFFFu, 0x80000000u, 0xFFFFFFF0u}) {
+        const std::string huge = frame_with(u32(n) + "abcd");
+        BinaryReader in(huge);
+        EXPECT_FALSE(in.str(field)) << n;
+    }
+
+    // A good field, then a bad one: the first is still readable.
+    const std::string mixed = frame_with(u32(2) + "ok" + u32(10) + "x");
+    BinaryReader in(mixed);
+    ASSERT_TRUE(in.str(field));
+    EXPECT_EQ(field, "ok");
+    EXPECT_FALSE(in.str(field));
+}
+
+TEST(BinaryCodec, ReadsUnknownTypes) {
+    // The reader does not judge the type; dispatch rejects what it does not know.
+    const std::string frame = frame_with(u32(1) + "x", 0x7F);
+    BinaryReader in(frame);
+    ASSERT_TRUE(in.ok());
+    EXPECT_EQ(static_cast<std::uint8_t>(in.header().type), 0x7F);
+    std::string_view field;
+    EXPECT_TRUE(in.str(field));
+}
+
+TEST(BinaryCodec, CarriesLargeFields) {
+    const std::string big(1 << 20, 'z');
+    const std::string frame = BinaryWriter(MsgType::Msg, 0, 0, big.size() + 4).str(big).take();
+    BinaryReader in(frame);
+    std::string_view field;
+    ASSERT_TRUE(in.str(field));
+    EXPECT_EQ(field.size(), big.size());
+    EXPECT_EQ(field.data(), frame.data() + kHeaderSize + 4);  // a view, not a copy
+}
+
+TEST(BinaryCodec, RewritesHandlesInPlace) {
+    std::string frame = BinaryWriter(MsgType::Chat, 1, 2).str("from").str("text").take();
+    const std::string body = frame.substr(kHeaderSize);
+
+    set_room_handle(frame, 0xAABBCCDD);
+    set_user_handle(frame, 0);
+    BinaryReader in(frame);
+    ASSERT_TRUE(in.ok());
+    EXPECT_EQ(in.header().type, MsgType::Chat);
+    EXPECT_EQ(in.header().room, 0xAABBCCDDu);
+    EXPECT_EQ(in.header().user, 0u);
+    EXPECT_EQ(frame.substr(kHeaderSize), body);
+
+    // Too short to have a header: left alone.
+    std::string stub("\x83\x01", 2);
+    set_room_handle(stub, 5);
+    set_user_handle(stub, 5);
+    EXPECT_EQ(stub, std::string("\x83\x01", 2));
+}
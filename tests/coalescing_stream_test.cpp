@@ -0,0 +1,79 @@
+#include "networking/CoalescingStream.hpp"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/read.hpp>
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+
+using simplechat::networking::CoalescingStream;
+
+namespace asio = boost::asio;
+using tcp = asio::ip::tcp;
+
+namespace {
+
+class CoalescingStreamTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        tcp::acceptor acceptor(io_, {asio::ip::address_v4::loopback(), 0});
+        stream_.next_layer().connect(acceptor.local_endpoint());
+        acceptor.accept(peer_);
+    }
+
+    std::string receive(std::size_t n) {
+        std::string out(n, '\0');
+        asio::read(peer_, asio::buffer(out));
+        return out;
+    }
+
+    asio::io_context io_;
+    CoalescingStream<tcp::socket> stream_{io_};
+    tcp::socket peer_{io_};
+};
+
+} // namespace
+
+TEST_F(CoalescingStreamTest, KeepsFramesInOrder) {
+    auto body = std::make_shared<const std::string>("payload");
+    std::weak_ptr<const std::string> watch = body;
+    int completed = 0;
+    auto done = [&](boost::beast::error_code ec, std::size_t) {
+        EXPECT_FALSE(ec);
+        ++completed;
+    };
+
+    stream_.async_write_some(asio::buffer(std::string("ab")), done);
+    stream_.async_write_frame(asio::buffer(std::string("<h>")), asio::buffer(*body), body, done);
+    stream_.async_write_some(asio::buffer(std::string("cd")), done);
+    body.reset();
+
+    // Held by the stream until it has been written.
+    EXPECT_FALSE(watch.expired());
+    io_.run();
+
+    EXPECT_EQ(completed, 3);
+    EXPECT_EQ(stream_.buffered(), 0u);
+    EXPECT_TRUE(watch.expired());
+    EXPECT_EQ(receive(14), "ab<h>payloadcd");
+}
+
+TEST_F(CoalescingStreamTest, HoldsCompletionsPastHighWaterMark) {
+    stream_.high_water_mark(4);
+    const std::string big(64, 'x');
+    std::size_t written = 0, left = big.size();
+
+    stream_.async_write_some(asio::buffer(big), [&](boost::beast::error_code ec, std::size_t n) {
+        EXPECT_FALSE(ec);
+        written = n;
+        left = stream_.buffered();
+    });
+    io_.run();
+
+    EXPECT_EQ(written, big.size());
+    EXPECT_EQ(left, 0u);  // completed only once the socket had taken it
+    EXPECT_EQ(receive(big.size()), big);
+}
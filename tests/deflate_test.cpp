@@ -0,0 +1,61 @@
+#include "networking/Deflate.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+using simplechat::networking::make_frame_header;
+using simplechat::networking::parse_deflate_extension;
+
+TEST(Deflate, ParsesBareExtension) {
+    const auto params = parse_deflate_extension("permessage-deflate");
+    ASSERT_TRUE(params);
+    EXPECT_FALSE(params->server_no_context_takeover);
+    EXPECT_FALSE(params->client_no_context_takeover);
+    EXPECT_EQ(params->server_max_window_bits, 15);
+    EXPECT_EQ(params->client_max_window_bits, 15);
+}
+
+TEST(Deflate, ParsesParameters) {
+    const auto params = parse_deflate_extension(
+        "Permessage-Deflate ; server_no_context_takeover; client_no_context_takeover;"
+        " server_max_window_bits=10; client_max_window_bits=\"9\"");
+    ASSERT_TRUE(params);
+    EXPECT_TRUE(params->server_no_context_takeover);
+    EXPECT_TRUE(params->client_no_context_takeover);
+    EXPECT_EQ(params->server_max_window_bits, 10);
+    EXPECT_EQ(params->client_max_window_bits, 9);
+
+    // Offered without a value: the client takes any window.
+    const auto bare = parse_deflate_extension("permessage-deflate; client_max_window_bits");
+    ASSERT_TRUE(bare);
+    EXPECT_EQ(bare->client_max_window_bits, 15);
+}
+
+TEST(Deflate, SkipsOtherExtensionsAndMalformedOffers) {
+    const auto params = parse_deflate_extension(
+        "x-webkit-deflate-frame, permessage-deflate; server_max_window_bits=16,"
+        " permessage-deflate; server_max_window_bits=12");
+    ASSERT_TRUE(params);
+    EXPECT_EQ(params->server_max_window_bits, 12);
+}
+
+TEST(Deflate, RejectsMalformed) {
+    EXPECT_FALSE(parse_deflate_extension(""));
+    EXPECT_FALSE(parse_deflate_extension("x-webkit-deflate-frame"));
+    EXPECT_FALSE(parse_deflate_extension("permessage-deflate; unknown_param"));
+    EXPECT_FALSE(parse_deflate_extension("permessage-deflate; server_max_window_bits"));
+    EXPECT_FALSE(parse_deflate_extension("permessage-deflate; server_max_window_bits=7"));
+    EXPECT_FALSE(parse_deflate_extension("permessage-deflate; server_max_window_bits=abc"));
+    EXPECT_FALSE(parse_deflate_extension("permessage-deflate; server_no_context_takeover=1"));
+    EXPECT_FALSE(parse_deflate_extension(
+        "permessage-deflate; server_no_context_takeover; server_no_context_takeover"));
+}
+
+TEST(Deflate, FrameHeaderLengths) {
+    EXPECT_EQ(make_frame_header(5, false, false), std::string("\x81\x05", 2));
+    EXPECT_EQ(make_frame_header(5, true, true), std::string("\xC2\x05", 2));
+    EXPECT_EQ(make_frame_header(300, true, false), std::string("\x82\x7E\x01\x2C", 4));
+    EXPECT_EQ(make_frame_header(70000, false, false),
+              std::string("\x81\x7F\x00\x00\x00\x00\x00\x01\x11\x70", 10));
+}
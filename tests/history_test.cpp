@@ -0,0 +1,110 @@
+#include "chat/History.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+using simplechat::chat::History;
+using simplechat::chat::HistoryEntry;
+using simplechat::chat::HistoryLimits;
+using simplechat::networking::make_payload;
+using simplechat::networking::Payload;
+using simplechat::protocol::Wire;
+
+namespace {
+
+// JSON frame "<text>" and a binary frame of `binary` bytes (none if 0).
+HistoryEntry entry(const std::string& text, std::size_t binary = 0) {
+    HistoryEntry e;
+    e.frames[0] = make_payload(text);
+    if (binary > 0) e.frames[1] = make_payload(std::string(binary, 'b'), true);
+    return e;
+}
+
+std::vector<std::string> texts(const History& history) {
+    std::vector<std::string> out;
+    history.for_each([&](const HistoryEntry& e) { out.push_back(e.frames[0]->data()); });
+    return out;
+}
+
+} // namespace
+
+TEST(History, EvictsOldestByCount) {
+    History history(HistoryLimits{3, 1024});
+    for (const char* t : {"a", "b", "c", "d", "e"}) history.push(entry(t));
+
+    EXPECT_EQ(history.size(), 3u);
+    EXPECT_EQ(history.bytes(), 3u);
+    EXPECT_EQ(texts(history), (std::vector<std::string>{"c", "d", "e"}));
+}
+
+TEST(History, EvictsOldestByBytes) {
+    // Both encodings count.
+    History history(HistoryLimits{100, 30});
+    history.push(entry("aaaaa", 5));  // 10
+    history.push(entry("bbbbb", 5));  // 20
+    history.push(entry("ccccc", 5));  // 30
+    EXPECT_EQ(history.size(), 3u);
+    EXPECT_EQ(history.bytes(), 30u);
+
+    history.push(entry("dddddddddddddddddddd"));  // 20: a and b make room
+    EXPECT_EQ(texts(history), (std::vector<std::string>{"ccccc", "dddddddddddddddddddd"}));
+    EXPECT_EQ(history.bytes(), 30u);
+}
+
+TEST(History, SkipsEntryLargerThanBudget) {
+    History history(HistoryLimits{10, 16});
+    history.push(entry("small"));
+    history.push(entry(std::string(17, 'x')));
+
+    // Not stored, and nothing evicted to make room for it.
+    EXPECT_EQ(texts(history), std::vector<std::string>{"small"});
+    EXPECT_EQ(history.bytes(), 5u);
+}
+
+TEST(History, ZeroMessagesKeepsNothing) {
+    History history(HistoryLimits{0, 1024});
+    history.push(entry("a"));
+    EXPECT_EQ(history.size(), 0u);
+    EXPECT_EQ(history.bytes(), 0u);
+}
+
+// Bytes evict from a partly grown ring, which then wraps; growing it again
+// must keep the order.
+TEST(History, GrowsAfterWrapping) {
+    History history(HistoryLimits{4, 31});
+    history.push(entry("1111111111"));
+    history.push(entry("2222222222"));
+    history.push(entry("3333333333"));
+    history.push(entry("444444444444444"));  // evicts 1 and 2; wraps to slot 0
+    history.push(entry("55555"));            // all 3 slots in use
+    history.push(entry("6"));                // grows to 4
+    EXPECT_EQ(texts(history), (std::vector<std::string>{"3333333333", "444444444444444", "55555", "6"}));
+
+    history.push(entry("7"));  // at max_messages: evicts 3
+    EXPECT_EQ(texts(history), (std::vector<std::string>{"444444444444444", "55555", "6", "7"}));
+    EXPECT_EQ(history.bytes(), 22u);
+}
+
+TEST(History, CollectsOneWire) {
+    History history;
+    history.push(entry("a", 3));
+    history.push(entry("b"));  // JSON only
+    history.push(entry("c", 4));
+
+    std::vector<Payload> json, binary;
+    history.collect(Wire::Json, json);
+    history.collect(Wire::Binary, binary);
+    ASSERT_EQ(json.size(), 3u);
+    EXPECT_EQ(json[2]->data(), "c");
+    ASSERT_EQ(binary.size(), 2u);
+    EXPECT_EQ(binary[0]->size(), 3u);
+    EXPECT_EQ(binary[1]->size(), 4u);
+    EXPECT_TRUE(binary[0]->binary());
+
+    // Shared, not copied.
+    std::vector<Payload> again;
+    history.collect(Wire::Json, again);
+    EXPECT_EQ(again[0], json[0]);
+}
@@ -0,0 +1,67 @@
+#include "protocol/JsonIngress.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <string_view>
+
+using simplechat::protocol::Command;
+using simplechat::protocol::command_of;
+using simplechat::protocol::JsonIngress;
+using simplechat::protocol::string_field;
+
+TEST(JsonIngress, CommandOfKnownTypes) {
+    EXPECT_EQ(command_of("dm"), Command::Dm);
+    EXPECT_EQ(command_of("msg"), Command::Msg);
+    EXPECT_EQ(command_of("join"), Command::Join);
+    EXPECT_EQ(command_of("list"), Command::List);
+    EXPECT_EQ(command_of("leave"), Command::Leave);
+    EXPECT_EQ(command_of("create"), Command::Create);
+}
+
+// Every length the switch handles, with a word that is not a command, and
+// lengths it does not.
+TEST(JsonIngress, CommandOfRejectsOthers) {
+    for (std::string_view type : {"", "d", "dn", "ms", "mgs", "msgs", "jion", "lisp", "JOIN",
+                                  "leav", "leave ", "creat", "create!", "creatE", "direct"}) {
+        EXPECT_EQ(command_of(type), Command::Unknown) << type;
+    }
+    EXPECT_EQ(command_of(std::string_view("msg\0", 4)), Command::Unknown);
+}
+
+TEST(JsonIngress, ParsesObjects) {
+    const auto* obj = JsonIngress::parse(R"({"type":"msg","text":"a\nb é","n":3})");
+    ASSERT_NE(obj, nullptr);
+    EXPECT_EQ(string_field(*obj, "type"), "msg");
+    EXPECT_EQ(string_field(*obj, "text"), "a\nb \xc3\xa9");
+
+    // Absent, or not a string.
+    EXPECT_FALSE(string_field(*obj, "room"));
+    EXPECT_FALSE(string_field(*obj, "n"));
+}
+
+TEST(JsonIngress, RejectsMalformedAndNonObjects) {
+    for (std::string_view frame : {"", " ", "{", R"({"type":)", R"({"type":"msg")", R"({"type":"msg"}x)",
+                                   R"({'type':'msg'})", "[1,2]", R"("msg")", "3", "null"}) {
+        EXPECT_EQ(JsonIngress::parse(frame), nullptr) << frame;
+    }
+}
+
+// Bigger than the arena: parsing still works, from the heap.
+TEST(JsonIngress, ParsesFramesPastTheArena) {
+    const std::string text(JsonIngress::kArenaSize * 4, 'x');
+    const auto* obj = JsonIngress::parse(R"({"type":"msg","text":")" + text + "\"}");
+    ASSERT_NE(obj, nullptr);
+    EXPECT_EQ(string_field(*obj, "text")->size(), text.size());
+}
+
+// Each parse starts over on the same arena; a failure leaves nothing behind.
+TEST(JsonIngress, ReusesTheArena) {
+    for (int i = 0; i < 1000; ++i) {
+        const std::string text = "message " + std::to_string(i);
+        const auto* obj = JsonIngress::parse(R"({"type":"msg","text":")" + text + "\"}");
+        ASSERT_NE(obj, nullptr);
+        EXPECT_EQ(string_field(*obj, "text"), text);
+        EXPECT_EQ(JsonIngress::parse("{bad"), nullptr);
+    }
+}
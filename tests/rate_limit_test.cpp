@@ -0,0 +1,88 @@
+#include "chat/RateLimit.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+using simplechat::chat::RateLimit;
+using simplechat::chat::Throttle;
+using simplechat::chat::TokenBucket;
+
+namespace {
+
+constexpr std::int64_t kMs = 1'000'000;
+constexpr std::int64_t kStart = 1'000'000 * kMs;  // any point on the steady clock
+
+} // namespace
+
+TEST(RateLimit, ZeroRateIsUnlimited) {
+    TokenBucket bucket(0, 5);
+    EXPECT_TRUE(bucket.unlimited());
+    for (int i = 0; i < 1000; ++i) EXPECT_TRUE(bucket.try_take(1e6, kStart));
+    EXPECT_TRUE(Throttle(RateLimit{}).unlimited());
+}
+
+TEST(RateLimit, BurstThenRefill) {
+    TokenBucket bucket(10, 5);  // one token per 100 ms
+    for (int i = 0; i < 5; ++i) EXPECT_TRUE(bucket.try_take(1, kStart)) << i;
+    EXPECT_FALSE(bucket.try_take(1, kStart));
+
+    // One token back after 100 ms, not before.
+    EXPECT_FALSE(bucket.try_take(1, kStart + 99 * kMs));
+    EXPECT_TRUE(bucket.try_take(1, kStart + 100 * kMs));
+    EXPECT_FALSE(bucket.try_take(1, kStart + 100 * kMs));
+
+    // Idle for long enough refills to the burst and no further.
+    const std::int64_t later = kStart + 10'000 * kMs;
+    for (int i = 0; i < 5; ++i) EXPECT_TRUE(bucket.try_take(1, later)) << i;
+    EXPECT_FALSE(bucket.try_take(1, later));
+}
+
+TEST(RateLimit, ZeroBurstAllowsOneSecond) {
+    TokenBucket bucket(10, 0);
+    for (int i = 0; i < 10; ++i) EXPECT_TRUE(bucket.try_take(1, kStart)) << i;
+    EXPECT_FALSE(bucket.try_take(1, kStart));
+}
+
+TEST(RateLimit, CostLargerThanBurstNeverPasses) {
+    TokenBucket bucket(100, 50);
+    EXPECT_FALSE(bucket.try_take(51, kStart));
+    EXPECT_FALSE(bucket.try_take(51, kStart + 3600'000 * kMs));
+    EXPECT_TRUE(bucket.try_take(50, kStart));
+}
+
+TEST(RateLimit, GiveBackUndoesTake) {
+    TokenBucket bucket(10, 2);
+    EXPECT_TRUE(bucket.try_take(2, kStart));
+    EXPECT_FALSE(bucket.try_take(1, kStart));
+    bucket.give_back(1);
+    EXPECT_TRUE(bucket.try_take(1, kStart));
+}
+
+// A frame the byte bucket refuses is not charged to the message bucket.
+TEST(RateLimit, ThrottleChargesBothOrNeither) {
+    Throttle throttle(RateLimit{1, 2, 1, 100});
+    EXPECT_FALSE(throttle.allow(1000));
+    EXPECT_TRUE(throttle.allow(10));
+    EXPECT_TRUE(throttle.allow(10));
+    EXPECT_FALSE(throttle.allow(10));  // message burst spent
+}
+
+// Shared by every member's strand: concurrent takes never overdraw.
+TEST(RateLimit, ConcurrentTakesRespectBurst) {
+    TokenBucket bucket(1, 1000);
+    std::atomic<int> granted{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 1000; ++i) {
+                if (bucket.try_take(1, kStart)) granted.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    EXPECT_EQ(granted.load(), 1000);
+}
@@ -0,0 +1,151 @@
+#include "chat/Room.h"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using simplechat::chat::HistoryEntry;
+using simplechat::chat::Room;
+using simplechat::chat::room_id_of;
+using simplechat::chat::RoomHandle;
+using simplechat::chat::RoomRegistry;
+using simplechat::networking::make_payload;
+using simplechat::protocol::Wire;
+
+namespace {
+
+auto no_replay = [](auto&) {};
+
+HistoryEntry message(const std::string& text) {
+    HistoryEntry entry;
+    entry.frames[0] = make_payload(text);
+    return entry;
+}
+
+} // namespace
+
+TEST(RoomRegistry, RoomIdOfValidatesNames) {
+    EXPECT_EQ(room_id_of("general"), "room-general");
+    EXPECT_EQ(room_id_of("room-general"), "room-general");
+    EXPECT_EQ(room_id_of("a_b-9"), "room-a_b-9");
+    EXPECT_EQ(room_id_of(""), "");
+    EXPECT_EQ(room_id_of("has space"), "");
+    EXPECT_EQ(room_id_of("sl/ash"), "");
+    EXPECT_EQ(room_id_of(std::string(simplechat::chat::kMaxRoomNameLen + 1, 'x')), "");
+}
+
+TEST(RoomRegistry, InternIsIdempotent) {
+    RoomRegistry rooms;
+    const RoomHandle a = rooms.intern("room-a");
+    EXPECT_EQ(rooms.intern("room-a"), a);
+    EXPECT_NE(rooms.intern("room-b"), a);
+    EXPECT_EQ(rooms.size(), 2u);
+    EXPECT_EQ(rooms.at(a).room_id(), "room-a");
+    EXPECT_EQ(rooms.find("room-a"), &rooms.at(a));
+    EXPECT_EQ(rooms.find("room-c"), nullptr);
+    EXPECT_THROW(rooms.at(RoomHandle{99}), std::out_of_range);
+}
+
+TEST(RoomRegistry, CreateJoinLeave) {
+    RoomRegistry rooms;
+    Room* room = rooms.create("room-x", 1, Wire::Json);
+    ASSERT_NE(room, nullptr);
+    EXPECT_EQ(rooms.create("room-x", 2, Wire::Json), nullptr);  // exists
+    EXPECT_EQ(rooms.join("room-y", 2, Wire::Json, no_replay), nullptr);
+
+    ASSERT_EQ(rooms.join("room-x", 2, Wire::Binary, no_replay), room);
+    EXPECT_EQ(room->wire_counts(), (std::array<std::size_t, 2>{1, 1}));
+
+    const RoomHandle handle = room->handle();
+    std::size_t left_behind = 0;
+    rooms.leave(handle, 1, [&](Room& r) { left_behind = r.size(); });
+    EXPECT_EQ(left_behind, 1u);
+    EXPECT_NE(rooms.find("room-x"), nullptr);
+
+    // The last one out tears it down.
+    rooms.leave(handle, 2, [&](Room& r) { left_behind = r.size(); });
+    EXPECT_EQ(left_behind, 0u);
+    EXPECT_EQ(rooms.find("room-x"), nullptr);
+    EXPECT_EQ(rooms.find(handle), nullptr);
+    EXPECT_EQ(rooms.size(), 0u);
+}
+
+TEST(RoomRegistry, JoinReplaysHistory) {
+    RoomRegistry rooms;
+    Room* room = rooms.create("room-x", 1, Wire::Json);
+    room->record(message("one"), [](const auto&, const auto&) {});
+    room->record(message("two"), [](const auto&, const auto&) {});
+
+    std::vector<std::string> replayed;
+    rooms.join("room-x", 2, Wire::Json, [&](auto& frames) {
+        for (const auto& f : frames) replayed.push_back(f->data());
+    });
+    EXPECT_EQ(replayed, (std::vector<std::string>{"one", "two"}));
+}
+
+TEST(RoomRegistry, ReusesFreedHandles) {
+    RoomRegistry rooms;
+    const RoomHandle lobby = rooms.intern("room-lobby", true);
+    const RoomHandle a = rooms.create("room-a", 1, Wire::Json)->handle();
+    const RoomHandle b = rooms.create("room-b", 2, Wire::Json)->handle();
+
+    rooms.leave(a, 1, no_replay);
+    // Handles stay dense: the next room takes the freed slot.
+    const RoomHandle c = rooms.create("room-c", 3, Wire::Json)->handle();
+    EXPECT_EQ(c, a);
+    EXPECT_EQ(rooms.at(c).room_id(), "room-c");
+    EXPECT_EQ(rooms.find("room-a"), nullptr);
+
+    const RoomHandle d = rooms.create("room-d", 4, Wire::Json)->handle();
+    EXPECT_NE(d, lobby);
+    EXPECT_NE(d, b);
+    EXPECT_NE(d, c);
+}
+
+TEST(RoomRegistry, PinnedRoomsOutliveTheirMembers) {
+    RoomRegistry rooms;
+    const RoomHandle lobby = rooms.intern("room-lobby", true);
+    ASSERT_NE(rooms.join("room-lobby", 1, Wire::Json, no_replay), nullptr);
+    rooms.leave(lobby, 1, no_replay);
+    EXPECT_NE(rooms.find("room-lobby"), nullptr);
+    EXPECT_EQ(rooms.reap(), 0u);
+
+    // Interning as pinned later pins an existing room.
+    const RoomHandle a = rooms.create("room-a", 2, Wire::Json)->handle();
+    EXPECT_EQ(rooms.intern("room-a", true), a);
+    rooms.leave(a, 2, no_replay);
+    EXPECT_NE(rooms.find("room-a"), nullptr);
+}
+
+TEST(RoomRegistry, ReapDropsEmptyRoomsWithoutHistory) {
+    RoomRegistry rooms;
+    rooms.intern("room-lobby", true);
+    rooms.intern("room-empty");
+    rooms.at(rooms.intern("room-history")).restore(message("kept"));
+    rooms.create("room-busy", 1, Wire::Json);
+
+    EXPECT_EQ(rooms.reap(), 1u);
+    EXPECT_EQ(rooms.find("room-empty"), nullptr);
+    EXPECT_NE(rooms.find("room-history"), nullptr);
+    EXPECT_NE(rooms.find("room-busy"), nullptr);
+    EXPECT_EQ(rooms.size(), 3u);
+}
+
+TEST(RoomRegistry, ListsInHandleOrder) {
+    RoomRegistry rooms;
+    rooms.intern("room-lobby", true);
+    rooms.create("room-a", 1, Wire::Json);
+    rooms.join("room-a", 2, Wire::Json, no_replay);
+    rooms.create("room-b", 3, Wire::Json);
+
+    const auto all = rooms.list(10);
+    ASSERT_EQ(all.size(), 3u);
+    EXPECT_EQ(all[0].room_id, "room-lobby");
+    EXPECT_EQ(all[1].room_id, "room-a");
+    EXPECT_EQ(all[1].members, 2u);
+    EXPECT_EQ(all[2].members, 1u);
+    EXPECT_EQ(rooms.list(2).size(), 2u);
+}
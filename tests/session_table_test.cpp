@@ -0,0 +1,112 @@
+#include "networking/SessionTable.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using simplechat::networking::ClientId;
+using simplechat::networking::SessionTable;
+
+namespace {
+
+struct Value {
+    ClientId id;
+    int data;
+};
+
+ClientId insert(SessionTable<Value>& table, int data) {
+    return table.insert([&](ClientId id) { return std::make_shared<Value>(Value{id, data}); });
+}
+
+} // namespace
+
+TEST(SessionTable, InsertAndVisit) {
+    SessionTable<Value> table;
+    const ClientId a = insert(table, 1);
+    const ClientId b = insert(table, 2);
+
+    EXPECT_NE(a, 0u);
+    EXPECT_NE(a, b);
+    EXPECT_EQ(table.size(), 2u);
+
+    int seen = 0;
+    EXPECT_TRUE(table.visit(b, [&](Value& v) {
+        EXPECT_EQ(v.id, b);
+        seen = v.data;
+    }));
+    EXPECT_EQ(seen, 2);
+    EXPECT_FALSE(table.visit(b + 1, [](Value&) { FAIL(); }));
+}
+
+TEST(SessionTable, EraseIsOnce) {
+    SessionTable<Value> table;
+    const ClientId id = insert(table, 1);
+
+    EXPECT_TRUE(table.erase(id));
+    EXPECT_FALSE(table.erase(id));
+    EXPECT_FALSE(table.visit(id, [](Value&) { FAIL(); }));
+    EXPECT_EQ(table.size(), 0u);
+}
+
+TEST(SessionTable, ReusedSlotGetsNewGeneration) {
+    SessionTable<Value> table;
+    const ClientId old_id = insert(table, 1);
+    ASSERT_TRUE(table.erase(old_id));
+
+    const ClientId new_id = insert(table, 2);
+    EXPECT_EQ(new_id & 0xFFFFFFFFu, old_id & 0xFFFFFFFFu);  // same slot
+    EXPECT_NE(new_id, old_id);
+
+    // A stale id never reaches the slot's new value.
+    EXPECT_FALSE(table.visit(old_id, [](Value&) { FAIL(); }));
+    EXPECT_FALSE(table.erase(old_id));
+    EXPECT_TRUE(table.visit(new_id, [](Value& v) { EXPECT_EQ(v.data, 2); }));
+}
+
+TEST(SessionTable, SnapshotHasLiveValues) {
+    SessionTable<Value> table;
+    const ClientId a = insert(table, 1);
+    insert(table, 2);
+    insert(table, 3);
+    table.erase(a);
+
+    int sum = 0;
+    for (const auto& v : table.snapshot()) sum += v->data;
+    EXPECT_EQ(sum, 5);
+}
+
+TEST(SessionTable, ConcurrentVisitAndErase) {
+    SessionTable<Value> table;
+    constexpr int kIds = 2000;
+    std::vector<ClientId> ids;
+    for (int i = 0; i < kIds; ++i) ids.push_back(insert(table, i));
+
+    std::atomic<bool> done{false};
+    std::atomic<int> mismatches{0};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 3; ++t) {
+        readers.emplace_back([&] {
+            while (!done.load()) {
+                for (ClientId id : ids) {
+                    table.visit(id, [&](Value& v) {
+                        if (v.id != id) mismatches.fetch_add(1);
+                    });
+                }
+            }
+        });
+    }
+
+    // Erase and refill every slot while the readers run.
+    for (ClientId id : ids) {
+        ASSERT_TRUE(table.erase(id));
+        insert(table, -1);
+    }
+    done = true;
+    for (auto& r : readers) r.join();
+
+    EXPECT_EQ(mismatches.load(), 0);
+    EXPECT_EQ(table.size(), static_cast<std::size_t>(kIds));
+}
@@ -0,0 +1,152 @@
+#include "chat/IDGenerator.hpp"
+#include "chat/Room.h"
+#include "chat/Snapshot.h"
+#include "chat/User.h"
+#include "chat/UserDirectory.h"
+#include "protocol/BinaryCodec.h"
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using simplechat::chat::decode_state;
+using simplechat::chat::encode_state;
+using simplechat::chat::HistoryEntry;
+using simplechat::chat::IDGenerator;
+using simplechat::chat::RoomRegistry;
+using simplechat::chat::User;
+using simplechat::chat::UserDirectory;
+using simplechat::networking::make_payload;
+using simplechat::protocol::BinaryReader;
+using simplechat::protocol::BinaryWriter;
+using simplechat::protocol::MsgType;
+using simplechat::protocol::Wire;
+
+namespace {
+
+HistoryEntry message(std::uint32_t room_handle, const std::string& text) {
+    HistoryEntry entry;
+    entry.frames[0] = make_payload(R"({"type":"msg","text":")" + text + "\"}");
+    entry.frames[1] = make_payload(BinaryWriter(MsgType::Chat, room_handle, 1).str("from").str(text).take(), true);
+    return entry;
+}
+
+} // namespace
+
+TEST(Snapshot, RoundTripsRoomsHistoryAndUsers) {
+    IDGenerator idgen;
+    RoomRegistry rooms;
+    UserDirectory users;
+    rooms.intern("room-lobby", true);
+    auto& general = rooms.at(rooms.intern("room-general"));
+    general.restore(message(general.handle(), "one"));
+    general.restore(message(general.handle(), "two"));
+
+    User alice(idgen, "alice"), gone(idgen, "gone");
+    const auto added = users.add(alice.profile(), 1, Wire::Json);
+    const std::string& token = added.token;
+    users.add(gone.profile(), 2, Wire::Json);
+    users.detach(gone.id(), 2);
+
+    // The successor interns its own lobby first, so handles differ.
+    RoomRegistry next_rooms;
+    UserDirectory next_users;
+    next_rooms.intern("room-lobby", true);
+    next_rooms.intern("room-other");
+
+    const auto restored = decode_state(encode_state(rooms, users, true), next_rooms, next_users);
+    EXPECT_EQ(restored.rooms, 2u);
+    EXPECT_EQ(restored.messages, 2u);
+    EXPECT_EQ(restored.users, 1u);
+
+    auto* room = next_rooms.find("room-general");
+    ASSERT_NE(room, nullptr);
+    std::vector<std::string> texts;
+    room->for_each_entry([&](const HistoryEntry& e) {
+        BinaryReader in(e.frames[1]->data());
+        ASSERT_TRUE(in.ok());
+        EXPECT_EQ(in.header().room, room->handle());  // rewritten for this process
+        std::string_view from, text;
+        ASSERT_TRUE(in.str(from) && in.str(text));
+        texts.emplace_back(text);
+    });
+    EXPECT_EQ(texts, (std::vector<std::string>{"one", "two"}));
+
+    // Handed-over users are not online until a session resumes them.
+    EXPECT_EQ(next_users.size(), 0u);
+    EXPECT_FALSE(next_users.find(alice.id()));
+    const auto identity = next_users.attach(token, 7, Wire::Binary);
+    ASSERT_TRUE(identity);
+    EXPECT_EQ(identity->profile->name(), "alice");
+    EXPECT_EQ(identity->handle, added.handle);  // history frames still name her
+    EXPECT_EQ(next_users.size(), 1u);
+
+    // Nor does a new user get the handle of one gone before the handoff.
+    User carol(idgen, "carol");
+    EXPECT_GE(next_users.add(carol.profile(), 8, Wire::Json).handle, users.next_handle());
+}
+
+TEST(Snapshot, WithoutHistoryKeepsRoomsOnly) {
+    RoomRegistry rooms;
+    UserDirectory users;
+    auto& general = rooms.at(rooms.intern("room-general"));
+    general.restore(message(general.handle(), "one"));
+
+    RoomRegistry next_rooms;
+    UserDirectory next_users;
+    const auto restored = decode_state(encode_state(rooms, users, false), next_rooms, next_users);
+    EXPECT_EQ(restored.rooms, 1u);
+    EXPECT_EQ(restored.messages, 0u);
+    EXPECT_NE(next_rooms.find("room-general"), nullptr);
+}
+
+TEST(Snapshot, RestoredRoomsWithHistoryOutliveReap) {
+    RoomRegistry rooms;
+    UserDirectory users;
+    auto& general = rooms.at(rooms.intern("room-general"));
+    general.restore(message(general.handle(), "one"));
+    rooms.intern("room-quiet");
+
+    RoomRegistry next_rooms;
+    UserDirectory next_users;
+    decode_state(encode_state(rooms, users, true), next_rooms, next_users);
+
+    EXPECT_EQ(next_rooms.reap(), 1u);  // room-quiet
+    EXPECT_EQ(next_rooms.find("room-quiet"), nullptr);
+    auto* room = next_rooms.join("room-general", 1, Wire::Json, [](auto&) {});
+    ASSERT_NE(room, nullptr);
+    EXPECT_TRUE(room->has_history());
+}
+
+TEST(Snapshot, UnresumedUsersAreReaped) {
+    IDGenerator idgen;
+    RoomRegistry rooms;
+    UserDirectory users;
+    User alice(idgen, "alice"), bob(idgen, "bob");
+    const std::string alice_token = users.add(alice.profile(), 1, Wire::Json).token;
+    users.add(bob.profile(), 2, Wire::Json);
+
+    RoomRegistry next_rooms;
+    UserDirectory next_users;
+    decode_state(encode_state(rooms, users, false), next_rooms, next_users);
+    ASSERT_TRUE(next_users.attach(alice_token, 5, Wire::Json));
+
+    EXPECT_EQ(next_users.reap(), 1u);  // bob
+    EXPECT_TRUE(next_users.find(alice.id()));
+}
+
+TEST(Snapshot, RejectsMalformedState) {
+    RoomRegistry rooms;
+    UserDirectory users;
+    const std::string good = encode_state(rooms, users, true);
+
+    EXPECT_THROW(decode_state("", rooms, users), std::runtime_error);
+    EXPECT_THROW(decode_state(good.substr(0, good.size() - 1), rooms, users), std::runtime_error);
+    EXPECT_THROW(decode_state(good + "x", rooms, users), std::runtime_error);
+
+    std::string other_version = good;
+    other_version[0] = 99;
+    EXPECT_THROW(decode_state(other_version, rooms, users), std::runtime_error);
+}
@@ -0,0 +1,103 @@
+#include "networking/TimerWheel.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+
+using simplechat::networking::TimerWheel;
+
+namespace {
+
+// (value, tick it fired at)
+using Fired = std::vector<std::pair<std::uint64_t, std::uint64_t>>;
+
+void advance(TimerWheel<std::uint64_t>& wheel, std::uint64_t to, Fired& fired) {
+    wheel.advance(to, [&](std::uint64_t&& v) { fired.emplace_back(v, wheel.now()); });
+}
+
+} // namespace
+
+TEST(TimerWheel, FiresAtDeadline) {
+    TimerWheel<std::uint64_t> wheel;
+    wheel.schedule(5, 5);
+    wheel.schedule(3, 3);
+    EXPECT_EQ(wheel.size(), 2u);
+
+    Fired fired;
+    advance(wheel, 4, fired);
+    ASSERT_EQ(fired.size(), 1u);
+    EXPECT_EQ(fired[0], std::make_pair(std::uint64_t{3}, std::uint64_t{3}));
+
+    advance(wheel, 5, fired);
+    ASSERT_EQ(fired.size(), 2u);
+    EXPECT_EQ(fired[1], std::make_pair(std::uint64_t{5}, std::uint64_t{5}));
+    EXPECT_EQ(wheel.size(), 0u);
+}
+
+TEST(TimerWheel, PastDeadlineFiresNextTick) {
+    TimerWheel<std::uint64_t> wheel;
+    Fired fired;
+    advance(wheel, 10, fired);
+
+    wheel.schedule(2, 1);
+    wheel.schedule(10, 2);
+    advance(wheel, 11, fired);
+    ASSERT_EQ(fired.size(), 2u);
+    EXPECT_EQ(fired[0].second, 11u);
+    EXPECT_EQ(fired[1].second, 11u);
+}
+
+// Deadlines across every level fire exactly on their tick, in tick order.
+TEST(TimerWheel, CascadesThroughLevels) {
+    TimerWheel<std::uint64_t> wheel;
+    const std::vector<std::uint64_t> deadlines = {
+        1, 255, 256, 257, 511, 65535, 65536, 65537, 70000, 16777216, 16777217};
+    for (auto d : deadlines) wheel.schedule(d, d);
+
+    Fired fired;
+    advance(wheel, deadlines.back(), fired);
+    ASSERT_EQ(fired.size(), deadlines.size());
+    for (std::size_t i = 0; i < deadlines.size(); ++i) {
+        EXPECT_EQ(fired[i].first, deadlines[i]);
+        EXPECT_EQ(fired[i].second, deadlines[i]);
+    }
+}
+
+TEST(TimerWheel, RandomDeadlinesFireOnTheirTick) {
+    TimerWheel<std::uint64_t> wheel;
+    std::mt19937_64 rng(42);
+    std::uniform_int_distribution<std::uint64_t> delay(1, 200000);
+
+    Fired fired;
+    std::size_t scheduled = 0;
+    // Schedule from different points in time so entries land mid-span.
+    for (std::uint64_t step = 0; step < 5; ++step) {
+        for (int i = 0; i < 2000; ++i) {
+            const std::uint64_t deadline = wheel.now() + delay(rng);
+            wheel.schedule(deadline, deadline);
+            ++scheduled;
+        }
+        advance(wheel, wheel.now() + 30011, fired);
+    }
+    advance(wheel, wheel.now() + 200001, fired);
+
+    EXPECT_EQ(fired.size(), scheduled);
+    EXPECT_EQ(wheel.size(), 0u);
+    for (const auto& [deadline, tick] : fired) EXPECT_EQ(deadline, tick);
+}
+
+TEST(TimerWheel, FireMayReschedule) {
+    TimerWheel<std::uint64_t> wheel;
+    wheel.schedule(1, 0);
+
+    std::uint64_t fires = 0;
+    wheel.advance(1000, [&](std::uint64_t&&) {
+        ++fires;
+        wheel.schedule(wheel.now() + 100, 0);
+    });
+    EXPECT_EQ(fires, 10u);  // ticks 1, 101, ..., 901
+    EXPECT_EQ(wheel.size(), 1u);
+}
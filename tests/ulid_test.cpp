@@ -0,0 +1,80 @@
+#include "chat/IDGenerator.hpp"
+#include "chat/Ulid.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <random>
+#include <string>
+
+using simplechat::chat::IDGenerator;
+using simplechat::chat::Ulid;
+
+TEST(Ulid, RoundTripsThroughString) {
+    std::mt19937_64 rng(7);
+    for (int i = 0; i < 10000; ++i) {
+        const Ulid u = Ulid::from_parts(rng() >> 16, rng(), rng());
+        const std::string s = u.to_string();
+        ASSERT_EQ(s.size(), Ulid::kStringSize);
+
+        const auto back = Ulid::parse(s);
+        ASSERT_TRUE(back);
+        EXPECT_EQ(*back, u);
+    }
+}
+
+TEST(Ulid, Extremes) {
+    const Ulid zero;
+    EXPECT_TRUE(zero.is_nil());
+    EXPECT_EQ(zero.to_string(), std::string(26, '0'));
+    EXPECT_EQ(Ulid::parse(std::string(26, '0')), zero);
+
+    const Ulid max = Ulid::from_parts((std::uint64_t(1) << 48) - 1, 0xFFFF, ~std::uint64_t{0});
+    EXPECT_EQ(max.to_string(), "7ZZZZZZZZZZZZZZZZZZZZZZZZZ");
+    EXPECT_EQ(Ulid::parse("7ZZZZZZZZZZZZZZZZZZZZZZZZZ"), max);
+}
+
+TEST(Ulid, KeepsTimestamp) {
+    const Ulid u = Ulid::from_parts(1700000000123, 0xABCD, 42);
+    EXPECT_EQ(u.timestamp_ms(), 1700000000123u);
+    EXPECT_EQ(Ulid::parse(u.to_string())->timestamp_ms(), 1700000000123u);
+}
+
+TEST(Ulid, ParseAcceptsLowerCaseAndAliases) {
+    const Ulid u = Ulid::from_parts(1700000000123, 0x1234, 0x0123456789ABCDEF);
+    std::string lower = u.to_string();
+    std::transform(lower.begin(), lower.end(), lower.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    EXPECT_EQ(Ulid::parse(lower), u);
+
+    EXPECT_EQ(Ulid::parse("OOOOOOOOOOOOOOOOOOOOOOOOOI"), Ulid::parse("00000000000000000000000001"));
+    EXPECT_EQ(Ulid::parse("0000000000000000000000000l"), Ulid::parse("00000000000000000000000001"));
+}
+
+TEST(Ulid, ParseRejectsMalformed) {
+    EXPECT_FALSE(Ulid::parse(""));
+    EXPECT_FALSE(Ulid::parse(std::string(25, '0')));
+    EXPECT_FALSE(Ulid::parse(std::string(27, '0')));
+    EXPECT_FALSE(Ulid::parse("0000000000000000000000000U"));  // not in the alphabet
+    EXPECT_FALSE(Ulid::parse("8ZZZZZZZZZZZZZZZZZZZZZZZZZ"));  // over 128 bits
+}
+
+TEST(Ulid, PrefixedForm) {
+    const Ulid u = Ulid::from_parts(1, 2, 3);
+    EXPECT_EQ(u.to_string("user"), "user-" + u.to_string());
+    EXPECT_EQ(IDGenerator::format(IDGenerator::Kind::Room, u), "room-" + u.to_string());
+}
+
+// Byte order is time order, and the string form sorts the same way.
+TEST(Ulid, GeneratedIdsAreOrdered) {
+    IDGenerator gen;
+    Ulid prev = gen.next();
+    for (int i = 0; i < 10000; ++i) {
+        const Ulid next = gen.next();
+        ASSERT_LT(prev, next);
+        ASSERT_LT(prev.to_string(), next.to_string());
+        prev = next;
+    }
+}
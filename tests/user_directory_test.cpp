@@ -0,0 +1,163 @@
+#include "chat/IDGenerator.hpp"
+#include "chat/User.h"
+#include "chat/UserDirectory.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+using simplechat::chat::IDGenerator;
+using simplechat::chat::User;
+using simplechat::chat::UserDirectory;
+using simplechat::protocol::Wire;
+
+namespace {
+
+class UserDirectoryTest : public ::testing::Test {
+protected:
+    IDGenerator idgen;
+    UserDirectory users;
+};
+
+} // namespace
+
+TEST_F(UserDirectoryTest, TokenAttachesAnotherSession) {
+    User alice(idgen, "alice");
+    const std::string token = users.add(alice.profile(), 1, Wire::Json).token;
+    EXPECT_EQ(users.size(), 1u);
+
+    const auto identity = users.attach(token, 2, Wire::Binary);
+    ASSERT_TRUE(identity);
+    EXPECT_EQ(identity->profile->id(), alice.id());
+    EXPECT_EQ(identity->profile->name(), "alice");
+    EXPECT_EQ(identity->token, token);
+    EXPECT_EQ(identity->sessions, 2u);
+    EXPECT_EQ(users.size(), 1u);
+
+    std::vector<std::uint64_t> json, binary;
+    EXPECT_TRUE(users.with_sessions(alice.id(), [&](const auto& j, const auto& b) {
+        json = j;
+        binary = b;
+    }));
+    EXPECT_EQ(json, std::vector<std::uint64_t>{1});
+    EXPECT_EQ(binary, std::vector<std::uint64_t>{2});
+}
+
+TEST_F(UserDirectoryTest, HandleIsPerUser) {
+    User alice(idgen, "alice"), bob(idgen, "bob");
+    const auto first = users.add(alice.profile(), 1, Wire::Json);
+    const auto other = users.add(bob.profile(), 2, Wire::Binary);
+    EXPECT_NE(first.handle, 0u);
+    EXPECT_NE(first.handle, other.handle);
+
+    // Every session of the user shares it.
+    const auto second = users.attach(first.token, 3, Wire::Binary);
+    ASSERT_TRUE(second);
+    EXPECT_EQ(second->handle, first.handle);
+    EXPECT_EQ(users.find(alice.id())->handle, first.handle);
+
+    // Not handed out again once the user is gone.
+    users.detach(alice.id(), 1);
+    users.detach(alice.id(), 3);
+    User carol(idgen, "carol");
+    const auto next = users.add(carol.profile(), 4, Wire::Json);
+    EXPECT_NE(next.handle, first.handle);
+    EXPECT_NE(next.handle, other.handle);
+}
+
+TEST_F(UserDirectoryTest, RejectsBadTokens) {
+    User alice(idgen, "alice");
+    const std::string token = users.add(alice.profile(), 1, Wire::Json).token;
+
+    std::string wrong = token;
+    wrong.back() = wrong.back() == '0' ? '1' : '0';
+    EXPECT_FALSE(users.attach(wrong, 2, Wire::Json));
+    EXPECT_FALSE(users.attach("junk", 2, Wire::Json));
+    EXPECT_FALSE(users.attach(token.substr(0, token.find('.')), 2, Wire::Json));
+    EXPECT_FALSE(users.attach(token.substr(0, token.find('.') + 1), 2, Wire::Json));
+}
+
+TEST_F(UserDirectoryTest, UserGoesWithLastSession) {
+    User alice(idgen, "alice");
+    const std::string token = users.add(alice.profile(), 1, Wire::Json).token;
+    users.attach(token, 2, Wire::Json);
+
+    EXPECT_FALSE(users.detach(alice.id(), 1));
+    EXPECT_TRUE(users.find(alice.id()));
+    EXPECT_TRUE(users.detach(alice.id(), 2));
+    EXPECT_EQ(users.size(), 0u);
+    EXPECT_FALSE(users.find(alice.id()));
+    EXPECT_FALSE(users.with_sessions(alice.id(), [](const auto&, const auto&) { FAIL(); }));
+
+    // The token dies with the user.
+    EXPECT_FALSE(users.attach(token, 3, Wire::Json));
+}
+
+TEST_F(UserDirectoryTest, RenameReachesEverySession) {
+    User first(idgen, "alice");
+    const std::string token = users.add(first.profile(), 1, Wire::Json).token;
+    const auto identity = users.attach(token, 2, Wire::Json);
+    ASSERT_TRUE(identity);
+    User second(identity->profile);
+
+    second.set_name("  alicia ");
+    EXPECT_EQ(first.name(), "alicia");
+    EXPECT_EQ(users.find(first.id())->profile->name(), "alicia");
+}
+
+TEST_F(UserDirectoryTest, PresenceIsPerUser) {
+    User alice(idgen, "alice");
+    const std::string token = users.add(alice.profile(), 1, Wire::Json).token;
+    users.attach(token, 2, Wire::Json);
+    constexpr UserDirectory::RoomHandle kRoom = 7, kOther = 8;
+
+    // Only the first session in a room is a join.
+    EXPECT_TRUE(users.enter_room(alice.id(), kRoom, 1));
+    EXPECT_FALSE(users.enter_room(alice.id(), kRoom, 1));
+    EXPECT_FALSE(users.enter_room(alice.id(), kRoom, 2));
+    EXPECT_TRUE(users.enter_room(alice.id(), kOther, 2));
+
+    // Only the last one out is a leave.
+    EXPECT_FALSE(users.leave_room(alice.id(), kRoom, 1));
+    EXPECT_FALSE(users.leave_room(alice.id(), kRoom, 1));
+    EXPECT_TRUE(users.leave_room(alice.id(), kRoom, 2));
+
+    // Never entered: nothing to announce.
+    EXPECT_FALSE(users.leave_room(alice.id(), kRoom, 1));
+}
+
+TEST_F(UserDirectoryTest, DetachLeavesRooms) {
+    User alice(idgen, "alice");
+    const std::string token = users.add(alice.profile(), 1, Wire::Json).token;
+    users.attach(token, 2, Wire::Json);
+    constexpr UserDirectory::RoomHandle kRoom = 7;
+
+    EXPECT_TRUE(users.enter_room(alice.id(), kRoom, 1));
+    EXPECT_FALSE(users.enter_room(alice.id(), kRoom, 2));
+    EXPECT_FALSE(users.detach(alice.id(), 2));
+    EXPECT_TRUE(users.leave_room(alice.id(), kRoom, 1));
+}
+
+TEST_F(UserDirectoryTest, ConcurrentUsers) {
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t] {
+            IDGenerator gen;
+            const std::uint64_t base = static_cast<std::uint64_t>(t) << 32;
+            for (std::uint64_t i = 0; i < 5000; ++i) {
+                User user(gen, "x");
+                const std::string token = users.add(user.profile(), base + 2 * i, Wire::Json).token;
+                ASSERT_TRUE(users.attach(token, base + 2 * i + 1, Wire::Binary));
+                EXPECT_TRUE(users.enter_room(user.id(), 1, base + 2 * i));
+                EXPECT_FALSE(users.enter_room(user.id(), 1, base + 2 * i + 1));
+                EXPECT_FALSE(users.detach(user.id(), base + 2 * i));
+                EXPECT_TRUE(users.leave_room(user.id(), 1, base + 2 * i + 1));
+                EXPECT_TRUE(users.detach(user.id(), base + 2 * i + 1));
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    EXPECT_EQ(users.size(), 0u);
+}
@@ -1,4 +1,16 @@
 let ws = null;
+let myName = "";
+let currentRoom = "room-lobby";  // rejoined after a server restart
+
+// Resume token shared by this browser's tabs, so they are one user.
+const TOKEN_KEY = "simplechat.token";
+// name -> user id, from presence frames, for "/dm name text".
+const knownUsers = new Map();
+
+// Close code the server sends when it hands over to a new process.
+const SERVICE_RESTART = 1012;
+// Reconnects are spread over this window so clients don't all arrive at once.
+const RESTART_JITTER_MS = 3000;
 
 const el = (id) => document.getElementById(id);
 
@@ -46,6 +58,196 @@ function addMessage(kind, from, text) {
   messages.scrollTop = messages.scrollHeight;
 }
 
+// ---- Binary protocol (simplechat.bin.v1) ----
+// Mirrors src/protocol/BinaryCodec.h: 12-byte little-endian header
+// (type u8, version u8, reserved u16, room u32, user u32) followed by
+// u32-length-prefixed UTF-8 fields.
+const BIN_PROTOCOL = "simplechat.bin.v1";
+const JSON_PROTOCOL = "simplechat.json";
+
+const MsgType = {
+  Join: 0x01,
+  Msg: 0x02,
+  Create: 0x03,
+  Leave: 0x04,
+  List: 0x05,
+  Dm: 0x06,
+  Welcome: 0x81,
+  System: 0x82,
+  Chat: 0x83,
+  Error: 0x84,
+  DebugJoin: 0x85,
+  DebugMsg: 0x86,
+  Room: 0x87,
+  Rooms: 0x88,
+  Presence: 0x89,
+  Direct: 0x8a,
+  Identity: 0x8b,
+};
+
+const BIN_VERSION = 1;
+const HEADER_SIZE = 12;
+
+const utf8Encoder = new TextEncoder();
+const utf8Decoder = new TextDecoder();
+
+function encodeFrame(type, fields, room = 0, user = 0) {
+  const encoded = fields.map((f) => utf8Encoder.encode(f));
+  const size = encoded.reduce((n, b) => n + 4 + b.length, HEADER_SIZE);
+
+  const buf = new ArrayBuffer(size);
+  const view = new DataView(buf);
+  const bytes = new Uint8Array(buf);
+
+  view.setUint8(0, type);
+  view.setUint8(1, BIN_VERSION);
+  view.setUint32(4, room, true);
+  view.setUint32(8, user, true);
+
+  let pos = HEADER_SIZE;
+  for (const b of encoded) {
+    view.setUint32(pos, b.length, true);
+    bytes.set(b, pos + 4);
+    pos += 4 + b.length;
+  }
+  return buf;
+}
+
+function decodeFrame(buf) {
+  const view = new DataView(buf);
+  if (buf.byteLength < HEADER_SIZE || view.getUint8(1) !== BIN_VERSION) return null;
+
+  const frame = {
+    type: view.getUint8(0),
+    room: view.getUint32(4, true),
+    user: view.getUint32(8, true),
+    fields: [],
+  };
+
+  let pos = HEADER_SIZE;
+  while (pos + 4 <= buf.byteLength) {
+    const len = view.getUint32(pos, true);
+    pos += 4;
+    if (pos + len > buf.byteLength) return null;
+    frame.fields.push(utf8Decoder.decode(new Uint8Array(buf, pos, len)));
+    pos += len;
+  }
+  return frame;
+}
+
+// Maps a binary frame onto the JSON message shape used by the UI.
+function binaryToMessage(frame) {
+  const f = frame.fields;
+  switch (frame.type) {
+    case MsgType.Welcome:
+      return { type: "system", client_id: f[0], user_id: f[1], room_id: f[2], text: f[3], token: f[4] };
+    case MsgType.System:
+      return { type: "system", text: f[0] };
+    case MsgType.Chat:
+      return { type: "msg", from: f[0], text: f[1], user_id: f[2], client_id: f[3], user: frame.user, room: frame.room };
+    case MsgType.Error:
+      return { type: "error", text: f[0] };
+    case MsgType.DebugJoin:
+      return { type: "debug_join", name: f[0], user: frame.user, room: frame.room };
+    case MsgType.DebugMsg:
+      return { type: "debug_msg", name: f[0], text: f[1], user: frame.user, room: frame.room };
+    case MsgType.Room:
+      return { type: "room", room_id: f[0], members: Number(f[1]) };
+    case MsgType.Rooms: {
+      const rooms = [];
+      for (let i = 1; i + 1 < f.length; i += 2) rooms.push({ room_id: f[i], members: Number(f[i + 1]) });
+      return { type: "rooms", total: Number(f[0]), rooms };
+    }
+    case MsgType.Direct:
+      return { type: "dm", from: f[0], user_id: f[1], to: f[2], text: f[3] };
+    case MsgType.Identity:
+      return { type: "identity", user_id: f[0], name: f[1], token: f[2], sessions: Number(f[3]) };
+    case MsgType.Presence: {
+      const joinedCount = Number(f[1]);
+      const leftCount = Number(f[2]);
+      const msg = { type: "presence", members: Number(f[0]), joined_count: joinedCount, left_count: leftCount };
+      if (f.length > 3) {
+        const people = [];
+        for (let i = 3; i + 1 < f.length; i += 2) people.push({ user_id: f[i], name: f[i + 1] });
+        msg.joined = people.slice(0, joinedCount);
+        msg.left = people.slice(joinedCount);
+      }
+      return msg;
+    }
+    default:
+      return { type: `binary:${frame.type}` };
+  }
+}
+
+// "alice, bob joined; carol left (12 here)", or counts for big rooms.
+function describePresence(p) {
+  const part = (list, count, verb) => {
+    if (!count) return null;
+    if (list) return `${list.map((e) => e.name).join(", ")} ${verb}`;
+    return `${count} ${verb}`;
+  };
+  const parts = [part(p.joined, p.joined_count, "joined"), part(p.left, p.left_count, "left")];
+  return `${parts.filter(Boolean).join("; ")} (${p.members} here)`;
+}
+
+function isBinary() {
+  return ws && ws.protocol === BIN_PROTOCOL;
+}
+
+// Presents the stored token, if any, so this tab joins as the same user as
+// the others; the server answers with an "identity" frame either way.
+function sendJoin(name, room = "lobby") {
+  const token = localStorage.getItem(TOKEN_KEY);
+  if (isBinary()) ws.send(encodeFrame(MsgType.Join, token ? [name, room, token] : [name, room]));
+  else ws.send(JSON.stringify(token ? { type: "join", user: name, room, token } : { type: "join", user: name, room }));
+}
+
+function sendDm(to, text) {
+  if (isBinary()) ws.send(encodeFrame(MsgType.Dm, [to, text]));
+  else ws.send(JSON.stringify({ type: "dm", to, text }));
+}
+
+function sendChat(text) {
+  if (isBinary()) ws.send(encodeFrame(MsgType.Msg, [text]));
+  else ws.send(JSON.stringify({ type: "msg", text }));
+}
+
+// "/join room", "/create [room]", "/leave", "/list", "/dm user text".
+// Returns false for plain text.
+function sendCommand(text) {
+  const [cmd, arg] = text.split(/\s+/, 2);
+  const bin = isBinary();
+  switch (cmd) {
+    case "/dm": {
+      const m = text.match(/^\/dm\s+(\S+)\s+([\s\S]+)$/);
+      if (!m) return false;
+      const to = m[1].startsWith("user-") ? m[1] : knownUsers.get(m[1]);
+      if (!to) addMessage("system", "error", `unknown user ${m[1]}`);
+      else sendDm(to, m[2]);
+      return true;
+    }
+    case "/join":
+      if (!arg) return false;
+      if (bin) ws.send(encodeFrame(MsgType.Join, [meName.textContent, arg]));
+      else ws.send(JSON.stringify({ type: "join", room: arg }));
+      return true;
+    case "/create":
+      if (bin) ws.send(encodeFrame(MsgType.Create, arg ? [arg] : []));
+      else ws.send(JSON.stringify(arg ? { type: "create", room: arg } : { type: "create" }));
+      return true;
+    case "/leave":
+      if (bin) ws.send(encodeFrame(MsgType.Leave, []));
+      else ws.send(JSON.stringify({ type: "leave" }));
+      return true;
+    case "/list":
+      if (bin) ws.send(encodeFrame(MsgType.List, []));
+      else ws.send(JSON.stringify({ type: "list" }));
+      return true;
+    default:
+      return false;
+  }
+}
+
 function wsUrl() {
   // later when we put WS behind nginx (/ws), this will change to wss://.../ws
   return `ws://${location.hostname}:9002`;
@@ -57,7 +259,9 @@ function connect() {
     setStatus("idle");
     setStatusText("connecting…");
 
-    ws = new WebSocket(url);
+    // Prefer the binary protocol; the server may still pick JSON.
+    ws = new WebSocket(url, [BIN_PROTOCOL, JSON_PROTOCOL]);
+    ws.binaryType = "arraybuffer";
 
     ws.onopen = () => {
       setStatus("ok");
@@ -71,28 +275,57 @@ function connect() {
       reject(e);
     };
 
-    ws.onclose = () => {
+    ws.onclose = (e) => {
       setStatus("bad");
       setStatusText("disconnected");
       sendBtn.disabled = true;
+      if (e.code === SERVICE_RESTART && myName) {
+        setStatusText("server restarting…");
+        setTimeout(rejoin, Math.random() * RESTART_JITTER_MS);
+      }
     };
 
     ws.onmessage = (e) => {
       let obj = null;
-      try {
-        obj = JSON.parse(e.data);
-      } catch {
-        addMessage("system", "system", `non-json from server: ${e.data}`);
-        return;
+      if (e.data instanceof ArrayBuffer) {
+        const frame = decodeFrame(e.data);
+        if (!frame) {
+          addMessage("system", "system", "malformed binary frame from server");
+          return;
+        }
+        obj = binaryToMessage(frame);
+      } else {
+        try {
+          obj = JSON.parse(e.data);
+        } catch {
+          addMessage("system", "system", `non-json from server: ${e.data}`);
+          return;
+        }
       }
 
       if (obj.type === "system") {
+        if (obj.token && !localStorage.getItem(TOKEN_KEY)) localStorage.setItem(TOKEN_KEY, obj.token);
         addMessage("system", "system", obj.text || "");
+      } else if (obj.type === "identity") {
+        localStorage.setItem(TOKEN_KEY, obj.token);
+        if (obj.sessions > 1) addMessage("system", "system", `signed in as ${obj.name} (${obj.sessions} sessions)`);
+      } else if (obj.type === "dm") {
+        addMessage("msg", `${obj.from || "?"} (dm)`, obj.text || "");
       } else if (obj.type === "msg") {
+        if (obj.from && obj.user_id) knownUsers.set(obj.from, obj.user_id);
         addMessage("msg", obj.from || "?", obj.text || "");
       } else if (obj.type === "debug_join" || obj.type === "debug_msg") {
         // keep debug visible but subtle
         addMessage("system", "debug", `${obj.type}: ${JSON.stringify(obj)}`);
+      } else if (obj.type === "room") {
+        currentRoom = obj.room_id;
+        addMessage("system", "system", `now in ${obj.room_id} (${obj.members} here)`);
+      } else if (obj.type === "presence") {
+        for (const e of obj.joined || []) knownUsers.set(e.name, e.user_id);
+        addMessage("system", "system", describePresence(obj));
+      } else if (obj.type === "rooms") {
+        const names = obj.rooms.map((r) => `${r.room_id} (${r.members})`).join(", ");
+        addMessage("system", "system", `${obj.total} rooms: ${names}`);
       } else if (obj.type === "error") {
         addMessage("system", "error", obj.text || "unknown error");
       } else {
@@ -117,7 +350,8 @@ async function joinLobby() {
     await connect();
 
     // send join
-    ws.send(JSON.stringify({ type: "join", user: name, room: "lobby" }));
+    myName = name;
+    sendJoin(name);
 
     // show chat UI
     meName.textContent = name;
@@ -134,6 +368,18 @@ async function joinLobby() {
   }
 }
 
+// Back into the same room on the restarted server.
+async function rejoin() {
+  try {
+    await connect();
+    sendJoin(myName, currentRoom);
+    sendBtn.disabled = false;
+    addMessage("system", "system", "reconnected after a server restart");
+  } catch (e) {
+    setTimeout(rejoin, RESTART_JITTER_MS);
+  }
+}
+
 function sendMessage() {
   if (!ws || ws.readyState !== WebSocket.OPEN) {
     addMessage("system", "system", "not connected");
@@ -141,7 +387,7 @@ function sendMessage() {
   }
   const text = msgInput.value.trim();
   if (!text) return;
-  ws.send(JSON.stringify({ type: "msg", text }));
+  if (!(text.startsWith("/") && sendCommand(text))) sendChat(text);
   msgInput.value = "";
 }
 